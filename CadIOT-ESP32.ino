@@ -1,11 +1,12 @@
 
 // CadIOT_MultiDevice_v6 (Relay build; target selection; no temperature telemetry)
 // Define ONE of: -D TARGET_HEADLESS, -D TARGET_SSD1306, -D TARGET_M5CORES3, -D TARGET_TFT_ESPI
-#define TARGET_TFT_ESPI
+// (set per env in platformio.ini). Optional UI mirrors: -D UI_MIRROR_SERIAL, -D UI_MIRROR_LOG
 
 #if defined(TARGET_HEADLESS)
 #define TARGET_NAME "HEADLESS"
 #include "ui_HeadlessUi.h"
+typedef HeadlessUi Display;
 #ifndef RELAY_PIN
 #define RELAY_PIN 18
 #endif
@@ -13,6 +14,7 @@
 #elif defined(TARGET_SSD1306)
 #define TARGET_NAME "SSD1306"
 #include "ui_SSD1306Ui.h"
+typedef SSD1306Ui Display;
 #ifndef RELAY_PIN
 #define RELAY_PIN 18
 #endif
@@ -20,6 +22,7 @@
 #elif defined(TARGET_M5CORES3)
 #define TARGET_NAME "M5CORES3"
 #include "ui_M5CoreS3Ui.h"
+typedef M5CoreS3Ui Display;
 #ifndef RELAY_PIN
 #define RELAY_PIN 18
 #endif
@@ -27,6 +30,7 @@
 #elif defined(TARGET_TFT_ESPI)
 #define TARGET_NAME "TFT_eSPI"
 #include "ui_TFT_eSPI.h"
+typedef TftEspiUi Display;
 #ifndef RELAY_PIN
 #define RELAY_PIN 3
 #endif
@@ -36,287 +40,1096 @@
 #endif
 
 #include <WiFi.h>
-#include <WiFiClientSecure.h>
 #include <PubSubClient.h>
 #include <az_iot_hub_client.h>
+#include <az_json.h>
 #include "azure_AzIoTSasToken.h"
 #include "azure_sdk_compat.h"
-#include "ui_IUiAdapter.h"
+#include "diag_BootTimeline.h"
+#include "diag_HeapStats.h"
+#include "diag_Latency.h"
+#include "diag_TaskStats.h"
+#include "mqtt_CommandDecoder.h"
+#include "mqtt_EventTelemetry.h"
+#include "mqtt_MethodResponder.h"
+#include "mqtt_PayloadStream.h"
+#include "mqtt_TopicRouter.h"
+#include "mqtt_TwinReporter.h"
+#include "net_ConnectionFsm.h"
+#include "net_FastBoot.h"
+#include "net_SocketWait.h"
+#include "net_TlsSessionClient.h"
+#include "relay_PulseEngine.h"
+#include "relay_RelayBank.h"
+#include "relay_StateLog.h"
+#include "ui_UiSinks.h"
+#include "ui_AsyncUi.h"
+#include <freertos/queue.h>
+#if defined(UI_BENCH)
+#include "ui_MeteredUi.h"
+#if defined(CADIOT_NATIVE)
+#include "UiBench.h"
+#endif
+#endif
 #include "secrets.h"
+#ifndef IOTHUB_PORT
+#define IOTHUB_PORT 8883 // override (e.g. -D IOTHUB_PORT=18883) to point at tools/hub_emulator.py
+#endif
+#ifndef LAT_REPORT_S
+#define LAT_REPORT_S 300 // command latency telemetry period
+#endif
+#ifndef FAST_BOOT
+#define FAST_BOOT 1 // directed WiFi join, seeded clock, overlapped init; 0 = serial boot
+#endif
+
+// --- Tasks: network (MQTT/TLS/FSM) on one core, control (loop(): relays)
+// at high priority on the other, UI rendering at low priority ---
+#ifndef NET_TASK_CORE
+#define NET_TASK_CORE (ARDUINO_RUNNING_CORE == 0 ? 1 : 0)
+#endif
+#ifndef NET_TASK_PRIORITY
+#define NET_TASK_PRIORITY 3
+#endif
+#ifndef NET_TASK_STACK
+#define NET_TASK_STACK 8192 // TLS handshake runs here
+#endif
+#ifndef CTRL_TASK_PRIORITY
+#define CTRL_TASK_PRIORITY 5 // above the network and UI tasks
+#endif
+#ifndef PERSIST_TASK_PRIORITY
+#define PERSIST_TASK_PRIORITY 1 // relay state flash writes/erases: below everything that serves commands
+#endif
+#ifndef CTRL_QUEUE_LEN
+#define CTRL_QUEUE_LEN 4
+#endif
+#ifndef TASK_REPORT_S
+#define TASK_REPORT_S 300 // per-task CPU/stack telemetry period
+#endif
+#ifndef HEAP_REPORT_S
+#define HEAP_REPORT_S 300 // heap / allocation telemetry period
+#endif
+#ifndef EVENT_RSSI_S
+#define EVENT_RSSI_S 300 // RSSI sample period for event telemetry
+#endif
+#ifndef MSG_ARENA_SIZE
+#define MSG_ARENA_SIZE 2560 // network task scratch, reset per MQTT packet
+#endif
+static constexpr uint32_t NET_IDLE_MS = 1000; // online: wake at least this often (keepalive, twin, SAS timers)
+static constexpr uint32_t NET_STEP_MS = 10;   // connecting: the FSM steps poll their progress
+static constexpr uint32_t CTRL_IDLE_MS = 1000;
 
 #define ENABLE_SERIAL_LOG 1
-#if ENABLE_SERIAL_LOG
-#define LOG(fmt, ...) \
-  do { \
-    static char __b[256]; \
-    snprintf(__b, sizeof(__b), "[%lu][" TARGET_NAME "] " fmt, (unsigned long)millis(), ##__VA_ARGS__); \
-    Serial.println(__b); \
-  } while (0)
-#else
-#define LOG(fmt, ...) do { } while (0)
+#if !ENABLE_SERIAL_LOG && !defined(LOG_LEVEL)
+#define LOG_LEVEL LOG_LEVEL_NONE
 #endif
+#include "log_DeferredLog.h" // LOG/LOGE/LOGW/LOGD: deferred, drained by a low-priority task
 
-WiFiClientSecure net;
-PubSubClient mqtt(net);
+TlsSessionClient net; // mbedTLS client with session resumption (RTC-cached)
+static MqttBlockPool rxPool;           // inbound payload bodies (static, no heap)
+static MqttRxStream rxStream(rxPool);  // PubSubClient writes payload bytes here as they arrive
+static MqttRxGuard rxGuard(net, rxStream, MQTT_HEADER_BUF); // rejects topics the client buffer cannot hold
+PubSubClient mqtt(rxGuard);
+static StaticArena<MSG_ARENA_SIZE> msgArena; // network task scratch (telemetry bodies); reset per packet
 az_iot_hub_client hubClient;
 az_span host     = az_span_create((uint8_t *)IOTHUB_HOST, strlen(IOTHUB_HOST));
 az_span deviceId = az_span_create((uint8_t *)DEVICE_ID, strlen(DEVICE_ID));
 
 static uint8_t sigbuf[128];
 static uint8_t sasbuf[256];
+static uint8_t sasnextbuf[256];
 AzIoTSasToken sas(&hubClient,
   az_span_create((uint8_t *)BASE64_DEVICE_KEY, strlen(BASE64_DEVICE_KEY)),
   az_span_create(sigbuf, sizeof(sigbuf)),
-  az_span_create(sasbuf, sizeof(sasbuf)));
+  az_span_create(sasbuf, sizeof(sasbuf)),
+  az_span_create(sasnextbuf, sizeof(sasnextbuf)));
 
-#if defined(TARGET_HEADLESS)
-HeadlessUi ui;
-#elif defined(TARGET_SSD1306)
-SSD1306Ui ui;
-#elif defined(TARGET_M5CORES3)
-M5CoreS3Ui ui;
-#elif defined(TARGET_TFT_ESPI)
-TftEspiUi ui;
+// --- UI sinks, composed at build time (disabled mirrors compile out) ---
+#if defined(UI_MIRROR_SERIAL) && !defined(TARGET_HEADLESS)
+#include "ui_HeadlessUi.h"
+typedef HeadlessUi SerialMirror;
+#else
+typedef NullUiSink SerialMirror;
+#endif
+#if defined(UI_MIRROR_LOG)
+typedef LogUiSink LogMirror;
+#else
+typedef NullUiSink LogMirror;
+#endif
+typedef UiSinks<Display, SerialMirror, LogMirror> UiSinkSet;
+
+static UiSinkSet sinks;
+static Display &display = sinks.first();
+
+// All UI calls are queued and rendered by the UI task on the other core;
+// its per-tick sinks.pump() runs the display's flush/touch work
+static AsyncUi<UiSinkSet> ui(sinks);
+
+// Command-path latency histograms: receive -> dispatch -> GPIO -> response
+static CommandLatency latency;
+
+// Boot phase timestamps and the fast-boot caches (AP, lease, clock seed)
+static BootTimeline bootTimeline;
+static FastBoot fastBoot;
+
+// Per-task CPU/stack meters; the network task sleeps in netWait
+static TaskMeter netMeter("net"), ctrlMeter("ctrl"), uiMeter("ui");
+static TaskMeter *const kTaskMeters[] = { &netMeter, &ctrlMeter, &uiMeter };
+static SocketWait netWait;
+static std::atomic<bool> twinDirty{false};          // control -> network: levels changed
+static std::atomic<RelayMask> drivenLevels{0};      // control -> network: for the twin
+
+// Twin reported properties (relay levels, uptime, connection stats), coalesced
+static void fillTwinReport(TwinReport &r);
+static MqttTwinReporter twin(&hubClient, mqtt, fillTwinReport);
+
+// --- Relay control: every transition goes through the pulse engine ---
+// Channels: -D RELAY_CHANNELS=N -D RELAY_PINS=a,b,... (defaults to RELAY_PIN).
+// Interlocks: -D RELAY_INTERLOCKS=0x3,0xC (at most one ON channel per mask).
+static constexpr uint32_t RELAY_TEST_PULSE_MS = 2000; // UI test pulse; adjust to taste
+
+#ifndef RELAY_PINS
+#define RELAY_PINS RELAY_PIN
 #endif
+static const uint8_t relayPins[] = { RELAY_PINS };
+static_assert(sizeof(relayPins) == RELAY_CHANNELS, "RELAY_PINS must list RELAY_CHANNELS pins");
+static RelayBank relayBank(relayPins, RELAY_CHANNELS);
 
-// --- Relay control helpers ---
-static void activateRelay(const char *src)
+static const char *relaySrc = "boot"; // last writer, saved with the state
+static EventTelemetry events;          // relay / link / RSSI events, batched as CBOR telemetry
+
+static RelayMask writeRelays(RelayMask want, RelayMask claim, const char *src)
+{
+  const RelayMask before = relayBank.levels();
+  const RelayMask driven = relayBank.commit(want, claim);
+  if (driven != before) {
+    latency.actuated();
+    drivenLevels.store(driven, std::memory_order_relaxed);
+    twinDirty.store(true, std::memory_order_release);
+    netWait.wake();
+    relaySrc = src;
+    events.relay(driven, eventSourceFrom(src), millis());
+  }
+  if (driven != want) {
+    LOG("Relay interlock wanted=0x%lx driven=0x%lx src=%s", (unsigned long)want, (unsigned long)driven, src);
+  }
+#if RELAY_CHANNELS == 1
+  LOG("Relay %s src=%s", driven ? "ON" : "OFF", src);
+#else
+  LOG("Relay levels=0x%lx src=%s", (unsigned long)driven, src);
+#endif
+  ui.setRelays(UiRelayState(driven, RELAY_CHANNELS));
+  return driven;
+}
+
+static RelayPulseEngine relays(writeRelays);
+
+// --- Persistent relay state: restored before networking, saved on change ---
+// Latched channels come back after a reset; channels in a timed pulse come
+// back OFF. -D RELAY_RESTORE=0 always boots with every channel OFF.
+#ifndef RELAY_RESTORE
+#define RELAY_RESTORE 1
+#endif
+static RelayStateLog relayState;
+static RelayMask restoredLevels = 0;
+static uint32_t lastKnownEpoch = 0; // of the newest record: seeds the clock on a cold boot
+
+static void restoreRelays()
+{
+  RelayStateFlash flash;
+  RelayStateRecord r;
+  if (!relayStateFlash(flash) || !relayState.begin(flash) || !relayState.latest(r)) return;
+  lastKnownEpoch = r.epoch;
+  if (RELAY_RESTORE) {
+    restoredLevels = relayBank.commit(r.levels & ~r.pulsing); // GPIOs now; the engine syncs after logging is up
+  }
+}
+
+// The control task only hands the state over: a flash write, and every
+// sector's worth of records an erase, would stall pulses. The persist task
+// is the only user of relayState after setup().
+struct PersistRequest
+{
+  RelayMask levels;
+  RelayMask pulsing;
+  const char *src;
+  uint32_t epoch;
+};
+static portMUX_TYPE persistMux = portMUX_INITIALIZER_UNLOCKED;
+static PersistRequest persistWanted;
+static TaskHandle_t persistHandle = nullptr;
+
+// Control task: copies the state for the persist task; true when it changed
+static bool persistSnapshot()
 {
-  digitalWrite(RELAY_PIN, HIGH);
-  LOG("Relay ON src=%s", src);
-  ui.setStatus("Relay ON");
+  const RelayMask levels = relays.levels(), pulsing = relays.pendingMask();
+  const time_t now = time(NULL);
+  portENTER_CRITICAL(&persistMux);
+  const bool changed = levels != persistWanted.levels || pulsing != persistWanted.pulsing;
+  if (changed) {
+    persistWanted.levels = levels;
+    persistWanted.pulsing = pulsing;
+    persistWanted.src = relaySrc;
+    persistWanted.epoch = now >= 1609459200 ? (uint32_t)now : 0;
+  }
+  portEXIT_CRITICAL(&persistMux);
+  return changed;
 }
 
-static void deactivateRelay(const char *src)
+// Control task, after the queue is drained: a compare unless the levels changed
+static void persistRelays()
 {
-  digitalWrite(RELAY_PIN, LOW);
-  LOG("Relay OFF src=%s", src);
-  ui.setStatus("Relay OFF");
+  if (persistHandle && persistSnapshot()) xTaskNotifyGive(persistHandle);
 }
 
-// Momentary test (UI button)
-static void testRelayMomentary()
+// Low priority: appends the newest state (intermediate ones may be skipped),
+// then erases the sector the next wrap needs so no append waits on an erase
+static void persistTask(void *)
 {
-  activateRelay("ui_test");
-  delay(2000); // pulse length; adjust to taste
-  deactivateRelay("ui_test");
+  for (;;) {
+    PersistRequest r;
+    portENTER_CRITICAL(&persistMux);
+    r = persistWanted;
+    portEXIT_CRITICAL(&persistMux);
+    if (!relayState.save(r.levels, r.pulsing, r.src, r.epoch)) LOGW("Relay state not saved");
+    relayState.prepare();
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
 }
 
 // --- Named handlers for UI function pointers (no lambdas required) ---
-static void onUiTestRelay() { testRelayMomentary(); }
-static void onUiRelayOff()  { deactivateRelay("ui_button"); }
+// Buttons fire on the UI task; the request is handed to the control task,
+// which owns the relays.
+enum : uint8_t { UI_REQ_TEST_RELAY = 1, UI_REQ_RELAY_OFF = 2, UI_REQ_RELAY_ON = 4, UI_REQ_ALL_OFF = 8 };
+static std::atomic<uint8_t> uiRequests{0};
+static std::atomic<uint8_t> uiChannel{0};   // channel selected on the display
 
-static void onMqttMessage(char *topic, byte *payload, unsigned int length)
+// --- Control task messages: commands from the network task, UI wake-ups ---
+struct CtrlMsg
 {
-  String t(topic);
-  String p;
-  p.reserve(length + 1);
-  for (unsigned int i = 0; i < length; ++i) p += (char)payload[i];
+  const RelayCommand *cmd;      // nullptr: UI request (bits in uiRequests)
+  const char *src;
+  MqttMethodResult *result;     // written before *done and the waiter's notification
+  std::atomic<bool> *done;
+  TaskHandle_t waiter;
+};
+static QueueHandle_t ctrlQueue;
 
-  LOG("MQTT RX topic=%s", t.c_str());
-  LOG("MQTT RX payload=%s", p.c_str());
+#if defined(TARGET_TFT_ESPI)
+static void wakeControl()
+{
+  const CtrlMsg m = {};
+  xQueueSend(ctrlQueue, &m, 0); // full queue: the control task is awake anyway
+}
 
-  if (t.startsWith("$iothub/methods/POST/"))
-  {
-    const String prefix("$iothub/methods/POST/");
-    int start = prefix.length();
-    int slash = t.indexOf('/', start);
-    String method = (slash > start) ? t.substring(start, slash) : "";
-    int ridPos = t.indexOf("?$rid=");
-    String rid = (ridPos > 0) ? t.substring(ridPos + 6) : "0";
-    int status = 404;
-    String body = "{'error':'method_not_found'}";
-
-    if (method == "activateRelay") {
-      activateRelay("direct_method");
-      status = 200; body = "{'status':'relay_on'}";
-    } else if (method == "relayOff") {
-      deactivateRelay("direct_method");
-      status = 200; body = "{'status':'relay_off'}";
+static void uiRequest(uint8_t req, uint8_t ch)
+{
+  uiChannel.store(ch);
+  uiRequests.fetch_or(req);
+  wakeControl();
+}
+static void onUiTestRelay(uint8_t ch) { uiRequest(UI_REQ_TEST_RELAY, ch); }
+static void onUiRelayOff(uint8_t ch)  { uiRequest(UI_REQ_RELAY_OFF, ch); }
+static void onUiRelayOn(uint8_t ch)   { uiRequest(UI_REQ_RELAY_ON, ch); }
+static void onUiAllOff()              { uiRequest(UI_REQ_ALL_OFF, uiChannel.load()); }
+#endif
+
+static void serviceUiRequests()
+{
+  uint8_t r = uiRequests.exchange(0);
+  if (!r) return;
+  const uint8_t ch = uiChannel.load();
+  if (r & UI_REQ_TEST_RELAY) relays.onFor(ch, RELAY_TEST_PULSE_MS, "ui_test", millis());
+  if (r & UI_REQ_RELAY_ON)   relays.on(ch, "ui_long_press");
+  if (r & UI_REQ_RELAY_OFF)  relays.off(ch, "ui_button");
+  if (r & UI_REQ_ALL_OFF)    relays.setMask(0, RELAY_ALL, "ui_all_off");
+}
+
+// --- Commands (direct methods and C2D share one decoder and executor) ---
+static MqttMethodResult executeCommand(const RelayCommand &c, const char *src)
+{
+  latency.dispatched();
+  const RelayMask m = c.targets();
+  switch (c.verb) {
+    case CmdVerb::RelayOn:
+      relays.setMask(m, 0, src);
+      if ((relays.levels() & m) != m) return { 409, "{\"error\":\"interlocked\"}" };
+      return { 200, "{\"status\":\"relay_on\"}" };
+    case CmdVerb::RelayOff:
+      relays.setMask(0, m, src);
+      return { 200, "{\"status\":\"relay_off\"}" };
+    case CmdVerb::Pulse:
+      if (!relays.onForMask(m, c.hasDuration ? c.durationMs : RELAY_TEST_PULSE_MS, src, millis()))
+        return { 409, "{\"error\":\"interlocked\"}" }; // duration already range-checked
+      return { 200, "{\"status\":\"relay_pulse\"}" };
+    case CmdVerb::Cancel:
+      if (!relays.cancelMask(m)) return { 409, "{\"error\":\"no_pulse_pending\"}" };
+      LOG("Relay pulse cancelled mask=0x%lx src=%s", (unsigned long)m, src);
+      return { 200, "{\"status\":\"pulse_cancelled\"}" };
+    case CmdVerb::Set: {
+      const RelayMask on = c.hasMask && c.hasLevels ? (c.levels & m) : (c.state ? m : 0);
+      relays.setMask(on, m & ~on, src);
+      if ((relays.levels() & m) != on) return { 409, "{\"error\":\"interlocked\"}" };
+      return { 200, on ? "{\"status\":\"relay_on\"}" : "{\"status\":\"relay_off\"}" };
     }
+    default:
+      return { 400, cmdErrorBody(CmdError::MissingCmd) };
+  }
+}
+
+// Network task: the command runs on the control task; waits for its result
+static MqttMethodResult controlCall(const RelayCommand &c, const char *src)
+{
+  MqttMethodResult result = { 503, "{\"error\":\"busy\"}" };
+  std::atomic<bool> done{false};
+  const CtrlMsg m = { &c, src, &result, &done, xTaskGetCurrentTaskHandle() };
+  if (xQueueSend(ctrlQueue, &m, pdMS_TO_TICKS(100)) != pdTRUE) {
+    LOGW("control queue full; %s dropped", src);
+    return result;
+  }
+  while (!done.load(std::memory_order_acquire)) ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  return result;
+}
 
-    String resp = String("$iothub/methods/res/") + status + "/?$rid=" + rid;
-    mqtt.publish(resp.c_str(), body.c_str());
+static void handleControl(const CtrlMsg &m)
+{
+  if (!m.cmd) return; // UI wake-up: serviced by the loop
+  *m.result = executeCommand(*m.cmd, m.src);
+  m.done->store(true, std::memory_order_release);
+  xTaskNotifyGive(m.waiter);
+}
+
+// Method name picks the verb; the payload carries parameters (may be empty)
+static MqttMethodResult runMethod(CmdVerb verb, az_span payload)
+{
+  RelayCommand c;
+  CmdError e = decodeCommand(payload, c, false);
+  c.verb = verb;
+  if (e == CmdError::None && verb == CmdVerb::Set && !cmdHasSetParams(c)) e = CmdError::MissingParam;
+  if (e != CmdError::None) {
+    LOG("Method %s rejected: %s", cmdVerbName(verb), cmdErrorName(e));
+    return { 400, cmdErrorBody(e) };
+  }
+  return controlCall(c, "direct_method");
+}
+
+static MqttMethodResult onMethodActivateRelay(az_span p) { return runMethod(CmdVerb::RelayOn, p); }
+static MqttMethodResult onMethodRelayOff(az_span p)      { return runMethod(CmdVerb::RelayOff, p); }
+static MqttMethodResult onMethodPulseRelay(az_span p)    { return runMethod(CmdVerb::Pulse, p); }
+static MqttMethodResult onMethodCancelPulse(az_span p)   { return runMethod(CmdVerb::Cancel, p); }
+static MqttMethodResult onMethodSetRelay(az_span p)      { return runMethod(CmdVerb::Set, p); }
+
+static const MqttMethodRoute kMethodRoutes[] = {
+  MQTT_METHOD("activateRelay", onMethodActivateRelay),
+  MQTT_METHOD("relayOff",      onMethodRelayOff),
+  MQTT_METHOD("pulseRelay",    onMethodPulseRelay),
+  MQTT_METHOD("cancelPulse",   onMethodCancelPulse),
+  MQTT_METHOD("setRelay",      onMethodSetRelay),
+};
+
+static void onC2dMessage(az_span payload)
+{
+  RelayCommand c;
+  const CmdError e = decodeCommand(payload, c, true);
+  if (e != CmdError::None) {
+    LOG("C2D rejected: %s", cmdErrorName(e));
     return;
   }
+  const MqttMethodResult r = controlCall(c, "c2d");
+  LOG("C2D %s mask=0x%lx requestId=%s status=%d", cmdVerbName(c.verb), (unsigned long)c.targets(),
+      dlog::Str{ (const char *)az_span_ptr(c.requestId), (size_t)az_span_size(c.requestId) }, r.status);
+}
 
-  if (t.startsWith("devices/") && t.indexOf("/messages/devicebound") > 0)
-  {
-    if (p.indexOf("{'cmd':'activateRelay'}") >= 0) {
-      activateRelay("c2d");
-    } else if (p.indexOf("{'cmd':'relayOff'}") >= 0) {
-      deactivateRelay("c2d");
-    } else {
-      LOG("C2D payload unrecognized");
-    }
+// Replies go out from preallocated buffers (no heap on the method path)
+static MqttMethodResponder responder(&hubClient, mqtt);
+
+static void onMethodReply(az_span rid, int status, const char *body)
+{
+  if (!responder.reply(rid, status, body)) LOGE("method reply %d failed", status);
+  latency.responded();
+  const MqttReplyStats &s = responder.stats();
+  if (s.replies % 1000 == 0) {
+    LOG("Method replies=%lu failed=%lu avg=%luus max=%luus bytes/reply=%lu heapDrops=%lu",
+        (unsigned long)s.replies, (unsigned long)s.failed, (unsigned long)(s.totalUs / s.replies),
+        (unsigned long)s.maxUs, (unsigned long)(s.bytesCopied / s.replies), (unsigned long)s.heapDrops);
   }
 }
 
-static void connectWiFi()
+static void onTwinResponse(const az_iot_hub_client_twin_response &r, az_span)
 {
-  ui.logInfo("Connecting WiFi...");
-  Serial.begin(115200);
-  delay(50);
-  LOG("WiFi SSID='%s'", WIFI_SSID);
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(WIFI_SSID, WIFI_PASS);
-  while (WiFi.status() != WL_CONNECTED) { delay(250); }
-  ui.setStatus("WiFi connected");
-  LOG("WiFi IP=%s RSSI=%d", WiFi.localIP().toString().c_str(), WiFi.RSSI());
+  twin.onResponse(r, millis());
+  if (r.response_type == AZ_IOT_HUB_CLIENT_TWIN_RESPONSE_TYPE_REPORTED_PROPERTIES && (int)r.status == 429) {
+    LOGW("Twin update throttled; interval=%lums", (unsigned long)twin.intervalMs());
+  }
+}
+
+static MqttTopicRouter router(&hubClient, kMethodRoutes, onC2dMessage, onMethodReply, onTwinResponse);
+
+// 'payload' is PubSubClient's (truncated) copy; the body comes from rxStream
+static void onMqttMessage(char *topic, byte *, unsigned int)
+{
+  latency.received();
+  az_span body;
+  const bool kept = rxStream.finish(body);
+  const unsigned int length = (unsigned int)az_span_size(body);
+  LOG("MQTT RX topic=%s", topic);
+  if (rxStream.topicRejected()) {
+    LOGW("MQTT RX topic longer than %u bytes dropped", (unsigned)(MQTT_HEADER_BUF - 7));
+  } else if (!kept) {
+    LOGW("MQTT RX payload rejected (%lu bytes, pool %u/%u blocks in use)", (unsigned long)rxStream.received(),
+         (unsigned)rxPool.inUse(), (unsigned)MQTT_RX_BLOCKS);
+  }
+  LOGD("MQTT RX payload=%.*s", (int)length, dlog::Str{ (const char *)az_span_ptr(body), length });
+
+  if (!router.route(topic, az_span_ptr(body), length, !kept)) {
+    LOG("MQTT RX topic unmatched");
+  }
+  rxStream.release();
+  latency.done();
+}
+
+// --- Latency telemetry: histograms go out on the D2C topic, then restart ---
+static char telemetryTopic[MQTT_TOPIC_MAX];
+static char eventsTopic[MQTT_TOPIC_MAX];   // telemetry topic with $.ct=application/cbor
+static uint32_t lastLatencyReportMs = 0;
+
+static void publishLatencyIfDue()
+{
+  const uint32_t now = millis();
+  if (now - lastLatencyReportMs < LAT_REPORT_S * 1000UL) return;
+  lastLatencyReportMs = now;
+  if (!latency.samples()) return;
 
-  ui.logInfo("WiFi connected");
-  ui.setStatus("WiFi connected");
+  static constexpr size_t BODY = 768;
+  char *body = msgArena.chars(BODY);
+  if (!body) {
+    LOGW("latency telemetry skipped: scratch arena full");
+    return;
+  }
+  const size_t n = latency.report(body, BODY);
+  if (!n || !mqttPublish(mqtt, telemetryTopic, (const uint8_t *)body, n)) {
+    LOGE("latency telemetry publish failed (%u bytes)", (unsigned)n);
+    return;
+  }
+  const LatencyHistogram &d = latency.stage(LatStage::Dispatch), &g = latency.stage(LatStage::Gpio),
+                         &r = latency.stage(LatStage::Response);
+  LOG("Latency n=%lu p99 rx->dispatch=%luus dispatch->gpio=%luus gpio->resp=%luus", (unsigned long)d.count(),
+      (unsigned long)d.percentile(99), (unsigned long)g.percentile(99), (unsigned long)r.percentile(99));
+  latency.reset();
+}
+
+// --- Task metrics: CPU share since the last report, stack high-water marks ---
+static void publishTaskStatsIfDue()
+{
+  static uint32_t lastMs = 0;
+  const uint32_t now = millis();
+  if (now - lastMs < TASK_REPORT_S * 1000UL) return;
+  const uint32_t windowMs = now - lastMs;
+  lastMs = now;
+
+  static constexpr size_t BODY = 576;
+  char *body = msgArena.chars(BODY);
+  if (!body) {
+    LOGW("task telemetry skipped: scratch arena full");
+    return;
+  }
+  const size_t n = taskStatsReport(body, BODY, kTaskMeters, sizeof(kTaskMeters) / sizeof(kTaskMeters[0]), windowMs);
+  if (!n || !mqttPublish(mqtt, telemetryTopic, (const uint8_t *)body, n)) {
+    LOGE("task telemetry publish failed (%u bytes)", (unsigned)n);
+  }
+  const SocketWaitStats &w = netWait.stats();
+  LOG("Task stack free net=%lu ctrl=%lu ui=%lu; net wakes socket=%lu notify=%lu idle=%lu",
+      (unsigned long)netMeter.stackFree(), (unsigned long)ctrlMeter.stackFree(), (unsigned long)uiMeter.stackFree(),
+      (unsigned long)w.readable, (unsigned long)w.woken, (unsigned long)w.timeouts);
+
+  const MqttRxStats &rx = rxStream.stats();
+  const EventStats &ev = events.stats();
+  const uint32_t perMsgX10 = ev.messages ? ev.events * 10 / ev.messages : 0;
+  const uint32_t bytesPerEventX10 = ev.events ? (uint32_t)((uint64_t)ev.bytes * 10 / ev.events) : 0;
+  const int m = snprintf(body, BODY,
+                         "{\"mqtt_rx\":{\"msgs\":%lu,\"largest\":%lu,\"oversize\":%lu,\"no_blocks\":%lu,"
+                         "\"long_topic\":%lu,\"blocks_peak\":%u,\"blocks\":%u,\"block\":%u},"
+                         "\"router\":{\"methods\":%lu,\"unknown\":%lu,\"c2d\":%lu,\"twin\":%lu,\"unmatched\":%lu,"
+                         "\"rejected\":%lu},"
+                         "\"events\":{\"msgs\":%lu,\"events\":%lu,\"bytes\":%lu,\"per_msg_x10\":%lu,"
+                         "\"bytes_per_event_x10\":%lu,\"dropped\":%lu,\"folded\":%lu,\"failed\":%lu,\"max_backlog\":%lu}}",
+                         (unsigned long)rx.messages, (unsigned long)rx.largest, (unsigned long)rx.oversize,
+                         (unsigned long)rx.noBlocks, (unsigned long)rx.longTopic, (unsigned)rx.blocksPeak, (unsigned)MQTT_RX_BLOCKS,
+                         (unsigned)MQTT_RX_BLOCK, (unsigned long)router.methodsRouted, (unsigned long)router.methodsUnknown,
+                         (unsigned long)router.c2dRouted, (unsigned long)router.twinRouted,
+                         (unsigned long)router.topicsUnmatched, (unsigned long)router.payloadsRejected, (unsigned long)ev.messages, (unsigned long)ev.events,
+                         (unsigned long)ev.bytes, (unsigned long)perMsgX10, (unsigned long)bytesPerEventX10,
+                         (unsigned long)ev.dropped, (unsigned long)ev.folded, (unsigned long)ev.failed,
+                         (unsigned long)ev.maxBacklog);
+  if (m <= 0 || (size_t)m >= BODY || !mqttPublish(mqtt, telemetryTopic, (const uint8_t *)body, (size_t)m)) {
+    LOGE("rx/event telemetry publish failed");
+  }
+  LOG("MQTT RX msgs=%lu largest=%lu oversize=%lu no_blocks=%lu peak=%u/%u blocks", (unsigned long)rx.messages,
+      (unsigned long)rx.largest, (unsigned long)rx.oversize, (unsigned long)rx.noBlocks, (unsigned)rx.blocksPeak,
+      (unsigned)MQTT_RX_BLOCKS);
+  LOG("Events msgs=%lu events/msg=%lu.%lu bytes/event=%lu.%lu dropped=%lu folded=%lu backlog=%lu",
+      (unsigned long)ev.messages, (unsigned long)(perMsgX10 / 10), (unsigned long)(perMsgX10 % 10),
+      (unsigned long)(bytesPerEventX10 / 10), (unsigned long)(bytesPerEventX10 % 10), (unsigned long)ev.dropped,
+      (unsigned long)ev.folded, (unsigned long)events.backlog());
+}
+
+// --- Boot timeline: logged and sent once, when the first subscribe completes ---
+static void publishBootTimeline()
+{
+  static constexpr size_t BODY = 256;
+  char *body = msgArena.chars(BODY);
+  if (!body) {
+    LOGW("boot telemetry skipped: scratch arena full");
+    return;
+  }
+  const size_t n = bootTimeline.report(body, BODY, FAST_BOOT);
+  const FastBootStats &fb = fastBoot.stats();
+  LOG("Boot to subscribed %lums (directed=%d lease=%d seeded=%d scans=%lu)",
+      (unsigned long)bootTimeline.ms(BootPhase::Subscribed), fb.directed, fb.leaseReused, fb.clockSeeded,
+      (unsigned long)fb.fallbacks);
+  LOG("Boot phases %s", body);
+  if (!n || !mqttPublish(mqtt, telemetryTopic, (const uint8_t *)body, n)) {
+    LOGE("boot telemetry publish failed (%u bytes)", (unsigned)n);
+  }
+}
+
+// --- Event telemetry: one CBOR message per window or full batch; held while offline ---
+static void publishEventsIfDue()
+{
+  static uint32_t lastRssiMs = 0;
+  static bool rssiOnce = false;
+  const uint32_t now = millis();
+  if (!rssiOnce || now - lastRssiMs >= EVENT_RSSI_S * 1000UL) {
+    rssiOnce = true;
+    lastRssiMs = now;
+    events.rssi((int8_t)WiFi.RSSI(), now);
+  }
+  if (!events.due(now)) return;
+
+  uint8_t *body = (uint8_t *)msgArena.alloc(EVENT_BATCH_BYTES, 1);
+  if (!body) {
+    LOGW("event telemetry skipped: scratch arena full");
+    return;
+  }
+  const time_t epoch = time(nullptr);
+  const EventBatch b = events.encode(body, EVENT_BATCH_BYTES, now, fastBoot.clockUsable() ? (uint32_t)epoch : 0);
+  if (!b.bytes) return;
+  if (!mqttPublish(mqtt, eventsTopic, body, b.bytes)) {
+    events.failed(now);
+    LOGE("event telemetry publish failed (%lu events, %u bytes)", (unsigned long)b.count, (unsigned)b.bytes);
+    return;
+  }
+  events.sent(b, now);
+  LOGD("Events sent n=%lu bytes=%u dropped=%lu backlog=%lu", (unsigned long)b.count, (unsigned)b.bytes,
+       (unsigned long)b.dropped, (unsigned long)events.backlog());
+}
+
+// --- Heap: free / largest block, allocations per subsystem (HEAP_STATS), arena use ---
+static void publishHeapStatsIfDue()
+{
+  static uint32_t lastMs = 0;
+  const uint32_t now = millis();
+  if (now - lastMs < HEAP_REPORT_S * 1000UL) return;
+  lastMs = now;
+
+  static const NamedArena arenas[] = { { "msg", &msgArena }, { "frame", &ui.frameArena() } };
+  static constexpr size_t BODY = 512;
+  char *body = msgArena.chars(BODY);
+  if (!body) {
+    LOGW("heap telemetry skipped: scratch arena full");
+    return;
+  }
+  const size_t n = heapStatsReport(body, BODY, arenas, sizeof(arenas) / sizeof(arenas[0]));
+  for (size_t i = 0; i < n; i += 128) { // log records hold ~190 bytes
+    const size_t k = n - i < 128 ? n - i : 128;
+    LOG("Heap %.*s", (int)k, dlog::Str{ body + i, k });
+  }
+  if (!n || !mqttPublish(mqtt, telemetryTopic, (const uint8_t *)body, n)) {
+    LOGE("heap telemetry publish failed (%u bytes)", (unsigned)n);
+  }
+}
+
+// --- Connectivity state machine steps (each call returns within a few ms) ---
+static char mqttUser[256];
+static char mqttClientId[128];
+static constexpr uint32_t SAS_TTL_MIN = 60;
+static constexpr uint32_t SAS_RENEW_BEFORE_S = 300;
+static constexpr uint32_t SAS_PREGEN_BEFORE_S = 600; // next token is computed while still online
+static constexpr uint32_t MQTT_NTP_WAIT_MS = 10000;   // on a seeded clock, how long CONNECT waits for NTP
+
+static UiLinkMetrics linkMetrics; // IP/RSSI on join, TLS timing per handshake
+
+static ConnStep stepWiFi(bool entered)
+{
+  if (WiFi.status() == WL_CONNECTED)
   {
-    char buf[96];
-    snprintf(buf, sizeof(buf), "SSID=%s IP=%s RSSI=%d",
-             WIFI_SSID, WiFi.localIP().toString().c_str(), WiFi.RSSI());
-    ui.showTelemetry(buf);
+    bootTimeline.mark(BootPhase::WiFiUp);
+    fastBoot.remember(); // AP, channel and lease for the next boot
+    ui.setLink(UiLink::WiFi, LinkState::Up);
+    const IPAddress ip = WiFi.localIP();
+    for (uint8_t i = 0; i < 4; ++i) linkMetrics.ip[i] = ip[i];
+    linkMetrics.rssi = (int8_t)WiFi.RSSI();
+    LOG("WiFi SSID=%s IP=%u.%u.%u.%u RSSI=%d ch=%d", WIFI_SSID, ip[0], ip[1], ip[2], ip[3], (int)linkMetrics.rssi,
+        (int)WiFi.channel());
+    ui.showMetrics(linkMetrics);
+    return ConnStep::Done;
   }
+  if (entered && !fastBoot.associating()) // setup() may have started the join already
+  {
+    ui.logInfo("Connecting WiFi...");
+    ui.setLink(UiLink::WiFi, LinkState::Connecting);
+    LOG("WiFi SSID='%s'", WIFI_SSID);
+    WiFi.disconnect();
+    WiFi.mode(WIFI_STA);
+#if FAST_BOOT
+    fastBoot.beginWiFi(WIFI_SSID, WIFI_PASS, millis());
+#else
+    WiFi.begin(WIFI_SSID, WIFI_PASS);
+#endif
+    bootTimeline.mark(BootPhase::WiFiStart);
+  }
+  fastBoot.pollWiFi(millis());
+  return ConnStep::Pending;
 }
 
-static void setupTime()
+static ConnStep stepTime(bool entered)
 {
-  ui.logInfo("Syncing NTP time...");
-  LOG("NTP sync start");
-  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+  static bool synced = false, seeded = false;
   time_t now = time(NULL);
-  while (now < 1609459200) { delay(250); now = time(NULL); }
-  ui.setStatus("Time synced");
-  LOG("NTP synced epoch=%lu", (unsigned long)now);
+  if (fastBoot.clockUsable()) // NTP, the RTC, or a seed the hub has not refused yet
+  {
+    if (fastBoot.clockProvisional())
+    {
+      if (!seeded)
+      {
+        seeded = true;
+        LOG("Clock seeded epoch=%lu (provisional until NTP)", (unsigned long)now);
+      }
+    }
+    else if (!synced)
+    {
+      synced = true;
+      ui.setLink(UiLink::Time, LinkState::Up);
+      LOG("NTP synced epoch=%lu", (unsigned long)now);
+    }
+    bootTimeline.mark(BootPhase::Time);
+    return ConnStep::Done;
+  }
+  if (entered)
+  {
+    ui.setLink(UiLink::Time, LinkState::Connecting);
+    LOG("NTP sync start");
+    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+  }
+  return ConnStep::Pending;
 }
 
-static bool buildMqttCredentials()
+// Signs a new SAS when the current one is missing or expiring; needs a trusted clock
+static bool renewSas()
+{
+  if (!sas.IsExpiringSoon(SAS_RENEW_BEFORE_S)) return true;
+  ui.logInfo("Renewing SAS...");
+  LOG("Generating SAS (60m)");
+  if (az_result_failed(sas.Generate(SAS_TTL_MIN)))
+  {
+    ui.logError("SAS generate failed");
+    LOGE("SAS generate failed");
+    return false;
+  }
+  LOG("SAS size=%u gen=%luus", (unsigned)az_span_size(sas.Get()), (unsigned long)sas.LastGenerateUs());
+  ui.showTelemetry("SAS OK (60m)");
+  return true;
+}
+
+static ConnStep stepCredentials(bool)
 {
   LOG("Init IoT Hub client");
   if (az_result_failed(az_iot_hub_client_init(&hubClient, host, deviceId, NULL)))
   {
     ui.logError("hub_client_init failed");
-    LOG("ERROR: hub_client_init failed");
-    return false;
+    LOGE("hub_client_init failed");
+    return ConnStep::Failed;
   }
 
-  char username[256]; size_t ulen = 0;
-  if (az_result_failed(azure_compat::get_user_name(&hubClient, username, sizeof(username), &ulen)))
+  size_t ulen = 0;
+  if (az_result_failed(azure_compat::get_user_name(&hubClient, mqttUser, sizeof(mqttUser), &ulen)))
   {
     ui.logError("get_user_name failed");
-    LOG("ERROR: get_user_name failed");
-    return false;
+    LOGE("get_user_name failed");
+    return ConnStep::Failed;
   }
-  String mqtt_user(username, ulen);
   LOG("MQTT username len=%u", (unsigned)ulen);
 
-  char client_id[128]; size_t clen = 0;
-  if (az_result_failed(azure_compat::get_client_id(&hubClient, client_id, sizeof(client_id), &clen)))
+  size_t clen = 0;
+  if (az_result_failed(azure_compat::get_client_id(&hubClient, mqttClientId, sizeof(mqttClientId), &clen)))
   {
     ui.logError("get_client_id failed");
-    LOG("ERROR: get_client_id failed");
-    return false;
+    LOGE("get_client_id failed");
+    return ConnStep::Failed;
   }
-  String mqtt_cid(client_id, clen);
-  LOG("MQTT clientId='%s'", mqtt_cid.c_str());
+  LOG("MQTT clientId='%s'", mqttClientId);
 
-  LOG("Generating SAS (60m)");
-  if (az_result_failed(sas.Generate(60)))
+  if (!responder.prepare(DEVICE_ID))
   {
-    ui.logError("SAS generate failed");
-    LOG("ERROR: SAS generate failed");
-    return false;
+    LOGE("C2D topic too long");
+    return ConnStep::Failed;
   }
-  String mqtt_pass((char *)az_span_ptr(sas.Get()), az_span_size(sas.Get()));
-  LOG("SAS size=%u", (unsigned)mqtt_pass.length());
 
-  net.setCACert(CA_BUNDLE_PEM);
-  LOG("TLS CA bundle loaded");
+  size_t tlen = 0;
+  uint8_t propBuf[64];
+  az_iot_message_properties props;
+  if (az_result_failed(azure_compat::telemetry_get_publish_topic(&hubClient, telemetryTopic, sizeof(telemetryTopic), &tlen)) ||
+      az_result_failed(az_iot_message_properties_init(&props, AZ_SPAN_FROM_BUFFER(propBuf), 0)) ||
+      az_result_failed(az_iot_message_properties_append(&props, AZ_SPAN_FROM_STR("$.ct"), AZ_SPAN_FROM_STR("application%2Fcbor"))) ||
+      az_result_failed(az_iot_message_properties_append(&props, AZ_SPAN_FROM_STR("kind"), AZ_SPAN_FROM_STR("events"))) ||
+      az_result_failed(azure_compat::telemetry_get_publish_topic(&hubClient, &props, eventsTopic, sizeof(eventsTopic), &tlen)))
+  {
+    LOGE("telemetry topic failed");
+    return ConnStep::Failed;
+  }
 
-  mqtt.setServer(IOTHUB_HOST, 8883);
-  mqtt.setKeepAlive(120);
-  mqtt.setBufferSize(1024);
-  mqtt.setCallback(onMqttMessage);
+  // A seeded clock only unblocks WiFi and TLS: the SAS waits for NTP (stepMqtt)
+  if (!fastBoot.clockProvisional() && !renewSas()) return ConnStep::Failed;
+  bootTimeline.mark(BootPhase::Credentials);
+  return ConnStep::Done;
+}
 
-  ui.setStatus("Connecting MQTT...");
+// TLS handshake on its own step so PubSubClient::connect() reuses the socket.
+// Note: the handshake itself is a single blocking call (resumed when possible).
+static ConnStep stepTls(bool)
+{
+  net.setCACert(CA_BUNDLE_PEM);
+  LOG("TLS connect host=%s:%u", IOTHUB_HOST, (unsigned)IOTHUB_PORT);
+  rxGuard.reset(); // new stream: framing starts at a packet boundary
+  if (!net.connect(IOTHUB_HOST, IOTHUB_PORT))
+  {
+    ui.logError("TLS connect failed");
+    LOGE("TLS connect failed; err=-0x%04x", -net.lastError());
+    if (net.lastError() == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) fastBoot.distrustClock(); // seed outside cert validity
+    return ConnStep::Failed;
+  }
+  bootTimeline.mark(BootPhase::Tls);
+  const TlsHandshakeStats &hs = net.stats();
+  LOG("TLS handshake %lums (%s) full=%lu resumed=%lu", (unsigned long)hs.lastMs,
+      hs.lastWasResumed ? "resumed" : "full", (unsigned long)hs.full, (unsigned long)hs.resumed);
+  linkMetrics.tlsMs = (uint16_t)(hs.lastMs < 0xFFFF ? hs.lastMs : 0xFFFF);
+  linkMetrics.tlsResumed = hs.lastWasResumed;
+  ui.showMetrics(linkMetrics);
+  return ConnStep::Done;
+}
+
+static ConnStep stepMqtt(bool entered)
+{
+  // The seed is the newest relay record's time, possibly hours old: a SAS signed
+  // on it is refused, so CONNECT waits (TLS already up) for NTP to replace it
+  static uint32_t waitStartMs = 0;
+  if (entered) waitStartMs = millis();
+  if (fastBoot.clockProvisional())
+  {
+    if (millis() - waitStartMs < MQTT_NTP_WAIT_MS) return ConnStep::Pending;
+    LOGE("NTP not answering; MQTT waits in Time");
+    fastBoot.distrustClock();
+    net.stop();
+    return ConnStep::Failed;
+  }
+  if (!renewSas())
+  {
+    net.stop();
+    return ConnStep::Failed;
+  }
+  ui.setLink(UiLink::Mqtt, LinkState::Connecting);
   LOG("MQTT connect host=%s", IOTHUB_HOST);
-  if (!mqtt.connect(mqtt_cid.c_str(), mqtt_user.c_str(), mqtt_pass.c_str()))
+  const char *pass = (const char *)az_span_ptr(sas.Get());
+  if (!mqtt.connect(mqttClientId, mqttUser, pass))
   {
+    ui.setLink(UiLink::Mqtt, LinkState::Down);
     ui.logError("MQTT connect failed");
-    LOG("ERROR: MQTT connect failed; state=%d", mqtt.state());
-    return false;
+    LOGE("MQTT connect failed; state=%d", mqtt.state());
+    net.stop();
+    return ConnStep::Failed;
   }
-  ui.setStatus("MQTT connected");
+  bootTimeline.mark(BootPhase::Mqtt);
+  ui.setLink(UiLink::Mqtt, LinkState::Up);
   LOG("MQTT connected");
+  return ConnStep::Done;
+}
 
-  mqtt.subscribe("$iothub/methods/POST/#");
-  String c2d = String("devices/") + DEVICE_ID + "/messages/devicebound/#";
-  mqtt.subscribe(c2d.c_str());
-  LOG("Subscribed methods + %s", c2d.c_str());
-
-  ui.logInfo("MQTT connected");
+static ConnStep stepSubscribed(bool entered)
+{
+  if (entered)
   {
+    if (!mqtt.subscribe(responder.methodsTopic()) || !mqtt.subscribe(responder.c2dTopic()) ||
+        !mqtt.subscribe(twin.responseTopic()))
+    {
+      LOGE("subscribe failed");
+      mqtt.disconnect();
+      return ConnStep::Failed;
+    }
+    LOG("Subscribed methods + twin + %s", responder.c2dTopic());
+    twin.connected(); // the cloud learns the state again after every reconnect
+    if (!bootTimeline.reached(BootPhase::Subscribed))
+    {
+      HeapScope tag(HeapTag::Mqtt);
+      bootTimeline.mark(BootPhase::Subscribed);
+      publishBootTimeline();
+    }
+    ui.logInfo("MQTT connected");
     char buf[96];
     snprintf(buf, sizeof(buf), "Host=%s KeepAlive=%d", IOTHUB_HOST, 120);
     ui.showTelemetry(buf);
   }
-  return true;
+
+  if (!mqtt.connected())
+  {
+    ui.setLink(UiLink::Mqtt, LinkState::Down);
+    LOG("MQTT lost; state=%d", mqtt.state());
+    return ConnStep::Failed;
+  }
+  if (fastBoot.leaseExpired())
+  {
+    LOG("Reused WiFi lease is %us old; rejoin with DHCP", (unsigned)FASTBOOT_LEASE_S);
+    mqtt.disconnect();
+    WiFi.disconnect();
+    return ConnStep::Done; // voluntary: restart without backoff
+  }
+  if (sas.IsExpiringSoon(SAS_RENEW_BEFORE_S))
+  {
+    LOG("SAS expiring; reconnect (next token %s)", sas.HasNext() ? "ready" : "pending");
+    mqtt.disconnect();
+    return ConnStep::Done; // voluntary: restart without backoff
+  }
+  if (!sas.HasNext() && sas.IsExpiringSoon(SAS_PREGEN_BEFORE_S))
+  {
+    if (az_result_failed(sas.PrepareNext(SAS_TTL_MIN, SAS_PREGEN_BEFORE_S)))
+      LOGE("SAS pre-generation failed");
+    else
+      LOG("SAS next token ready gen=%luus", (unsigned long)sas.LastGenerateUs());
+  }
+  HeapScope tag(HeapTag::Mqtt);
+  twin.poll(millis());
+  publishLatencyIfDue();
+  publishTaskStatsIfDue();
+  publishHeapStatsIfDue();
+  publishEventsIfDue();
+  return ConnStep::Pending;
 }
 
-static bool ensureConnected()
+static void onConnTransition(ConnState from, ConnState to, uint32_t elapsedMs, bool failed)
 {
-  if (mqtt.connected() && !sas.IsExpiringSoon(300)) return true;
+  LOG("Conn %s -> %s after %lums%s", ConnectionFsm::name(from), ConnectionFsm::name(to),
+      (unsigned long)elapsedMs, failed ? " (failed)" : "");
+  events.link((uint8_t)from, (uint8_t)to, failed, millis());
+}
 
-  if (sas.IsExpiringSoon(300) || sas.IsExpired())
-  {
-    ui.logInfo("Renewing SAS...");
-    LOG("SAS renewing");
-    if (az_result_failed(sas.Generate(60)))
-    {
-      ui.logError("SAS renew failed");
-      LOG("ERROR: SAS renew failed");
-      return false;
-    }
-  }
+static const ConnStateConfig kConnStates[] = {
+  /* WiFi        */ { stepWiFi,        20000, ConnState::WiFi },
+  /* Time        */ { stepTime,        15000, ConnState::Time },
+  /* Credentials */ { stepCredentials, 0,     ConnState::Credentials },
+  /* Tls         */ { stepTls,         0,     ConnState::WiFi },
+  /* Mqtt        */ { stepMqtt,        0,     ConnState::WiFi },
+  /* Subscribed  */ { stepSubscribed,  0,     ConnState::WiFi },
+};
+static ConnectionFsm conn(kConnStates, onConnTransition);
 
-  LOG("Reconnect");
-  {
-    char buf[96];
-    snprintf(buf, sizeof(buf), "SAS OK (60m)");
-    ui.showTelemetry(buf);
+// Millisecond clock extended past its 49-day wrap (needs a call at least every 49 days)
+static uint32_t uptimeS()
+{
+  static uint32_t last = 0, wraps = 0;
+  const uint32_t now = millis();
+  if (now < last) wraps++;
+  last = now;
+  return (uint32_t)((((uint64_t)wraps << 32) | now) / 1000);
+}
+
+static void fillTwinReport(TwinReport &r)
+{
+  r.relays = drivenLevels.load(std::memory_order_relaxed);
+  r.channels = RELAY_CHANNELS;
+  r.uptimeS = uptimeS();
+  r.connects = conn.stats(ConnState::Subscribed).attempts;
+  for (uint8_t s = 0; s < (uint8_t)ConnState::Count; ++s) r.connFailures += conn.stats((ConnState)s).failures;
+  r.tlsFull = net.stats().full;
+  r.tlsResumed = net.stats().resumed;
+  r.rssi = WiFi.RSSI();
+}
+
+#if defined(UI_BENCH)
+static void runUiBenchmark()
+{
+#if defined(TARGET_TFT_ESPI)
+  const TftEspiUi::FrameStats before = display.frameStats();
+#endif
+  UiVirtual<UiSinkSet> erased(sinks);
+  MeteredUi bench(erased);
+  uiReplayBenchmark(bench, Serial, TARGET_NAME, 1000);
+#if defined(TARGET_TFT_ESPI)
+  const TftEspiUi::FrameStats &fs = display.frameStats();
+  const uint32_t frames = fs.frames - before.frames;
+  const uint32_t bytes = (uint32_t)(fs.totalBytes - before.totalBytes);
+  LOG("UI BENCH frames=%lu spiBytes=%lu bytes/frame=%lu maxFramePx=%lu", (unsigned long)frames,
+      (unsigned long)bytes, (unsigned long)(frames ? bytes / frames : 0), (unsigned long)fs.maxPixels);
+#endif
+#if defined(CADIOT_NATIVE)
+  uiBenchAllAdapters(Serial, 1000); // every adapter against the recording canvas
+#endif
+}
+#endif
+
+// Network task: FSM + MQTT; sleeps until the socket has data, another task wakes it, or a timeout
+static void netTask(void *)
+{
+  HeapScope tag(HeapTag::Net);
+  for (;;) {
+    netMeter.busy();
+    msgArena.reset();
+    if (twinDirty.exchange(false, std::memory_order_acquire)) twin.changed();
+    conn.tick(millis());
+    if (conn.online()) {
+      HeapScope mqttTag(HeapTag::Mqtt);
+      rxStream.begin(); // loop() reads at most one packet
+      mqtt.loop();
+    }
+    const bool online = conn.online();
+    netMeter.idle();
+    if (online && net.pendingBytes()) continue; // already decrypted: the socket will not signal it
+    netWait.wait(online ? net.socketFd() : -1, online ? NET_IDLE_MS : NET_STEP_MS);
   }
-  return buildMqttCredentials();
 }
 
 void setup()
 {
-  pinMode(RELAY_PIN, OUTPUT);
-  digitalWrite(RELAY_PIN, LOW);
+  relayBank.begin(); // all channels OFF in one write
+#if defined(RELAY_INTERLOCKS)
+  static const RelayMask interlocks[] = { RELAY_INTERLOCKS };
+  for (RelayMask g : interlocks) relayBank.addInterlock(g);
+#endif
+  restoreRelays(); // before anything slow: the relays are back within milliseconds of reset
+  bootTimeline.mark(BootPhase::Relays);
+#if defined(ESP_PLATFORM)
+  events.boot((uint8_t)esp_reset_reason(), relayBank.levels(), millis());
+#else
+  events.boot(0, relayBank.levels(), millis());
+#endif
+  ctrlQueue = xQueueCreate(CTRL_QUEUE_LEN, sizeof(CtrlMsg));
+#if FAST_BOOT
+  // Association and SNTP run in the WiFi/lwIP tasks while the UI and the SAS come up
+  fastBoot.seedClock(lastKnownEpoch);
+  WiFi.mode(WIFI_STA);
+  fastBoot.beginWiFi(WIFI_SSID, WIFI_PASS, millis());
+  configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+  bootTimeline.mark(BootPhase::WiFiStart);
+#endif
   Serial.begin(115200);
   delay(50);
+  dlog::begin(TARGET_NAME);
   LOG("Boot");
+  if (relayState.mounted()) {
+    const RelayStateLogStats &ps = relayState.stats();
+    LOG("Relay state restored=0x%lx mount=%luus torn=%lu", (unsigned long)restoredLevels,
+        (unsigned long)ps.mountUs, (unsigned long)ps.torn);
+  } else {
+    LOGW("Relay state: no 'relaystate' partition, not persisted");
+  }
 
+#if defined(TARGET_TFT_ESPI)
+  display.relayChannels = RELAY_CHANNELS; // layout depends on it
+#endif
+  ui.setMeter(&uiMeter);
+#if defined(UI_BENCH)
+  sinks.begin();
+  runUiBenchmark(); // synchronous, before the UI task owns the display
+  ui.start();
+#else
   ui.begin();
+#endif
+  uiMeter.attach(ui.taskHandle());
   LOG("UI begin");
+  bootTimeline.mark(BootPhase::Ui);
+  if (restoredLevels) relays.setMask(restoredLevels, 0, "restore"); // engine + status follow the GPIOs
+
+#if defined(CMD_BENCH)
+  cmdDecoderBenchmark(Serial);
+#endif
+#if defined(RELAY_BENCH)
+  relayBankBenchmark(Serial);
+#endif
+#if defined(PERSIST_BENCH)
+  relayStateLogBenchmark(Serial);
+#endif
+#if defined(SAS_BENCH)
+  sasTokenBenchmark(Serial);
+#endif
+#if defined(PULSE_BENCH)
+  relayPulseBenchmark(Serial);
+#endif
+#if defined(FSM_BENCH)
+  connectionFsmBenchmark(Serial);
+#endif
+#if defined(ASYNCUI_BENCH)
+  asyncUiBenchmark(Serial);
+#endif
+#if defined(MQTT_RX_BENCH)
+  mqttRxBenchmark(Serial);
+#endif
+#if defined(ROUTER_BENCH)
+  topicRouterBenchmark(Serial);
+#endif
+#if defined(TLS_BENCH)
+  // Needs the network: wait for the join (immediate on the host), then the hub or tools/hub_emulator.py
+#if !FAST_BOOT
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(WIFI_SSID, WIFI_PASS);
+#endif
+  for (const uint32_t t0 = millis(); WiFi.status() != WL_CONNECTED && millis() - t0 < 20000;) delay(100);
+  tlsResumptionBenchmark(Serial, IOTHUB_HOST, IOTHUB_PORT, CA_BUNDLE_PEM);
+#endif
 
   // --- Assign function pointers (NO brace-init; NO lambdas required) ---
 #if defined(TARGET_TFT_ESPI)
-  ui.onTestRelay = onUiTestRelay;
-  ui.onRelayOff  = onUiRelayOff;
+  display.onTestRelay = onUiTestRelay;
+  display.onRelayOn   = onUiRelayOn;
+  display.onRelayOff  = onUiRelayOff;
+  display.onAllOff    = onUiAllOff;
 #endif
 
-  connectWiFi();
-  setupTime();
-  buildMqttCredentials();
-}
+#if FAST_BOOT
+  // Hub client (+ SAS on a trusted clock) while the association is still in flight
+  if (fastBoot.clockUsable()) stepCredentials(false);
+#endif
 
-void loop()
-{
-  ensureConnected();
-  mqtt.loop();
+  // MQTT client set up once: setBufferSize() reallocates on every call
+  mqtt.setServer(IOTHUB_HOST, IOTHUB_PORT);
+  mqtt.setKeepAlive(120);
+  mqtt.setBufferSize(MQTT_HEADER_BUF); // header + topic only: payloads stream through rxStream
+  mqtt.setStream(rxStream);
+  mqtt.setCallback(onMqttMessage);
 
-#if defined(TARGET_M5CORES3)
-  M5.update(); // ensure touch/display services run on CoreS3
-#endif
+  conn.setBackoff(500, 60000, 25);
+  conn.begin(millis());
 
-#if defined(TARGET_TFT_ESPI)
-  ui.loop();   // poll touch & handle button presses
-#endif
+  // loop() becomes the control task; the network task takes over the connection
+  if (!netWait.begin()) LOGW("eventfd unavailable; network task polls every %lums", (unsigned long)NET_STEP_MS);
+  ctrlMeter.attach(xTaskGetCurrentTaskHandle());
+  vTaskPrioritySet(nullptr, CTRL_TASK_PRIORITY);
+  TaskHandle_t netHandle = nullptr;
+  xTaskCreatePinnedToCore(netTask, "net", NET_TASK_STACK, nullptr, NET_TASK_PRIORITY, &netHandle, NET_TASK_CORE);
+  netMeter.attach(netHandle);
+  if (relayState.mounted()) {
+    persistSnapshot(); // the restored state, not the initializer, is what the task sees first
+    xTaskCreate(persistTask, "persist", 3072, nullptr, PERSIST_TASK_PRIORITY, &persistHandle);
+  }
+}
 
-  delay(10);
+// Control task: sleeps until a command, a UI request or the next timed OFF
+void loop()
+{
+  HeapScope tag(HeapTag::Control);
+  const uint32_t due = relays.nextDueMs(millis());
+  CtrlMsg m;
+  const bool got = xQueueReceive(ctrlQueue, &m, pdMS_TO_TICKS(due < CTRL_IDLE_MS ? due : CTRL_IDLE_MS)) == pdTRUE;
+  ctrlMeter.busy();
+  if (got) handleControl(m);
+  relays.poll(millis());
+  serviceUiRequests(); // button presses forwarded by the UI task
+  if (!uxQueueMessagesWaiting(ctrlQueue)) persistRelays();
+  ctrlMeter.idle();
 }
\ No newline at end of file
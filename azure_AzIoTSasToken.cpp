@@ -2,19 +2,8 @@
 #include <time.h>
 #include <string.h>
 #include <mbedtls/base64.h>
-#include <mbedtls/md.h>
 
 static uint64_t now() { return (uint64_t)time(NULL); }
-static void hmac(az_span k, az_span p, az_span o)
-{
-    mbedtls_md_context_t c;
-    mbedtls_md_init(&c);
-    mbedtls_md_setup(&c, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
-    mbedtls_md_hmac_starts(&c, (const unsigned char *)az_span_ptr(k), az_span_size(k));
-    mbedtls_md_hmac_update(&c, (const unsigned char *)az_span_ptr(p), az_span_size(p));
-    mbedtls_md_hmac_finish(&c, (unsigned char *)az_span_ptr(o));
-    mbedtls_md_free(&c);
-}
 static az_result b64e(az_span s, az_span d, az_span *o)
 {
     size_t n = 0;
@@ -24,43 +13,201 @@ static az_result b64e(az_span s, az_span d, az_span *o)
     *o = az_span_slice(d, 0, (int)n);
     return AZ_OK;
 }
-AzIoTSasToken::AzIoTSasToken(az_iot_hub_client *c, az_span dk, az_span sb, az_span tb) : client(c), deviceKey(dk), signatureBuffer(sb), sasTokenBuffer(tb), sasToken(AZ_SPAN_EMPTY), expirationUnixTime(0) {}
-az_result AzIoTSasToken::Generate(unsigned int m)
+AzIoTSasToken::AzIoTSasToken(az_iot_hub_client *c, az_span dk, az_span sb, az_span tb, az_span nb) : client(c), deviceKey(dk), signatureBuffer(sb), sasTokenBuffer(tb), nextTokenBuffer(nb), sasToken(AZ_SPAN_EMPTY), nextToken(AZ_SPAN_EMPTY), expirationUnixTime(0), nextExpirationUnixTime(0), lastGenerateUs(0), keyReady(false)
 {
-    uint64_t e = now() + (uint64_t)(m * 60ULL);
-    expirationUnixTime = e;
-    uint8_t buf[256];
-    az_span to = AZ_SPAN_FROM_BUFFER(buf);
-    az_span out;
-    az_result r = az_iot_hub_client_sas_get_signature(client, e, to, &out);
-    if (az_result_failed(r))
-        return r;
-    to = out;
+    mbedtls_md_init(&hmacCtx);
+}
+AzIoTSasToken::~AzIoTSasToken() { mbedtls_md_free(&hmacCtx); }
+az_result AzIoTSasToken::PrepareKey()
+{
+    if (keyReady)
+        return AZ_OK;
     size_t dl = 0;
     int rc = mbedtls_base64_decode((unsigned char *)az_span_ptr(signatureBuffer), (size_t)az_span_size(signatureBuffer), &dl, (const unsigned char *)az_span_ptr(deviceKey), (size_t)az_span_size(deviceKey));
-#ifdef MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL if (rc == MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL) return AZ_ERROR_NOT_ENOUGH_SPACE;
-#endif if (rc != 0) return AZ_ERROR_ARG;
-    az_span dk = az_span_slice(signatureBuffer, 0, (int)dl);
-    az_span ho = az_span_slice(signatureBuffer, 0, 32);
-    hmac(dk, to, ho);
-    if ((int)dl > 32)
+#ifdef MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL
+    if (rc == MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL)
+        return AZ_ERROR_NOT_ENOUGH_SPACE;
+#endif
+    if (rc != 0)
+        return AZ_ERROR_ARG;
+    if (mbedtls_md_setup(&hmacCtx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1) != 0 ||
+        mbedtls_md_hmac_starts(&hmacCtx, (const unsigned char *)az_span_ptr(signatureBuffer), dl) != 0)
     {
-        uint8_t *p = az_span_ptr(signatureBuffer);
-        memset(p + 32, 0, (int)dl - 32);
+        // md_setup allocates; release it so the next attempt starts from a clean context
+        mbedtls_md_free(&hmacCtx);
+        mbedtls_md_init(&hmacCtx);
+        memset(az_span_ptr(signatureBuffer), 0, dl);
+        return AZ_ERROR_ARG;
     }
-    uint8_t sbuf[256];
+    // The keyed context keeps its own ipad/opad; the plain key is no longer needed.
+    memset(az_span_ptr(signatureBuffer), 0, dl);
+    keyReady = true;
+    return AZ_OK;
+}
+az_result AzIoTSasToken::Build(uint64_t e, az_span dst, az_span *out)
+{
+    uint32_t t0 = micros();
+    az_result r = PrepareKey();
+    if (az_result_failed(r))
+        return r;
+    uint8_t buf[256];
+    az_span to = AZ_SPAN_FROM_BUFFER(buf);
+    az_span o;
+    r = az_iot_hub_client_sas_get_signature(client, e, to, &o);
+    if (az_result_failed(r))
+        return r;
+    to = o;
+    uint8_t mac[32];
+    if (mbedtls_md_hmac_reset(&hmacCtx) != 0 ||
+        mbedtls_md_hmac_update(&hmacCtx, (const unsigned char *)az_span_ptr(to), az_span_size(to)) != 0 ||
+        mbedtls_md_hmac_finish(&hmacCtx, mac) != 0)
+        return AZ_ERROR_ARG;
+    uint8_t sbuf[64];
     az_span bs = AZ_SPAN_FROM_BUFFER(sbuf);
-    r = b64e(ho, bs, &out);
+    r = b64e(az_span_create(mac, sizeof(mac)), bs, &o);
     if (az_result_failed(r))
         return r;
-    bs = out;
+    bs = o;
     size_t pl = 0;
-    r = az_iot_hub_client_sas_get_password(client, e, bs, AZ_SPAN_EMPTY, (char *)az_span_ptr(sasTokenBuffer), (size_t)az_span_size(sasTokenBuffer), &pl);
+    r = az_iot_hub_client_sas_get_password(client, e, bs, AZ_SPAN_EMPTY, (char *)az_span_ptr(dst), (size_t)az_span_size(dst), &pl);
+    if (az_result_failed(r))
+        return r;
+    *out = az_span_slice(dst, 0, (int)pl);
+    lastGenerateUs = micros() - t0;
+    return AZ_OK;
+}
+az_result AzIoTSasToken::Generate(unsigned int m)
+{
+    // Use the pre-generated token when it still has most of its lifetime left.
+    if (nextExpirationUnixTime != 0 && nextExpirationUnixTime > now() + (uint64_t)(m * 30ULL))
+    {
+        az_span t = sasTokenBuffer;
+        sasTokenBuffer = nextTokenBuffer;
+        nextTokenBuffer = t;
+        sasToken = nextToken;
+        expirationUnixTime = nextExpirationUnixTime;
+        nextToken = AZ_SPAN_EMPTY;
+        nextExpirationUnixTime = 0;
+        return AZ_OK;
+    }
+    nextExpirationUnixTime = 0;
+    uint64_t e = now() + (uint64_t)(m * 60ULL);
+    az_result r = Build(e, sasTokenBuffer, &sasToken);
+    if (az_result_failed(r))
+        return r;
+    expirationUnixTime = e;
+    return AZ_OK;
+}
+az_result AzIoTSasToken::PrepareNext(unsigned int m, unsigned int s)
+{
+    if (az_span_size(nextTokenBuffer) == 0 || HasNext() || !IsExpiringSoon(s))
+        return AZ_OK;
+    uint64_t e = now() + (uint64_t)(m * 60ULL);
+    az_result r = Build(e, nextTokenBuffer, &nextToken);
     if (az_result_failed(r))
         return r;
-    sasToken = az_span_slice(sasTokenBuffer, 0, (int)pl);
+    nextExpirationUnixTime = e;
     return AZ_OK;
 }
 bool AzIoTSasToken::IsExpired() const { return now() >= expirationUnixTime; }
 bool AzIoTSasToken::IsExpiringSoon(unsigned int s) const { return now() + (uint64_t)s >= expirationUnixTime; }
-az_span AzIoTSasToken::Get() const { return sasToken; }
\ No newline at end of file
+az_span AzIoTSasToken::Get() const { return sasToken; }
+
+#if defined(SAS_BENCH)
+// --- Benchmark: per-token key decode + HMAC setup (before) vs the cached keyed context ---
+static const char kBenchKey[] = "AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8="; // 32 bytes 0x00..0x1f
+
+// The pre-cache path: decode the key and set up a fresh HMAC context for every token
+static az_result legacyToken(az_iot_hub_client *c, az_span key, uint64_t e, az_span keyBuf, az_span dst, az_span *out)
+{
+    uint8_t buf[256];
+    az_span sig;
+    az_result r = az_iot_hub_client_sas_get_signature(c, e, AZ_SPAN_FROM_BUFFER(buf), &sig);
+    if (az_result_failed(r))
+        return r;
+    size_t dl = 0;
+    if (mbedtls_base64_decode(az_span_ptr(keyBuf), (size_t)az_span_size(keyBuf), &dl, az_span_ptr(key), (size_t)az_span_size(key)) != 0)
+        return AZ_ERROR_ARG;
+    uint8_t mac[32];
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    int rc = mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+    if (rc == 0)
+        rc = mbedtls_md_hmac_starts(&ctx, az_span_ptr(keyBuf), dl);
+    if (rc == 0)
+        rc = mbedtls_md_hmac_update(&ctx, az_span_ptr(sig), (size_t)az_span_size(sig));
+    if (rc == 0)
+        rc = mbedtls_md_hmac_finish(&ctx, mac);
+    mbedtls_md_free(&ctx);
+    memset(az_span_ptr(keyBuf), 0, dl);
+    if (rc != 0)
+        return AZ_ERROR_ARG;
+    uint8_t sbuf[64];
+    az_span b;
+    r = b64e(az_span_create(mac, sizeof(mac)), AZ_SPAN_FROM_BUFFER(sbuf), &b);
+    if (az_result_failed(r))
+        return r;
+    size_t pl = 0;
+    r = az_iot_hub_client_sas_get_password(c, e, b, AZ_SPAN_EMPTY, (char *)az_span_ptr(dst), (size_t)az_span_size(dst), &pl);
+    if (az_result_failed(r))
+        return r;
+    *out = az_span_slice(dst, 0, (int)pl);
+    return AZ_OK;
+}
+
+void sasTokenBenchmark(Print &out, uint32_t iterations)
+{
+    static constexpr unsigned int TTL_MIN = 60;
+    az_iot_hub_client c;
+    if (az_result_failed(az_iot_hub_client_init(&c, AZ_SPAN_FROM_STR("bench.azure-devices.net"), AZ_SPAN_FROM_STR("bench"), NULL)))
+    {
+        out.printf("[SAS BENCH] FAIL hub client init\n");
+        return;
+    }
+    const az_span key = az_span_create((uint8_t *)kBenchKey, (int32_t)sizeof(kBenchKey) - 1);
+    static uint8_t sig[128], tok[256], next[256], legacyKey[128], legacyTok[256];
+    AzIoTSasToken sas(&c, key, AZ_SPAN_FROM_BUFFER(sig), AZ_SPAN_FROM_BUFFER(tok), AZ_SPAN_FROM_BUFFER(next));
+
+    // Same token both ways (retried if the second ticks over between the two)
+    bool same = false;
+    for (uint8_t tries = 0; tries < 3 && !same; ++tries)
+    {
+        const uint64_t t = now();
+        az_span b;
+        if (az_result_failed(sas.Generate(TTL_MIN)) || now() != t ||
+            az_result_failed(legacyToken(&c, key, t + TTL_MIN * 60ULL, AZ_SPAN_FROM_BUFFER(legacyKey), AZ_SPAN_FROM_BUFFER(legacyTok), &b)))
+            continue;
+        same = az_span_is_content_equal(sas.Get(), b);
+    }
+
+    uint32_t failures = same ? 0 : 1;
+    uint32_t t0 = micros();
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        az_span o;
+        if (az_result_failed(legacyToken(&c, key, now() + TTL_MIN * 60ULL, AZ_SPAN_FROM_BUFFER(legacyKey), AZ_SPAN_FROM_BUFFER(legacyTok), &o)))
+            failures++;
+    }
+    const uint32_t beforeUs = micros() - t0;
+    t0 = micros();
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        if (az_result_failed(sas.Generate(TTL_MIN)))
+            failures++;
+    }
+    const uint32_t afterUs = micros() - t0;
+
+    // Renewal with a pre-generated token: Generate() only swaps buffers
+    if (az_result_failed(sas.PrepareNext(TTL_MIN, TTL_MIN * 60 + 1)) || !sas.HasNext())
+        failures++;
+    t0 = micros();
+    if (az_result_failed(sas.Generate(TTL_MIN)) || sas.HasNext())
+        failures++;
+    const uint32_t swapUs = micros() - t0;
+
+    out.printf("[SAS BENCH] tokens=%lu same=%d failures=%lu\n", (unsigned long)iterations, same, (unsigned long)failures);
+    out.printf("[SAS BENCH] before=%luns/token (decode+setup per token) after=%luns/token swap=%luus\n",
+               (unsigned long)(iterations ? (uint64_t)beforeUs * 1000 / iterations : 0),
+               (unsigned long)(iterations ? (uint64_t)afterUs * 1000 / iterations : 0), (unsigned long)swapUs);
+}
+#endif
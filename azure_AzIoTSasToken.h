@@ -4,22 +4,46 @@
 #include <az_iot_hub_client.h>
 #include <az_span.h>
 #include <az_result.h>
+#include <mbedtls/md.h>
 
 class AzIoTSasToken
 {
 public:
-    AzIoTSasToken(az_iot_hub_client *c, az_span dk, az_span sb, az_span tb);
+    // nb (optional): second token buffer used to pre-generate the next token.
+    AzIoTSasToken(az_iot_hub_client *c, az_span dk, az_span sb, az_span tb, az_span nb = AZ_SPAN_EMPTY);
+    ~AzIoTSasToken();
     az_result Generate(unsigned int m);
+    // Pre-computes the next token once the current one is within s seconds of
+    // expiry; the following Generate() then just swaps it in. Cheap no-op otherwise.
+    az_result PrepareNext(unsigned int m, unsigned int s);
+    bool HasNext() const { return nextExpirationUnixTime != 0; }
     bool IsExpired() const;
     bool IsExpiringSoon(unsigned int s = 300) const;
     az_span Get() const;
+    uint32_t LastGenerateUs() const { return lastGenerateUs; }
 
 private:
+    az_result PrepareKey();
+    az_result Build(uint64_t e, az_span dst, az_span *out);
+
     az_iot_hub_client *client;
     az_span deviceKey;
     az_span signatureBuffer;
     az_span sasTokenBuffer;
+    az_span nextTokenBuffer;
     az_span sasToken;
+    az_span nextToken;
     uint64_t expirationUnixTime;
+    uint64_t nextExpirationUnixTime;
+    uint32_t lastGenerateUs;
+    // Decoded key lives in signatureBuffer; HMAC context is keyed once and reset per token.
+    mbedtls_md_context_t hmacCtx;
+    bool keyReady;
 };
-#endif
\ No newline at end of file
+
+#if defined(SAS_BENCH)
+// Token cost with a per-token key decode + HMAC setup (the pre-cache path) vs
+// Generate() with the keyed context, plus a pre-generated swap; prints to 'out'
+void sasTokenBenchmark(Print &out, uint32_t iterations = 200);
+#endif
+#endif
@@ -20,4 +20,10 @@ namespace azure_compat
   {
     return az_iot_hub_client_telemetry_get_publish_topic(client, nullptr, out, out_size, out_len);
   }
+  // With message properties, e.g. $.ct (content type) for non-JSON bodies
+  inline az_result telemetry_get_publish_topic(const az_iot_hub_client *client, const az_iot_message_properties *props,
+                                               char *out, size_t out_size, size_t *out_len)
+  {
+    return az_iot_hub_client_telemetry_get_publish_topic(client, props, out, out_size, out_len);
+  }
 }
@@ -0,0 +1,26 @@
+#include "diag_BootTimeline.h"
+#include "diag_Json.h"
+
+void BootTimeline::mark(BootPhase p)
+{
+  if (!at[(uint8_t)p]) at[(uint8_t)p] = millis() + 1;
+}
+
+const char *BootTimeline::name(BootPhase p)
+{
+  static const char *const names[] = { "relays", "wifi_start", "ui", "wifi_up", "time",
+                                       "credentials", "tls", "mqtt", "subscribed" };
+  static_assert(sizeof(names) / sizeof(names[0]) == (size_t)BootPhase::Count, "one name per phase");
+  return (uint8_t)p < (uint8_t)BootPhase::Count ? names[(uint8_t)p] : "?";
+}
+
+size_t BootTimeline::report(char *out, size_t size, bool fast) const
+{
+  size_t len = 0;
+  if (!jsonAppend(out, size, len, 0, "{\"boot\":{\"fast\":%d", fast ? 1 : 0)) return 0;
+  for (uint8_t p = 0; p < (uint8_t)BootPhase::Count; ++p) {
+    if (at[p] && !jsonAppend(out, size, len, 0, ",\"%s\":%lu", name((BootPhase)p), (unsigned long)(at[p] - 1))) return 0;
+  }
+  if (!jsonAppend(out, size, len, 0, "}}")) return 0;
+  return len;
+}
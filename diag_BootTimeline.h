@@ -0,0 +1,37 @@
+#pragma once
+#include <Arduino.h>
+
+// Boot timeline: milliseconds since app start at which each boot phase first
+// completed. Later reconnects do not move the marks, so the report compares
+// boot-to-subscribed across builds and boots (fast boot vs full scan + NTP).
+
+enum class BootPhase : uint8_t
+{
+    Relays = 0,   // relay state restored
+    WiFiStart,    // association requested
+    Ui,           // display up
+    WiFiUp,       // associated with an IP
+    Time,         // wall clock usable (seeded or NTP)
+    Credentials,  // hub client + SAS ready
+    Tls,          // handshake done
+    Mqtt,         // CONNACK
+    Subscribed,
+    Count
+};
+
+class BootTimeline
+{
+public:
+    void mark(BootPhase p);
+    bool reached(BootPhase p) const { return at[(uint8_t)p] != 0; }
+    uint32_t ms(BootPhase p) const { return at[(uint8_t)p] ? at[(uint8_t)p] - 1 : 0; }
+
+    // {"boot":{"fast":1,"relays":3,"wifi_start":4,...}} (reached phases only);
+    // returns the length, 0 if it did not fit
+    size_t report(char *out, size_t size, bool fast) const;
+
+    static const char *name(BootPhase p);
+
+private:
+    uint32_t at[(uint8_t)BootPhase::Count] = {}; // ms + 1; 0 = not reached
+};
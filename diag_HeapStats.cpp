@@ -0,0 +1,129 @@
+#include "diag_HeapStats.h"
+#include "diag_Json.h"
+#include <atomic>
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+#endif
+
+static thread_local HeapTag taskTag = HeapTag::Other;
+
+HeapScope::HeapScope(HeapTag t) : prev(taskTag) { taskTag = t; }
+HeapScope::~HeapScope() { taskTag = prev; }
+
+const char *heapTagName(HeapTag t)
+{
+  switch (t) {
+    case HeapTag::Net:     return "net";
+    case HeapTag::Mqtt:    return "mqtt";
+    case HeapTag::Control: return "ctrl";
+    case HeapTag::Ui:      return "ui";
+    default:               return "other";
+  }
+}
+
+#if defined(HEAP_STATS)
+// --- Allocator wrappers (-Wl,--wrap=...): count, then forward ---
+struct TagCounters
+{
+    std::atomic<uint32_t> allocs{0};
+    std::atomic<uint32_t> frees{0};
+    std::atomic<uint32_t> bytes{0};
+    std::atomic<uint32_t> max{0};   // largest single request
+};
+static TagCounters counters[(uint8_t)HeapTag::Count];
+
+static void countAlloc(size_t n)
+{
+  TagCounters &c = counters[(uint8_t)taskTag];
+  c.allocs.fetch_add(1, std::memory_order_relaxed);
+  c.bytes.fetch_add((uint32_t)n, std::memory_order_relaxed);
+  uint32_t m = c.max.load(std::memory_order_relaxed);
+  while (n > m && !c.max.compare_exchange_weak(m, (uint32_t)n, std::memory_order_relaxed)) {}
+}
+
+static void countFree() { counters[(uint8_t)taskTag].frees.fetch_add(1, std::memory_order_relaxed); }
+
+extern "C" {
+void *__real_malloc(size_t n);
+void __real_free(void *p);
+void *__real_calloc(size_t count, size_t n);
+void *__real_realloc(void *p, size_t n);
+
+void *__wrap_malloc(size_t n)
+{
+  void *p = __real_malloc(n);
+  if (p) countAlloc(n);
+  return p;
+}
+
+void __wrap_free(void *p)
+{
+  if (p) countFree();
+  __real_free(p);
+}
+
+void *__wrap_calloc(size_t count, size_t n)
+{
+  void *p = __real_calloc(count, n);
+  if (p) countAlloc(count * n);
+  return p;
+}
+
+void *__wrap_realloc(void *p, size_t n)
+{
+  void *q = __real_realloc(p, n);
+  if (p && (q || !n)) countFree();
+  if (q && n) countAlloc(n);
+  return q;
+}
+}
+
+bool heapStatsCounting() { return true; }
+uint32_t heapTagAllocs(HeapTag t) { return counters[(uint8_t)t].allocs.load(std::memory_order_relaxed); }
+#else
+bool heapStatsCounting() { return false; }
+uint32_t heapTagAllocs(HeapTag) { return 0; }
+#endif
+
+size_t heapStatsReport(char *out, size_t size, const NamedArena arenas[], uint8_t count)
+{
+#if defined(ESP_PLATFORM)
+  const uint32_t freeNow = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  const uint32_t minFree = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  const uint32_t largest = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+#else
+  const uint32_t freeNow = 0, minFree = 0, largest = 0; // native build: use valgrind/heaptrack instead
+#endif
+  static uint32_t minLargest = UINT32_MAX;
+  if (largest < minLargest) minLargest = largest;
+
+  size_t len = 0;
+
+  if (!jsonAppend(out, size, len, 0, "{\"heap\":{\"free\":%lu,\"min_free\":%lu,\"largest\":%lu,\"min_largest\":%lu",
+                  (unsigned long)freeNow, (unsigned long)minFree, (unsigned long)largest, (unsigned long)minLargest))
+    return 0;
+#if defined(HEAP_STATS)
+  if (!jsonAppend(out, size, len, 0, ",\"tags\":{")) return 0;
+  for (uint8_t t = 0; t < (uint8_t)HeapTag::Count; ++t) {
+    TagCounters &c = counters[t];
+    const uint32_t allocs = c.allocs.exchange(0, std::memory_order_relaxed);
+    const uint32_t frees = c.frees.exchange(0, std::memory_order_relaxed);
+    const uint32_t bytes = c.bytes.exchange(0, std::memory_order_relaxed);
+    const uint32_t max = c.max.exchange(0, std::memory_order_relaxed);
+    if (!jsonAppend(out, size, len, 0, "%s\"%s\":{\"allocs\":%lu,\"frees\":%lu,\"bytes\":%lu,\"max\":%lu}",
+                    t ? "," : "", heapTagName((HeapTag)t), (unsigned long)allocs, (unsigned long)frees, (unsigned long)bytes,
+                    (unsigned long)max))
+      return 0;
+  }
+  if (!jsonAppend(out, size, len, 0, "}")) return 0;
+#endif
+  if (!jsonAppend(out, size, len, 0, ",\"arenas\":{")) return 0;
+  for (uint8_t i = 0; i < count; ++i) {
+    const ArenaStats &s = arenas[i].arena->stats();
+    if (!jsonAppend(out, size, len, 0, "%s\"%s\":{\"cap\":%lu,\"peak\":%lu,\"overflows\":%lu}", i ? "," : "",
+                    arenas[i].name, (unsigned long)arenas[i].arena->capacity(), (unsigned long)s.peak, (unsigned long)s.overflows))
+      return 0;
+  }
+  if (!jsonAppend(out, size, len, 0, "}}}")) return 0;
+  return len;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <Arduino.h>
+#include "mem_ScratchArena.h"
+
+// Heap health and allocation counts per subsystem.
+// Free heap, its low-water mark and the largest free block are always
+// reported (the largest block shrinking over weeks is fragmentation).
+// Built with -D HEAP_STATS and the allocator wrapped at link time
+//   -Wl,--wrap=malloc -Wl,--wrap=free -Wl,--wrap=calloc -Wl,--wrap=realloc
+// every malloc/free is also counted against the tag of the calling task
+// (HeapScope), so steady-state allocations show up by subsystem. Allocations
+// the IDF makes with heap_caps_* directly (Wi-Fi driver) are only visible in
+// the free/largest numbers.
+
+enum class HeapTag : uint8_t
+{
+    Other = 0,  // setup, library tasks
+    Net,        // connection FSM: Wi-Fi, TLS, SAS
+    Mqtt,       // PubSubClient loop, routing, replies, telemetry
+    Control,    // relay commands, persistence
+    Ui,         // UI task rendering
+    Count
+};
+
+// Tags the current task's allocations until destroyed (nests)
+class HeapScope
+{
+public:
+    explicit HeapScope(HeapTag t);
+    ~HeapScope();
+    HeapScope(const HeapScope &) = delete;
+    HeapScope &operator=(const HeapScope &) = delete;
+
+private:
+    HeapTag prev;
+};
+
+const char *heapTagName(HeapTag t);
+bool heapStatsCounting();   // true when the allocator is wrapped (HEAP_STATS)
+// Allocations counted against 't' since its last report (0 without HEAP_STATS);
+// the difference across a code path shows whether it allocates
+uint32_t heapTagAllocs(HeapTag t);
+
+struct NamedArena
+{
+    const char *name;
+    const ScratchArena *arena;
+};
+
+// {"heap":{"free":..,"min_free":..,"largest":..,"min_largest":..,
+//   "tags":{"net":{"allocs":..,"frees":..,"bytes":..,"max":..},...},
+//   "arenas":{"msg":{"cap":..,"peak":..,"overflows":..},...}}}
+// Tag counters cover the window since the last report ("tags" only with
+// HEAP_STATS). Returns the length, 0 if it did not fit.
+size_t heapStatsReport(char *out, size_t size, const NamedArena arenas[], uint8_t count);
@@ -0,0 +1,17 @@
+#include "diag_Json.h"
+#include <stdarg.h>
+
+bool jsonAppend(char *out, size_t size, size_t &len, size_t reserve, const char *fmt, ...)
+{
+  if (len >= size) return false;
+  va_list args;
+  va_start(args, fmt);
+  const int w = vsnprintf(out + len, size - len, fmt, args);
+  va_end(args);
+  if (w < 0 || len + (size_t)w + reserve >= size) {
+    out[len] = '\0'; // drop the partial piece
+    return false;
+  }
+  len += (size_t)w;
+  return true;
+}
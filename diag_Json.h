@@ -0,0 +1,12 @@
+#pragma once
+#include <Arduino.h>
+
+// Bounded printf-append for the JSON bodies (and status text) built in place
+// by the diag_* reports and the UI. All of them share one rule: a piece that
+// does not fit is left out whole, never cut in the middle.
+
+// Appends at out + len and advances len, unless the text plus 'reserve' bytes
+// (closers still to come) would not fit in 'size' with its terminator. On
+// failure nothing is appended: out[len] is '\0' again and false is returned.
+bool jsonAppend(char *out, size_t size, size_t &len, size_t reserve, const char *fmt, ...)
+    __attribute__((format(printf, 5, 6)));
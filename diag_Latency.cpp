@@ -0,0 +1,113 @@
+#include "diag_Latency.h"
+#include "diag_Json.h"
+
+// --- LatencyHistogram ---
+
+uint8_t LatencyHistogram::bucketOf(uint32_t us)
+{
+  if (us < SUBS) return (uint8_t)us;
+  const uint8_t e = 31 - __builtin_clz(us);
+  if (e >= MAX_EXP) return BUCKETS - 1;
+  const uint8_t sub = (us >> (e - SUB_BITS)) & (SUBS - 1);
+  return (uint8_t)((e - SUB_BITS + 1) * SUBS + sub);
+}
+
+uint32_t LatencyHistogram::bucketHigh(uint8_t i)
+{
+  if (i < SUBS) return i;
+  const uint8_t e = i / SUBS + SUB_BITS - 1;
+  const uint32_t width = 1UL << (e - SUB_BITS);
+  return ((uint32_t)(SUBS + i % SUBS) << (e - SUB_BITS)) + width - 1;
+}
+
+void LatencyHistogram::record(uint32_t us)
+{
+  counts[bucketOf(us)]++;
+  n++;
+  if (us > maxUs) maxUs = us;
+}
+
+void LatencyHistogram::reset()
+{
+  memset(counts, 0, sizeof(counts));
+  n = 0;
+  maxUs = 0;
+}
+
+uint32_t LatencyHistogram::percentile(uint8_t pct) const
+{
+  if (!n) return 0;
+  const uint32_t rank = (uint32_t)(((uint64_t)n * pct + 99) / 100);
+  uint32_t seen = 0;
+  for (uint8_t i = 0; i < BUCKETS; ++i) {
+    seen += counts[i];
+    if (seen >= rank) return std::min(bucketHigh(i), maxUs);
+  }
+  return maxUs;
+}
+
+// --- CommandLatency ---
+
+void CommandLatency::stamp(uint32_t &from, LatStage s, uint32_t now)
+{
+  hist[(uint8_t)s].record(now - from);
+}
+
+void CommandLatency::received()
+{
+  tRx = nowUs();
+  reached = RX;
+}
+
+void CommandLatency::dispatched()
+{
+  if (!(reached & RX)) return;
+  tDispatch = nowUs();
+  reached |= DISPATCH;
+  stamp(tRx, LatStage::Dispatch, tDispatch);
+}
+
+void CommandLatency::actuated()
+{
+  if (!(reached & DISPATCH) || (reached & GPIO)) return; // first port write only
+  tGpio = nowUs();
+  reached |= GPIO;
+  stamp(tDispatch, LatStage::Gpio, tGpio);
+}
+
+void CommandLatency::responded()
+{
+  if (!(reached & GPIO)) return;
+  stamp(tGpio, LatStage::Response, nowUs());
+}
+
+void CommandLatency::reset()
+{
+  for (LatencyHistogram &h : hist) h.reset();
+}
+
+size_t CommandLatency::report(char *out, size_t size) const
+{
+  static const char *const names[] = { "rx_dispatch", "dispatch_gpio", "gpio_resp" };
+  static constexpr size_t SUMMARY_MAX = 112; // one stage without buckets, closers included
+  static constexpr uint8_t STAGES = (uint8_t)LatStage::Count;
+  size_t len = 0;
+
+  if (!jsonAppend(out, size, len, STAGES * SUMMARY_MAX, "{\"lat\":{")) return 0;
+  for (uint8_t s = 0; s < STAGES; ++s) {
+    const LatencyHistogram &h = hist[s];
+    const size_t later = (STAGES - s) * SUMMARY_MAX; // this stage's closers + later stages
+    jsonAppend(out, size, len, 0, "%s\"%s\":{\"n\":%lu,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu,\"b\":[", s ? "," : "",
+               names[s], (unsigned long)h.count(), (unsigned long)h.percentile(50),
+               (unsigned long)h.percentile(90), (unsigned long)h.percentile(99), (unsigned long)h.max());
+    bool first = true;
+    for (uint8_t i = 0; i < LatencyHistogram::BUCKETS; ++i) {
+      if (!h.bucket(i)) continue;
+      if (!jsonAppend(out, size, len, later, "%s%u,%lu", first ? "" : ",", (unsigned)i, (unsigned long)h.bucket(i))) break;
+      first = false;
+    }
+    jsonAppend(out, size, len, 0, "]}");
+  }
+  jsonAppend(out, size, len, 0, "}}");
+  return len;
+}
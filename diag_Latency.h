@@ -0,0 +1,75 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+
+// Command-path latency: MQTT receive -> dispatch -> GPIO -> method response.
+// Stages are stamped with micros() (esp_timer: one clock for both cores, as
+// receive/response run on the network task and dispatch/GPIO on loop()) and
+// fed into fixed-size log-linear histograms in microseconds: 4 linear
+// sub-buckets per power of two, so every bucket is within 25% of its value.
+
+class LatencyHistogram
+{
+public:
+    static constexpr uint8_t SUB_BITS = 2;
+    static constexpr uint8_t SUBS = 1 << SUB_BITS;
+    static constexpr uint8_t MAX_EXP = 24;                 // >= 2^24 us (~16.8 s) lands in the last bucket
+    static constexpr uint8_t BUCKETS = (MAX_EXP - 1) * SUBS;
+
+    void record(uint32_t us);
+    void reset();
+
+    uint32_t count() const { return n; }
+    uint32_t max() const { return maxUs; }
+    uint32_t bucket(uint8_t i) const { return counts[i]; }
+    uint32_t percentile(uint8_t pct) const;   // upper bound of the bucket holding it
+
+    static uint8_t bucketOf(uint32_t us);
+    static uint32_t bucketHigh(uint8_t i);   // largest value that maps to bucket i
+
+private:
+    uint32_t counts[BUCKETS] = {};
+    uint32_t n = 0;
+    uint32_t maxUs = 0;
+};
+
+enum class LatStage : uint8_t
+{
+    Dispatch,  // packet handed to the app -> command executor
+    Gpio,      // executor -> relay port write
+    Response,  // port write -> method response published
+    Count
+};
+
+// One command in flight at a time: the network task stamps receive/response
+// and waits while the control task stamps dispatch/GPIO.
+// Stages not reached before done() (C2D has no response, a refused command
+// no port write) are simply not recorded.
+class CommandLatency
+{
+public:
+    void received();
+    void dispatched();
+    void actuated();
+    void responded();
+    void done() { reached = 0; }
+
+    const LatencyHistogram &stage(LatStage s) const { return hist[(uint8_t)s]; }
+    uint32_t samples() const { return hist[0].count(); }
+    void reset();
+
+    // {"lat":{"rx_dispatch":{"n":N,"p50":..,"p90":..,"p99":..,"max":..,"b":[i,c,...]},...}}
+    // in us; "b" lists non-empty buckets (index, count) for fleet-side merging and
+    // stops early if 'size' runs out. Returns the length, 0 if even the summary did not fit.
+    size_t report(char *out, size_t size) const;
+
+private:
+    // Not ESP.getCycleCount(): each core has its own cycle counter
+    static uint32_t nowUs() { return micros(); }
+    void stamp(uint32_t &from, LatStage s, uint32_t now);
+
+    LatencyHistogram hist[(uint8_t)LatStage::Count];
+    uint32_t tRx = 0, tDispatch = 0, tGpio = 0;
+    enum : uint8_t { RX = 1, DISPATCH = 2, GPIO = 4 };
+    std::atomic<uint8_t> reached{0}; // read by pulse/UI writes while a command arrives
+};
@@ -0,0 +1,33 @@
+#include "diag_TaskStats.h"
+#include "diag_Json.h"
+
+void TaskMeter::busy()
+{
+  since = micros();
+  running = true;
+  wakeCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TaskMeter::idle()
+{
+  if (!running) return;
+  running = false;
+  busyUs.fetch_add(micros() - since, std::memory_order_relaxed);
+}
+
+size_t taskStatsReport(char *out, size_t size, TaskMeter *const meters[], uint8_t count, uint32_t windowMs)
+{
+  size_t len = 0;
+
+  if (!jsonAppend(out, size, len, 0, "{\"tasks\":{")) return 0;
+  for (uint8_t i = 0; i < count; ++i) {
+    TaskMeter &m = *meters[i];
+    const uint32_t us = m.takeBusyUs();
+    const uint32_t pct = windowMs ? (uint32_t)((uint64_t)us / 10 / windowMs) : 0; // us / (ms * 1000) * 100
+    if (!jsonAppend(out, size, len, 0, "%s\"%s\":{\"cpu\":%lu,\"busy_us\":%lu,\"wakes\":%lu,\"stack_free\":%lu}",
+                    i ? "," : "", m.name, (unsigned long)pct, (unsigned long)us, (unsigned long)m.wakes(), (unsigned long)m.stackFree()))
+      return 0;
+  }
+  if (!jsonAppend(out, size, len, 0, "},\"window_ms\":%lu}", (unsigned long)windowMs)) return 0;
+  return len;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Per-task CPU and stack metrics. Each task brackets its work with
+// busy()/idle() (one timer read each); the report turns busy time into a
+// CPU share of the window since the last report. Stack high-water marks
+// come from FreeRTOS (bytes on the ESP32; 0 in the native build).
+
+class TaskMeter
+{
+public:
+    explicit TaskMeter(const char *taskName) : name(taskName) {}
+
+    void attach(TaskHandle_t h) { handle = h; }  // before the task runs (stack metric)
+    void busy();   // woke up
+    void idle();   // about to block
+
+    const char *const name;
+    TaskHandle_t task() const { return handle; }
+    uint32_t stackFree() const { return handle ? (uint32_t)uxTaskGetStackHighWaterMark(handle) : 0; }
+    uint32_t wakes() const { return wakeCount.load(std::memory_order_relaxed); }
+
+    // Busy us since the last call, then restarts the window
+    uint32_t takeBusyUs() { return busyUs.exchange(0, std::memory_order_relaxed); }
+
+private:
+    TaskHandle_t handle = nullptr;
+    uint32_t since = 0;
+    bool running = false;
+    std::atomic<uint32_t> busyUs{0};
+    std::atomic<uint32_t> wakeCount{0};
+};
+
+// {"tasks":{"net":{"cpu":3,"busy_us":..,"wakes":..,"stack_free":..},...},"window_ms":N}
+// Restarts every meter's window. Returns the length, 0 if it did not fit.
+size_t taskStatsReport(char *out, size_t size, TaskMeter *const meters[], uint8_t count, uint32_t windowMs);
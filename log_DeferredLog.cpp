@@ -0,0 +1,226 @@
+#include "log_DeferredLog.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+namespace dlog
+{
+  static_assert((LOG_RING_BYTES & (LOG_RING_BYTES - 1)) == 0, "LOG_RING_BYTES must be a power of two");
+
+  static uint8_t s_ring[LOG_RING_BYTES];
+  static uint32_t s_head = 0;   // producer position (monotonic)
+  static uint32_t s_tail = 0;   // consumer position (monotonic)
+  static uint32_t s_dropped = 0, s_written = 0, s_highWater = 0;
+  static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+  static TaskHandle_t s_task = nullptr;
+  static const char *s_tag = "";
+
+  static void ringCopyIn(uint32_t pos, const uint8_t *p, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i) s_ring[(pos + i) & (LOG_RING_BYTES - 1)] = p[i];
+  }
+
+  static void ringCopyOut(uint32_t pos, uint8_t *p, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i) p[i] = s_ring[(pos + i) & (LOG_RING_BYTES - 1)];
+  }
+
+  void enc(Writer &w, const char *s)
+  {
+    if (!s) s = "(null)";
+    enc(w, Str{ s, strlen(s) });
+  }
+
+  void enc(Writer &w, Str str)
+  {
+    const char *s = str.p;
+    size_t len = s ? str.n : 0;
+    // Truncate to what still fits: tag + length byte + bytes + NUL
+    size_t room = sizeof(w.buf) - w.n;
+    if (room < 3) return;
+    if (len > room - 3) len = room - 3;
+    if (len > 254) len = 254;
+    uint8_t hdr[2] = { T_STR, (uint8_t)(len + 1) };
+    w.put(hdr, 2);
+    w.put(s, len);
+    w.buf[w.n++] = '\0';
+  }
+
+  void commit(Writer &w, uint8_t level, const char *fmt)
+  {
+    const uint32_t ms = millis();
+    const uintptr_t addr = (uintptr_t)fmt;
+    w.buf[0] = SYNC;
+    w.buf[1] = level;
+    memcpy(w.buf + 2, &w.n, 2);
+    memcpy(w.buf + 4, &ms, 4);
+    memcpy(w.buf + 8, &addr, sizeof(addr));
+
+    bool ok;
+    portENTER_CRITICAL(&s_mux);
+    uint32_t used = s_head - s_tail;
+    ok = used + w.n <= LOG_RING_BYTES;
+    if (ok) {
+      ringCopyIn(s_head, w.buf, w.n);
+      s_head += w.n;
+      s_written++;
+      used += w.n;
+      if (used > s_highWater) s_highWater = used;
+    } else {
+      s_dropped++;
+    }
+    portEXIT_CRITICAL(&s_mux);
+
+    if (ok && s_task) xTaskNotifyGive(s_task);
+  }
+
+  // Pops one record into 'rec'; returns its length (0 when empty).
+  static uint16_t pop(uint8_t *rec)
+  {
+    uint16_t len = 0;
+    portENTER_CRITICAL(&s_mux);
+    if (s_head != s_tail) {
+      uint8_t hdr[4];
+      ringCopyOut(s_tail, hdr, 4);
+      memcpy(&len, hdr + 2, 2);
+      ringCopyOut(s_tail, rec, len);
+      s_tail += len;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    return len;
+  }
+
+  struct Arg
+  {
+    uint8_t tag;
+    union { int64_t i; uint64_t u; double d; const char *s; };
+  };
+
+  size_t format(const uint8_t *rec, char *out, size_t outSize)
+  {
+    uint16_t len; uint32_t ms; uintptr_t addr;
+    memcpy(&len, rec + 2, 2);
+    memcpy(&ms, rec + 4, 4);
+    memcpy(&addr, rec + 8, sizeof(addr));
+    static const char kLevels[] = "-EWID";
+    const char *fmt = (const char *)(uintptr_t)addr;
+
+    // Decode arguments (strings point into the record itself)
+    Arg args[16];
+    uint8_t nargs = 0;
+    for (size_t p = HDR; p < len && nargs < 16; ) {
+      Arg &a = args[nargs++];
+      a.tag = rec[p++];
+      switch (a.tag) {
+        case T_I32: { int32_t v; memcpy(&v, rec + p, 4); a.i = v; p += 4; break; }
+        case T_U32: { uint32_t v; memcpy(&v, rec + p, 4); a.u = v; p += 4; break; }
+        case T_I64: memcpy(&a.i, rec + p, 8); p += 8; break;
+        case T_U64: memcpy(&a.u, rec + p, 8); p += 8; break;
+        case T_F64: memcpy(&a.d, rec + p, 8); p += 8; break;
+        case T_STR: a.s = (const char *)rec + p + 1; p += 1 + rec[p]; break;
+        default: p = len; nargs--; break;
+      }
+    }
+
+    size_t o = (size_t)snprintf(out, outSize, "[%lu][%s][%c] ", (unsigned long)ms, s_tag,
+                                kLevels[rec[1] < 5 ? rec[1] : 0]);
+    uint8_t ai = 0;
+    auto next = [&](Arg &a) -> bool { if (ai >= nargs) return false; a = args[ai++]; return true; };
+
+    // Walk the format; each conversion is re-emitted with a normalized length modifier
+    for (const char *f = fmt; *f && o + 1 < outSize; ++f) {
+      if (*f != '%') { out[o++] = *f; continue; }
+      if (f[1] == '%') { out[o++] = '%'; ++f; continue; }
+
+      char spec[24]; size_t sn = 0; int stars[2]; uint8_t ns = 0;
+      spec[sn++] = '%';
+      for (++f; *f && strchr("-+ #0123456789.*", *f); ++f) {
+        if (*f == '*' && ns < 2) { Arg a; stars[ns++] = next(a) ? (int)a.i : 0; }
+        if (sn < sizeof(spec) - 4) spec[sn++] = *f;
+      }
+      while (*f && strchr("hlLqjzt", *f)) ++f; // drop length modifiers
+      const char conv = *f;
+      if (!conv) break;
+
+      Arg a;
+      if (!next(a)) { a.tag = T_STR; a.s = "<?>"; }
+      if (strchr("diouxX", conv)) { spec[sn++] = 'l'; spec[sn++] = 'l'; }
+      spec[sn++] = conv;
+      spec[sn] = '\0';
+
+      size_t room = outSize - o;
+      int w = 0;
+      if (conv == 's') {
+        const char *s = a.tag == T_STR ? a.s : "<?>";
+        w = ns == 2 ? snprintf(out + o, room, spec, stars[0], stars[1], s)
+          : ns == 1 ? snprintf(out + o, room, spec, stars[0], s)
+                    : snprintf(out + o, room, spec, s);
+      } else if (strchr("feEgGaA", conv)) {
+        double d = a.tag == T_F64 ? a.d : (double)a.i;
+        w = ns == 2 ? snprintf(out + o, room, spec, stars[0], stars[1], d)
+          : ns == 1 ? snprintf(out + o, room, spec, stars[0], d)
+                    : snprintf(out + o, room, spec, d);
+      } else if (conv == 'c') {
+        w = snprintf(out + o, room, "%c", (int)(char)a.i);
+      } else if (conv == 'p') {
+        w = snprintf(out + o, room, "%p", (void *)(uintptr_t)a.u);
+      } else {
+        long long v = a.tag == T_STR ? 0 : (long long)a.i;
+        w = ns == 2 ? snprintf(out + o, room, spec, stars[0], stars[1], v)
+          : ns == 1 ? snprintf(out + o, room, spec, stars[0], v)
+                    : snprintf(out + o, room, spec, v);
+      }
+      if (w > 0) o += ((size_t)w < room) ? (size_t)w : room - 1;
+    }
+    if (o >= outSize) o = outSize - 1;
+    out[o] = '\0';
+    return o;
+  }
+
+  static void emit(const uint8_t *rec, uint16_t len)
+  {
+#if defined(LOG_BINARY)
+    Serial.write(rec, len);
+#else
+    (void)len;
+    char line[256];
+    format(rec, line, sizeof(line));
+    Serial.println(line);
+#endif
+  }
+
+  static void drainAll()
+  {
+    static uint32_t reportedDrops = 0;
+    uint8_t rec[LOG_RECORD_MAX];
+    uint16_t len;
+    while ((len = pop(rec)) != 0) emit(rec, len);
+
+    uint32_t d = s_dropped;
+    if (d != reportedDrops) {
+#if !defined(LOG_BINARY)
+      Serial.printf("[%lu][%s][W] log: dropped %lu records\n", (unsigned long)millis(), s_tag,
+                    (unsigned long)(d - reportedDrops));
+#endif
+      reportedDrops = d;
+    }
+  }
+
+  static void drainTask(void *)
+  {
+    for (;;) {
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50));
+      drainAll();
+    }
+  }
+
+  void begin(const char *tag, uint8_t priority)
+  {
+    s_tag = tag;
+    if (!s_task) xTaskCreate(drainTask, "log", 3072, nullptr, priority, &s_task);
+  }
+
+  void flush() { drainAll(); }
+  uint32_t dropped() { return s_dropped; }
+  uint32_t written() { return s_written; }
+  uint32_t highWater() { return s_highWater; }
+}
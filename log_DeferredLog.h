@@ -0,0 +1,113 @@
+#pragma once
+#include <Arduino.h>
+
+// Deferred binary logger.
+// LOGx() records only the format-string address, a timestamp and the raw
+// arguments (strings copied) into a byte ring; a low-priority task drains it
+// and either formats text on the device or, with -D LOG_BINARY, streams the
+// raw records for tools/log_decode.py to expand against the firmware ELF.
+// Safe to call from any task (not from ISRs). Levels above LOG_LEVEL compile out.
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_RING_BYTES
+#define LOG_RING_BYTES 4096      // power of two
+#endif
+#ifndef LOG_RECORD_MAX
+#define LOG_RECORD_MAX 192
+#endif
+
+namespace dlog
+{
+    // Wire format (little endian), one record:
+    //   u8 sync(0xA5) u8 level u16 len(total) u32 ms uptr fmtAddr | args...
+    // (fmtAddr is 4 bytes on the ESP32, pointer-sized in the native build)
+    // each arg: u8 tag + payload (I32/U32: 4, I64/U64/F64: 8, STR: u8 n + n bytes incl. NUL)
+    enum Tag : uint8_t { T_I32 = 1, T_U32, T_I64, T_U64, T_F64, T_STR };
+    static constexpr uint8_t SYNC = 0xA5;
+    static constexpr size_t HDR = 8 + sizeof(uintptr_t);
+
+    struct Writer
+    {
+        uint8_t buf[LOG_RECORD_MAX];
+        uint16_t n = HDR;
+        bool put(const void *p, size_t len)
+        {
+            if (n + len > sizeof(buf)) return false;
+            memcpy(buf + n, p, len);
+            n += (uint16_t)len;
+            return true;
+        }
+        template <typename T> void tagged(Tag t, T v) { if (n + 1 + sizeof(v) <= sizeof(buf)) { put(&t, 1); put(&v, sizeof(v)); } }
+    };
+
+    inline void enc(Writer &w, int v)                { w.tagged(T_I32, (int32_t)v); }
+    inline void enc(Writer &w, unsigned v)           { w.tagged(T_U32, (uint32_t)v); }
+    inline void enc(Writer &w, long v)               { w.tagged(T_I64, (int64_t)v); }
+    inline void enc(Writer &w, unsigned long v)      { w.tagged(T_U64, (uint64_t)v); }
+    inline void enc(Writer &w, long long v)          { w.tagged(T_I64, (int64_t)v); }
+    inline void enc(Writer &w, unsigned long long v) { w.tagged(T_U64, (uint64_t)v); }
+    inline void enc(Writer &w, double v)             { w.tagged(T_F64, v); }
+    inline void enc(Writer &w, const void *p)        { w.tagged(sizeof(p) == 8 ? T_U64 : T_U32, (uintptr_t)p); }
+    // Length-bounded string (e.g. an MQTT payload, not NUL-terminated)
+    struct Str
+    {
+        const char *p;
+        size_t n;
+    };
+    void enc(Writer &w, Str s);
+    void enc(Writer &w, const char *s);
+    inline void enc(Writer &w, char *s)              { enc(w, (const char *)s); }
+
+    void commit(Writer &w, uint8_t level, const char *fmt);
+
+    template <typename... A>
+    void write(uint8_t level, const char *fmt, A... args)
+    {
+        Writer w;
+        int expand[] = { 0, (enc(w, args), 0)... };
+        (void)expand;
+        commit(w, level, fmt);
+    }
+
+    // Starts the drain task; 'tag' prefixes text output (e.g. the target name).
+    void begin(const char *tag, uint8_t priority = 1);
+    // Drains synchronously (e.g. before a restart).
+    void flush();
+    // Formats one record (as produced above) into text; returns length.
+    size_t format(const uint8_t *rec, char *out, size_t outSize);
+
+    uint32_t dropped();     // records lost to a full ring
+    uint32_t written();
+    uint32_t highWater();   // max ring bytes in use
+}
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOGE(fmt, ...) dlog::write(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define LOGE(fmt, ...) do { } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOGW(fmt, ...) dlog::write(LOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define LOGW(fmt, ...) do { } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOGI(fmt, ...) dlog::write(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define LOGI(fmt, ...) do { } while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOGD(fmt, ...) dlog::write(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define LOGD(fmt, ...) do { } while (0)
+#endif
+
+#define LOG(fmt, ...) LOGI(fmt, ##__VA_ARGS__)
@@ -0,0 +1,20 @@
+#include "mem_ScratchArena.h"
+
+void *ScratchArena::alloc(size_t n, size_t align)
+{
+  const size_t at = (top + align - 1) & ~(align - 1);
+  if (at > cap || n > cap - at) {
+    arenaStats.overflows++;
+    return nullptr;
+  }
+  top = at + n;
+  arenaStats.allocs++;
+  if (top > arenaStats.peak) arenaStats.peak = (uint32_t)top;
+  return base + at;
+}
+
+void ScratchArena::reset()
+{
+  top = 0;
+  arenaStats.resets++;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+#include <stddef.h>
+
+// Bump-pointer scratch space for per-message and per-frame temporaries.
+// alloc() hands out aligned slices of a fixed buffer and reset() drops them
+// all at once: the network task resets its arena before each MQTT packet,
+// the UI task before each frame. An arena belongs to one task (no locking).
+// A request that does not fit returns nullptr and is counted; callers skip
+// the work rather than falling back to the heap.
+
+struct ArenaStats
+{
+    uint32_t resets = 0;
+    uint32_t allocs = 0;
+    uint32_t overflows = 0;    // requests that did not fit
+    uint32_t peak = 0;         // most bytes in use between two resets
+};
+
+class ScratchArena
+{
+public:
+    ScratchArena(uint8_t *buf, size_t size) : base(buf), cap(size) {}
+
+    void *alloc(size_t n, size_t align = sizeof(void *));
+    char *chars(size_t n) { return (char *)alloc(n, 1); }
+    void reset();
+
+    size_t used() const { return top; }
+    size_t capacity() const { return cap; }
+    const ArenaStats &stats() const { return arenaStats; }
+
+private:
+    uint8_t *base;
+    size_t cap;
+    size_t top = 0;
+    ArenaStats arenaStats;
+};
+
+template <size_t N>
+class StaticArena : public ScratchArena
+{
+public:
+    StaticArena() : ScratchArena(storage, N) {}
+
+private:
+    alignas(8) uint8_t storage[N];
+};
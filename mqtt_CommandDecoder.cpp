@@ -0,0 +1,314 @@
+#include "mqtt_CommandDecoder.h"
+#include <az_json.h>
+
+static constexpr int32_t REQUEST_ID_MAX = 64;
+
+struct VerbName
+{
+  CmdVerb verb;
+  const char *name;
+};
+
+static const VerbName kVerbs[] = {
+  { CmdVerb::RelayOn,  "activateRelay" },
+  { CmdVerb::RelayOff, "relayOff" },
+  { CmdVerb::Pulse,    "pulseRelay" },
+  { CmdVerb::Cancel,   "cancelPulse" },
+  { CmdVerb::Set,      "setRelay" },
+};
+
+CmdVerb cmdVerbFromName(az_span name)
+{
+  for (const VerbName &v : kVerbs) {
+    if (az_span_is_content_equal(name, az_span_create((uint8_t *)v.name, (int32_t)strlen(v.name))))
+      return v.verb;
+  }
+  return CmdVerb::None;
+}
+
+const char *cmdVerbName(CmdVerb verb)
+{
+  for (const VerbName &v : kVerbs) {
+    if (v.verb == verb) return v.name;
+  }
+  return "none";
+}
+
+const char *cmdErrorName(CmdError e)
+{
+  switch (e) {
+    case CmdError::None:         return "ok";
+    case CmdError::BadJson:      return "bad_json";
+    case CmdError::UnknownCmd:   return "unknown_cmd";
+    case CmdError::MissingCmd:   return "missing_cmd";
+    case CmdError::BadType:      return "bad_type";
+    case CmdError::OutOfRange:   return "out_of_range";
+    case CmdError::MissingParam: return "missing_param";
+  }
+  return "unknown";
+}
+
+const char *cmdErrorBody(CmdError e)
+{
+  switch (e) {
+    case CmdError::None:         return "{}";
+    case CmdError::BadJson:      return "{\"error\":\"bad_json\"}";
+    case CmdError::UnknownCmd:   return "{\"error\":\"unknown_cmd\"}";
+    case CmdError::MissingCmd:   return "{\"error\":\"missing_cmd\"}";
+    case CmdError::BadType:      return "{\"error\":\"bad_type\"}";
+    case CmdError::OutOfRange:   return "{\"error\":\"out_of_range\"}";
+    case CmdError::MissingParam: return "{\"error\":\"missing_param\"}";
+  }
+  return "{\"error\":\"unknown\"}";
+}
+
+#if defined(ARDUINO_JSON_STYLE_SINGLE_QUOTES)
+// Legacy senders use {'cmd':'relayOff'}; rewrite in place when unambiguous
+static void normalizeQuotes(az_span payload)
+{
+  uint8_t *p = az_span_ptr(payload);
+  const int32_t n = az_span_size(payload);
+  if (!memchr(p, '\'', (size_t)n) || memchr(p, '"', (size_t)n)) return;
+  for (int32_t i = 0; i < n; ++i) {
+    if (p[i] == '\'') p[i] = '"';
+  }
+}
+#endif
+
+bool cmdHasSetParams(const RelayCommand &c)
+{
+  return c.hasState || (c.hasMask && c.hasLevels);
+}
+
+static CmdError readUint(const az_json_token &t, uint32_t lo, uint32_t hi, uint32_t &out)
+{
+  if (t.kind != AZ_JSON_TOKEN_NUMBER) return CmdError::BadType;
+  uint32_t v;
+  if (az_result_failed(az_json_token_get_uint32(&t, &v))) return CmdError::OutOfRange; // negative/fraction/overflow
+  if (v < lo || v > hi) return CmdError::OutOfRange;
+  out = v;
+  return CmdError::None;
+}
+
+static CmdError readState(const az_json_token &t, bool &out)
+{
+  switch (t.kind) {
+    case AZ_JSON_TOKEN_TRUE:  out = true;  return CmdError::None;
+    case AZ_JSON_TOKEN_FALSE: out = false; return CmdError::None;
+    case AZ_JSON_TOKEN_STRING:
+      if (az_json_token_is_text_equal(&t, AZ_SPAN_FROM_STR("on")))  { out = true;  return CmdError::None; }
+      if (az_json_token_is_text_equal(&t, AZ_SPAN_FROM_STR("off"))) { out = false; return CmdError::None; }
+      return CmdError::OutOfRange;
+    case AZ_JSON_TOKEN_NUMBER: {
+      uint32_t v;
+      CmdError e = readUint(t, 0, 1, v);
+      if (e == CmdError::None) out = v != 0;
+      return e;
+    }
+    default:
+      return CmdError::BadType;
+  }
+}
+
+static CmdError readProperty(az_json_reader &r, RelayCommand &out, bool &hasCmd)
+{
+  // r.token is the property name; advance to its value
+  const az_json_token name = r.token;
+  if (az_result_failed(az_json_reader_next_token(&r))) return CmdError::BadJson;
+  const az_json_token &v = r.token;
+
+  if (az_json_token_is_text_equal(&name, AZ_SPAN_FROM_STR("cmd"))) {
+    if (v.kind != AZ_JSON_TOKEN_STRING) return CmdError::BadType;
+    out.verb = v.string_has_escaped_chars ? CmdVerb::None : cmdVerbFromName(v.slice);
+    if (out.verb == CmdVerb::None) return CmdError::UnknownCmd;
+    hasCmd = true;
+    return CmdError::None;
+  }
+  if (az_json_token_is_text_equal(&name, AZ_SPAN_FROM_STR("durationMs"))) {
+    out.hasDuration = true;
+    return readUint(v, RelayPulseEngine::MIN_PULSE_MS, RelayPulseEngine::MAX_PULSE_MS, out.durationMs);
+  }
+  if (az_json_token_is_text_equal(&name, AZ_SPAN_FROM_STR("channel"))) {
+    uint32_t ch;
+    CmdError e = readUint(v, 0, RELAY_CHANNELS - 1, ch);
+    if (e == CmdError::None) out.channel = (uint8_t)ch;
+    return e;
+  }
+  if (az_json_token_is_text_equal(&name, AZ_SPAN_FROM_STR("mask"))) {
+    out.hasMask = true;
+    return readUint(v, 1, RELAY_ALL, out.mask);
+  }
+  if (az_json_token_is_text_equal(&name, AZ_SPAN_FROM_STR("levels"))) {
+    out.hasLevels = true;
+    return readUint(v, 0, RELAY_ALL, out.levels);
+  }
+  if (az_json_token_is_text_equal(&name, AZ_SPAN_FROM_STR("state"))) {
+    out.hasState = true;
+    return readState(v, out.state);
+  }
+  if (az_json_token_is_text_equal(&name, AZ_SPAN_FROM_STR("requestId"))) {
+    if (v.kind != AZ_JSON_TOKEN_STRING || v.string_has_escaped_chars) return CmdError::BadType;
+    const int32_t n = az_span_size(v.slice);
+    if (n == 0 || n > REQUEST_ID_MAX) return CmdError::OutOfRange;
+    out.requestId = v.slice;
+    return CmdError::None;
+  }
+
+  // Unknown key: skip its value (including nested objects/arrays)
+  return az_result_failed(az_json_reader_skip_children(&r)) ? CmdError::BadJson : CmdError::None;
+}
+
+// Only whitespace may follow the top-level value: '{...}garbage' or two
+// concatenated objects are one malformed payload, not the first command
+static bool atEnd(az_json_reader &r)
+{
+  return az_json_reader_next_token(&r) == AZ_ERROR_JSON_READER_DONE;
+}
+
+CmdError decodeCommand(az_span payload, RelayCommand &out, bool requireCmd)
+{
+  out = RelayCommand();
+#if defined(ARDUINO_JSON_STYLE_SINGLE_QUOTES)
+  normalizeQuotes(payload);
+#endif
+
+  az_json_reader r;
+  if (az_result_failed(az_json_reader_init(&r, payload, NULL)) ||
+      az_result_failed(az_json_reader_next_token(&r)))
+    return requireCmd ? CmdError::MissingCmd : CmdError::None; // empty method payload is fine
+
+  if (r.token.kind == AZ_JSON_TOKEN_NUMBER && !requireCmd) {
+    const az_json_token t = r.token;
+    if (!atEnd(r)) return CmdError::BadJson;
+    out.hasDuration = true;
+    return readUint(t, RelayPulseEngine::MIN_PULSE_MS, RelayPulseEngine::MAX_PULSE_MS, out.durationMs);
+  }
+  if (r.token.kind == AZ_JSON_TOKEN_NULL && !requireCmd) return atEnd(r) ? CmdError::None : CmdError::BadJson;
+  if (r.token.kind != AZ_JSON_TOKEN_BEGIN_OBJECT) return CmdError::BadJson;
+
+  bool hasCmd = false;
+  for (;;) {
+    if (az_result_failed(az_json_reader_next_token(&r))) return CmdError::BadJson;
+    if (r.token.kind == AZ_JSON_TOKEN_END_OBJECT) break;
+    if (r.token.kind != AZ_JSON_TOKEN_PROPERTY_NAME) return CmdError::BadJson;
+    CmdError e = readProperty(r, out, hasCmd);
+    if (e != CmdError::None) return e;
+  }
+  if (!atEnd(r)) return CmdError::BadJson;
+
+  if (requireCmd && !hasCmd) return CmdError::MissingCmd;
+  if (out.verb == CmdVerb::Set && !cmdHasSetParams(out)) return CmdError::MissingParam;
+  return CmdError::None;
+}
+
+#if defined(CMD_BENCH)
+static const char *const kCorpus[] = {
+  "{\"cmd\":\"activateRelay\"}",
+  "{ \"cmd\" : \"relayOff\" , \"channel\" : 0 }",
+  "{\"durationMs\":1500,\"cmd\":\"pulseRelay\",\"requestId\":\"a1b2c3\"}",
+  "{\"cmd\":\"setRelay\",\"state\":true,\"meta\":{\"from\":\"ops\",\"tags\":[1,2,3]}}",
+  "{\"cmd\":\"cancelPulse\",\"channel\":0,\"requestId\":\"0123456789abcdef\"}",
+  "{\"cmd\":\"setRelay\",\"state\":\"off\"}",
+  "{\"cmd\":\"pulseRelay\",\"durationMs\":5}",
+  "{\"cmd\":\"reboot\"}",
+  "{\"cmd\":\"setRelay\",\"mask\":1,\"levels\":1}",
+  "{\"cmd\":\"relayOff\",\"mask\":1,\"requestId\":\"grp\"}",
+  "{\"cmd\":\"relayOff\"} \r\n",                       // trailing whitespace is fine
+  "{\"cmd\":\"relayOff\"}garbage",                       // anything else is not
+  "{\"cmd\":\"relayOff\"}{\"cmd\":\"activateRelay\"}",
+};
+static constexpr size_t CORPUS = sizeof(kCorpus) / sizeof(kCorpus[0]);
+
+// Invariants of an accepted command; a violation means the decoder let bad input through
+static bool sane(const RelayCommand &c, const uint8_t *buf, size_t len)
+{
+  if (c.verb > CmdVerb::Set || c.channel >= RELAY_CHANNELS) return false;
+  if (c.hasDuration && (c.durationMs < RelayPulseEngine::MIN_PULSE_MS || c.durationMs > RelayPulseEngine::MAX_PULSE_MS))
+    return false;
+  if (c.hasMask && (!c.mask || (c.mask & ~RELAY_ALL))) return false;
+  if (c.levels & ~RELAY_ALL) return false;
+  if (c.verb == CmdVerb::Set && !cmdHasSetParams(c)) return false;
+  const uint8_t *id = az_span_ptr(c.requestId);
+  const int32_t n = az_span_size(c.requestId);
+  return n == 0 || (id >= buf && id + n <= buf + len && n <= REQUEST_ID_MAX);
+}
+
+// Payloads with bytes after the top-level value: all must be BadJson
+struct TrailingCase
+{
+  const char *text;
+  bool requireCmd;
+};
+static const TrailingCase kTrailing[] = {
+  { "{\"cmd\":\"relayOff\"}garbage", true },
+  { "{\"cmd\":\"relayOff\"}{\"cmd\":\"activateRelay\"}", true },
+  { "{\"cmd\":\"relayOff\"} ,", true },
+  { "{\"cmd\":\"relayOff\"}}", false },
+  { "1500 2000", false },
+  { "null{\"cmd\":\"relayOn\"}", false },
+};
+
+void cmdDecoderBenchmark(Print &out, uint32_t iterations)
+{
+  uint8_t buf[160];
+  RelayCommand cmd;
+
+  uint32_t trailingAccepted = 0;
+  for (size_t i = 0; i < sizeof(kTrailing) / sizeof(kTrailing[0]); ++i) {
+    const size_t len = strlen(kTrailing[i].text);
+    memcpy(buf, kTrailing[i].text, len);
+    const CmdError e = decodeCommand(az_span_create(buf, (int32_t)len), cmd, kTrailing[i].requireCmd);
+    if (e != CmdError::BadJson) {
+      trailingAccepted++;
+      out.printf("[CMD BENCH] FAIL trailing bytes gave %s: %s\n", cmdErrorName(e), kTrailing[i].text);
+    }
+  }
+
+  // Throughput: decode the corpus round-robin (copy excluded from timing)
+  uint32_t us = 0, bytes = 0, accepted = 0;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    const char *src = kCorpus[i % CORPUS];
+    const size_t len = strlen(src);
+    memcpy(buf, src, len);
+    const uint32_t t0 = micros();
+    const CmdError e = decodeCommand(az_span_create(buf, (int32_t)len), cmd, true);
+    us += micros() - t0;
+    bytes += (uint32_t)len;
+    if (e == CmdError::None) accepted++;
+  }
+  out.printf("[CMD BENCH] decodes=%lu accepted=%lu avg=%luns throughput=%luKB/s\n",
+             (unsigned long)iterations, (unsigned long)accepted,
+             (unsigned long)(us ? (uint64_t)us * 1000 / iterations : 0),
+             (unsigned long)(us ? (uint64_t)bytes * 1000 / us : 0));
+
+  // Fuzz: mutate corpus entries and check every accepted result
+  uint32_t errors[8] = {}, violations = 0;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    const char *src = kCorpus[random(CORPUS)];
+    size_t len = strlen(src);
+    memcpy(buf, src, len);
+    switch (random(4)) {
+      case 0: len = (size_t)random((long)len + 1); break;                          // truncate
+      case 1: for (int k = random(1, 4); k > 0; --k) buf[random((long)len)] = (uint8_t)random(256); break;
+      case 2: {                                                                      // splice another entry's tail
+        const char *o = kCorpus[random(CORPUS)];
+        const size_t at = (size_t)random((long)len), ol = strlen(o), from = (size_t)random((long)ol);
+        const size_t n = std::min(ol - from, sizeof(buf) - at);
+        memcpy(buf + at, o + from, n);
+        len = at + n;
+        break;
+      }
+      default: buf[random((long)len)] = "{}[]\":,0-e.\\ "[random(14)]; break;      // structural byte
+    }
+    const CmdError e = decodeCommand(az_span_create(buf, (int32_t)len), cmd, random(2) == 0);
+    errors[(uint8_t)e & 7]++;
+    if (e == CmdError::None && !sane(cmd, buf, len)) violations++;
+  }
+  out.printf("[CMD BENCH] fuzz=%lu ok=%lu bad_json=%lu unknown_cmd=%lu missing_cmd=%lu bad_type=%lu "
+             "out_of_range=%lu missing_param=%lu violations=%lu trailing_accepted=%lu\n",
+             (unsigned long)iterations, (unsigned long)errors[0], (unsigned long)errors[1],
+             (unsigned long)errors[2], (unsigned long)errors[3], (unsigned long)errors[4],
+             (unsigned long)errors[5], (unsigned long)errors[6], (unsigned long)violations,
+             (unsigned long)trailingAccepted);
+}
+#endif
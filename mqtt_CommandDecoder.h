@@ -0,0 +1,66 @@
+#pragma once
+#include <Arduino.h>
+#include <az_span.h>
+#include "relay_PulseEngine.h"
+
+// Streaming command decoder for C2D and direct-method payloads.
+// Walks the payload in place with az_json_reader (no copies, no heap):
+//   {"cmd":"pulseRelay","durationMs":1500,"channel":0,"requestId":"abc"}
+//   {"cmd":"setRelay","mask":15,"levels":5}   (group: channels 0-3 in one write)
+// Whitespace, key order and unknown keys are tolerated; known keys are type-
+// and range-checked. With -D ARDUINO_JSON_STYLE_SINGLE_QUOTES, legacy
+// {'cmd':'relayOff'} payloads are accepted (quotes are rewritten in place).
+
+enum class CmdVerb : uint8_t
+{
+    None = 0,   // no "cmd" (direct methods: the method name is the verb)
+    RelayOn,    // "activateRelay"
+    RelayOff,   // "relayOff"
+    Pulse,      // "pulseRelay"   (durationMs)
+    Cancel,     // "cancelPulse"
+    Set         // "setRelay"     (state, or levels with a mask)
+};
+
+enum class CmdError : uint8_t
+{
+    None = 0,
+    BadJson,     // not a JSON object (or a bare number)
+    UnknownCmd,
+    MissingCmd,
+    BadType,     // known key with the wrong JSON type
+    OutOfRange,  // durationMs / channel / mask / requestId length
+    MissingParam // setRelay without "state" (or "levels" with a mask)
+};
+
+struct RelayCommand
+{
+    CmdVerb verb = CmdVerb::None;
+    uint8_t channel = 0;
+    RelayMask mask = 0;      // group form; overrides channel when hasMask
+    RelayMask levels = 0;    // setRelay with a mask: wanted level per masked channel
+    uint32_t durationMs = 0;
+    bool state = false;
+    bool hasDuration = false;
+    bool hasState = false;
+    bool hasMask = false;
+    bool hasLevels = false;
+    az_span requestId = AZ_SPAN_EMPTY;  // points into the payload
+
+    RelayMask targets() const { return hasMask ? mask : (RelayMask)1 << channel; }
+};
+
+// requireCmd: C2D payloads must name a "cmd"; method payloads may omit it.
+// A bare number payload is read as durationMs (legacy pulseRelay form).
+CmdError decodeCommand(az_span payload, RelayCommand &out, bool requireCmd);
+
+bool cmdHasSetParams(const RelayCommand &c); // "state", or "mask" + "levels"
+CmdVerb cmdVerbFromName(az_span name);
+const char *cmdVerbName(CmdVerb v);
+const char *cmdErrorName(CmdError e);
+const char *cmdErrorBody(CmdError e);   // strict JSON, e.g. {"error":"bad_type"}
+
+#if defined(CMD_BENCH)
+// Decode throughput over a payload corpus plus a mutation fuzz pass
+// (truncations, byte flips, splices); prints results to 'out'.
+void cmdDecoderBenchmark(Print &out, uint32_t iterations = 20000);
+#endif
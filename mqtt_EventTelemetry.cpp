@@ -0,0 +1,199 @@
+#include "mqtt_EventTelemetry.h"
+
+EventSource eventSourceFrom(const char *src)
+{
+  if (!src) return EventSource::Other;
+  if (!strcmp(src, "direct_method")) return EventSource::Method;
+  if (!strcmp(src, "c2d")) return EventSource::C2d;
+  if (!strncmp(src, "ui_", 3)) return EventSource::Ui;
+  if (!strcmp(src, "restore")) return EventSource::Restore;
+  return EventSource::Other;
+}
+
+// --- Producers ---
+void EventTelemetry::push(const Event &e)
+{
+  portENTER_CRITICAL(&mux);
+  // Not into an event encode() already copied: the repeat would miss that message
+  if (head != tail && e.type == (uint8_t)EventType::Link && (int32_t)(head - 1 - encodedEnd) >= 0) {
+    Event &last = ring[(head - 1) & (EVENT_RING - 1)];
+    if (last.type == e.type && last.a == e.a && last.b == e.b && last.c == e.c) {
+      last.v++; // same transition again (e.g. a retry loop while offline)
+      evStats.folded++;
+      portEXIT_CRITICAL(&mux);
+      return;
+    }
+  }
+  if (head - tail == EVENT_RING) {
+    tail++; // full: the oldest event goes
+    droppedPending++;
+    evStats.dropped++;
+  }
+  ring[head & (EVENT_RING - 1)] = e;
+  head++;
+  if (head - tail > evStats.maxBacklog) evStats.maxBacklog = head - tail;
+  portEXIT_CRITICAL(&mux);
+}
+
+void EventTelemetry::relay(RelayMask levels, EventSource src, uint32_t now)
+{
+  push({ now, (uint8_t)EventType::Relay, (uint8_t)src, 0, 0, (uint32_t)levels });
+}
+
+void EventTelemetry::link(uint8_t from, uint8_t to, bool failed, uint32_t now)
+{
+  push({ now, (uint8_t)EventType::Link, from, to, (uint8_t)failed, 1 });
+}
+
+void EventTelemetry::rssi(int8_t dbm, uint32_t now)
+{
+  push({ now, (uint8_t)EventType::Rssi, 0, 0, 0, (uint32_t)(int32_t)dbm });
+}
+
+void EventTelemetry::boot(uint8_t resetReason, RelayMask levels, uint32_t now)
+{
+  push({ now, (uint8_t)EventType::Boot, resetReason, 0, 0, (uint32_t)levels });
+}
+
+// --- Consumer (network task) ---
+uint32_t EventTelemetry::backlog()
+{
+  portENTER_CRITICAL(&mux);
+  const uint32_t n = head - tail;
+  portEXIT_CRITICAL(&mux);
+  return n;
+}
+
+bool EventTelemetry::due(uint32_t now)
+{
+  if (tried && now - lastTryMs < EVENT_MIN_GAP_MS) return false;
+  portENTER_CRITICAL(&mux);
+  const uint32_t n = head - tail;
+  const uint32_t oldest = n ? ring[tail & (EVENT_RING - 1)].ms : now;
+  portEXIT_CRITICAL(&mux);
+  return n >= EVENT_BATCH_EVENTS || (n && now - oldest >= EVENT_WINDOW_S * 1000UL);
+}
+
+namespace
+{
+  // Minimal CBOR writer: unsigned/negative ints and array heads
+  struct Cbor
+  {
+    uint8_t *p;
+    size_t cap;
+    size_t n = 0;
+    bool ok = true;
+
+    Cbor(uint8_t *out, size_t capacity) : p(out), cap(capacity) {}
+
+    void byte(uint8_t b)
+    {
+      if (n < cap) p[n++] = b;
+      else ok = false;
+    }
+    void head(uint8_t major, uint32_t v)
+    {
+      major <<= 5;
+      if (v < 24) {
+        byte(major | v);
+      } else if (v <= 0xFF) {
+        byte(major | 24);
+        byte((uint8_t)v);
+      } else if (v <= 0xFFFF) {
+        byte(major | 25);
+        byte((uint8_t)(v >> 8));
+        byte((uint8_t)v);
+      } else {
+        byte(major | 26);
+        for (int s = 24; s >= 0; s -= 8) byte((uint8_t)(v >> s));
+      }
+    }
+    void uint(uint32_t v) { head(0, v); }
+    void sint(int32_t v) { v < 0 ? head(1, (uint32_t)(-1 - v)) : head(0, (uint32_t)v); }
+    void array(uint8_t count) { head(4, count); }
+  };
+}
+
+EventBatch EventTelemetry::encode(uint8_t *out, size_t size, uint32_t now, uint32_t epochS)
+{
+  EventBatch b;
+  if (size < 2) return b;
+  Cbor w(out, size - 1);    // keeps room for the closing break
+
+  // Copy under the lock, encode outside it: producers only wait for the copy
+  portENTER_CRITICAL(&mux);
+  b.first = tail;
+  b.dropped = droppedPending;
+  const uint32_t waiting = head - tail;
+  for (uint32_t i = 0; i < waiting; ++i) pending[i] = ring[(tail + i) & (EVENT_RING - 1)];
+  encodedEnd = head;
+  portEXIT_CRITICAL(&mux);
+
+  w.array(5);
+  w.uint(1);
+  w.uint(now);
+  w.uint(epochS);
+  w.uint(b.dropped);
+  w.byte(0x9F);             // indefinite-length array of events
+  uint32_t prevMs = 0;
+  for (uint32_t i = 0; i < waiting && w.ok; ++i) {
+    const Event &e = pending[i];
+    const size_t mark = w.n;
+    const uint32_t dt = e.ms - prevMs;
+    switch ((EventType)e.type) {
+      case EventType::Relay:
+        w.array(4); w.uint(dt); w.uint(e.type); w.uint(e.v); w.uint(e.a);
+        break;
+      case EventType::Link:
+        w.array(6); w.uint(dt); w.uint(e.type); w.uint(e.a); w.uint(e.b); w.uint(e.c); w.uint(e.v);
+        break;
+      case EventType::Rssi:
+        w.array(3); w.uint(dt); w.uint(e.type); w.sint((int32_t)e.v);
+        break;
+      case EventType::Boot:
+        w.array(4); w.uint(dt); w.uint(e.type); w.uint(e.a); w.uint(e.v);
+        break;
+    }
+    if (!w.ok) {
+      w.n = mark;           // did not fit: stays for the next message
+      break;
+    }
+    prevMs = e.ms;
+    b.count++;
+  }
+
+  if (!b.count) return b;   // nothing waiting (or not even one event fits)
+  w.ok = true;
+  w.cap = size;
+  w.byte(0xFF);
+  b.bytes = w.n;
+  return b;
+}
+
+void EventTelemetry::sent(const EventBatch &b, uint32_t now)
+{
+  portENTER_CRITICAL(&mux);
+  // Events a full ring dropped after encode() did get out in this batch
+  const uint32_t lost = tail - b.first;
+  if ((int32_t)lost > 0) {
+    const uint32_t inBatch = lost < b.count ? lost : b.count;
+    droppedPending -= inBatch;
+    evStats.dropped -= inBatch;
+  }
+  if ((int32_t)(b.first + b.count - tail) > 0) tail = b.first + b.count;
+  droppedPending -= b.dropped < droppedPending ? b.dropped : droppedPending;
+  portEXIT_CRITICAL(&mux);
+
+  evStats.messages++;
+  evStats.events += b.count;
+  evStats.bytes += (uint32_t)b.bytes;
+  tried = true;
+  lastTryMs = now;
+}
+
+void EventTelemetry::failed(uint32_t now)
+{
+  evStats.failed++;
+  tried = true;
+  lastTryMs = now;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "relay_PulseEngine.h" // RelayMask
+
+// Relay, link and RSSI events batched into compact CBOR telemetry.
+// Producers (control and network tasks) push 12-byte records into a ring
+// under a short spinlock; encode() holds it only to copy the waiting
+// records out. The network task encodes one message when the oldest
+// waiting event is EVENT_WINDOW_S old or EVENT_BATCH_EVENTS are waiting,
+// and drops the events only once the publish went through.
+// Offline nothing drains: the ring holds the backlog, repeats of the same
+// link transition fold into one record, and a full ring drops its oldest
+// event (counted, and reported in the next message). After a reconnect the
+// backlog goes out a full batch at a time, at most one per EVENT_MIN_GAP_MS.
+//
+// Message body (CBOR; sent with $.ct=application/cbor):
+//   [1, uptime_ms, epoch_s (0: clock not set), dropped, [_ event, ...]]
+//   event: [dt_ms, type, ...], dt from the previous event (the first: since boot)
+//     relay: [dt, 1, levels, source]          source: EventSource
+//     link:  [dt, 2, from, to, failed, n]     ConnState values; n repeats folded
+//     rssi:  [dt, 3, dBm]
+//     boot:  [dt, 4, reset_reason, levels]
+
+#ifndef EVENT_RING
+#define EVENT_RING 64           // power of two
+#endif
+#ifndef EVENT_WINDOW_S
+#define EVENT_WINDOW_S 300      // longest an event waits (quota: <= 288 messages/day)
+#endif
+#ifndef EVENT_BATCH_EVENTS
+#define EVENT_BATCH_EVENTS 48   // send early once this many wait
+#endif
+#ifndef EVENT_BATCH_BYTES
+#define EVENT_BATCH_BYTES 512   // largest message body
+#endif
+#ifndef EVENT_MIN_GAP_MS
+#define EVENT_MIN_GAP_MS 2000   // pacing while a backlog drains
+#endif
+
+static_assert((EVENT_RING & (EVENT_RING - 1)) == 0, "EVENT_RING must be a power of two");
+
+enum class EventType : uint8_t
+{
+    Relay = 1,
+    Link,
+    Rssi,
+    Boot
+};
+
+enum class EventSource : uint8_t
+{
+    Other = 0,
+    Method,   // "direct_method"
+    C2d,      // "c2d"
+    Ui,       // "ui_*"
+    Restore   // "restore"
+};
+EventSource eventSourceFrom(const char *src);
+
+struct EventStats
+{
+    uint32_t messages = 0;
+    uint32_t events = 0;       // events sent
+    uint32_t bytes = 0;        // message bytes sent
+    uint32_t dropped = 0;      // lost to a full ring
+    uint32_t folded = 0;       // link repeats merged into one record
+    uint32_t failed = 0;       // publishes that failed (events kept)
+    uint32_t maxBacklog = 0;
+};
+
+// One encoded message; hand back to sent() after a successful publish
+struct EventBatch
+{
+    uint32_t first = 0;        // ring sequence of the first event
+    uint32_t count = 0;
+    uint32_t dropped = 0;      // drop count carried in the header
+    size_t bytes = 0;
+};
+
+class EventTelemetry
+{
+public:
+    void relay(RelayMask levels, EventSource src, uint32_t now);
+    void link(uint8_t from, uint8_t to, bool failed, uint32_t now);
+    void rssi(int8_t dbm, uint32_t now);
+    void boot(uint8_t resetReason, RelayMask levels, uint32_t now);
+
+    bool due(uint32_t now);
+    // Encodes the oldest events that fit into 'size' bytes (bytes == 0: nothing waiting)
+    EventBatch encode(uint8_t *out, size_t size, uint32_t now, uint32_t epochS);
+    void sent(const EventBatch &b, uint32_t now);
+    void failed(uint32_t now);
+
+    uint32_t backlog();
+    const EventStats &stats() const { return evStats; }
+
+private:
+    struct Event
+    {
+        uint32_t ms;
+        uint8_t type;
+        uint8_t a, b, c;
+        uint32_t v;
+    };
+
+    void push(const Event &e);
+
+    portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    Event ring[EVENT_RING];
+    uint32_t head = 0, tail = 0;   // sequences: push at head, drain from tail
+    uint32_t encodedEnd = 0;       // events before this were copied by encode(): no folding into them
+    Event pending[EVENT_RING];     // encode()'s copy (network task only)
+    uint32_t droppedPending = 0;
+    uint32_t lastTryMs = 0;
+    bool tried = false;
+    EventStats evStats;
+};
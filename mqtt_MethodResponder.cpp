@@ -0,0 +1,46 @@
+#include "mqtt_MethodResponder.h"
+#include "mqtt_PayloadStream.h"
+#if defined(ESP_PLATFORM)
+#include <esp_heap_caps.h>
+static size_t freeHeap() { return heap_caps_get_free_size(MALLOC_CAP_DEFAULT); }
+#else
+static size_t freeHeap() { return 0; } // native build: use valgrind/heaptrack instead
+#endif
+
+bool MqttMethodResponder::prepare(const char *deviceId)
+{
+  int n = snprintf(c2dBuf, sizeof(c2dBuf), "devices/%s/messages/devicebound/#", deviceId);
+  if (n <= 0 || (size_t)n >= sizeof(c2dBuf)) {
+    c2dBuf[0] = '\0';
+    return false;
+  }
+  return true;
+}
+
+bool MqttMethodResponder::reply(az_span requestId, int status, const char *body)
+{
+  const size_t heap0 = freeHeap();
+  const uint32_t t0 = micros();
+
+  size_t topicLen = 0;
+  bool ok = az_result_succeeded(az_iot_hub_client_methods_response_get_publish_topic(
+      client, requestId, (uint16_t)status, topicBuf, sizeof(topicBuf), &topicLen));
+  const size_t bodyLen = ok ? strlen(body) : 0;
+  if (ok) ok = mqttPublish(mqtt, topicBuf, (const uint8_t *)body, bodyLen);
+
+  const uint32_t dt = micros() - t0;
+  const size_t heap1 = freeHeap();
+
+  MqttReplyStats &s = replyStats;
+  s.replies++;
+  if (!ok) s.failed++;
+  s.lastUs = dt;
+  if (dt > s.maxUs) s.maxUs = dt;
+  s.totalUs += dt;
+  s.bytesCopied += topicLen + (ok ? topicLen : 0);
+  if (heap1 < heap0) {
+    s.heapDrops++;
+    if (heap0 - heap1 > s.maxHeapDrop) s.maxHeapDrop = (uint32_t)(heap0 - heap1);
+  }
+  return ok;
+}
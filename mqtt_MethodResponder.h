@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <az_iot_hub_client.h>
+#include <az_span.h>
+
+// Direct-method responses and subscribe topics from preallocated buffers.
+// Response topics come from az_iot_hub_client_methods_response_get_publish_topic
+// into a fixed buffer; constant topics are built once per connect (prepare()).
+// Nothing on the reply path touches the heap; each reply is metered.
+
+#ifndef MQTT_TOPIC_MAX
+#define MQTT_TOPIC_MAX 128
+#endif
+
+struct MqttReplyStats
+{
+    uint32_t replies = 0;
+    uint32_t failed = 0;       // topic build or publish failed
+    uint32_t lastUs = 0;       // build + publish
+    uint32_t maxUs = 0;
+    uint64_t totalUs = 0;
+    uint64_t bytesCopied = 0;  // topic build + topic into the MQTT buffer (the body streams)
+    uint32_t heapDrops = 0;    // replies after which free heap was lower (0 expected)
+    uint32_t maxHeapDrop = 0;  // bytes
+};
+
+class MqttMethodResponder
+{
+public:
+    MqttMethodResponder(az_iot_hub_client *c, PubSubClient &m) : client(c), mqtt(m) {}
+
+    // Builds the constant topics for this connection; call after az_iot_hub_client_init.
+    bool prepare(const char *deviceId);
+    const char *methodsTopic() const { return AZ_IOT_HUB_CLIENT_METHODS_SUBSCRIBE_TOPIC; }
+    const char *c2dTopic() const { return c2dBuf; }
+
+    // Publishes $iothub/methods/res/{status}/?$rid={rid} with 'body' (strict JSON).
+    bool reply(az_span requestId, int status, const char *body);
+
+    const MqttReplyStats &stats() const { return replyStats; }
+
+private:
+    az_iot_hub_client *client;
+    PubSubClient &mqtt;
+    char topicBuf[MQTT_TOPIC_MAX];
+    char c2dBuf[MQTT_TOPIC_MAX] = "";
+    MqttReplyStats replyStats;
+};
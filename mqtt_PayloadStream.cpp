@@ -0,0 +1,345 @@
+#include "mqtt_PayloadStream.h"
+
+static uint32_t runBits(int first, uint8_t n)
+{
+  return (n >= 32 ? 0xFFFFFFFFUL : (1UL << n) - 1) << first;
+}
+
+int MqttBlockPool::take(uint8_t n)
+{
+  if (!n || n > MQTT_RX_BLOCKS) return -1;
+  for (int i = 0; i + n <= MQTT_RX_BLOCKS; ++i) {
+    const uint32_t bits = runBits(i, n);
+    if (map & bits) continue;
+    map |= bits;
+    used += n;
+    if (used > peakUsed) peakUsed = used;
+    return i;
+  }
+  return -1;
+}
+
+bool MqttBlockPool::grow(int first, uint8_t n)
+{
+  const int next = first + n;
+  if (next >= MQTT_RX_BLOCKS || map >> next & 1) return false;
+  map |= 1UL << next;
+  if (++used > peakUsed) peakUsed = used;
+  return true;
+}
+
+void MqttBlockPool::give(int first, uint8_t n)
+{
+  if (first < 0 || !n) return;
+  map &= ~runBits(first, n);
+  used -= n;
+}
+
+void MqttRxStream::begin()
+{
+  release();
+  len = total = 0;
+  rejected = poolFull = topicTooLong = counted = false;
+}
+
+void MqttRxStream::release()
+{
+  pool.give(first, blocks);
+  first = -1;
+  blocks = 0;
+}
+
+bool MqttRxStream::reserve()
+{
+  if (blocks >= MQTT_RX_BLOCKS) return false; // larger than the whole pool
+  const bool ok = first < 0 ? (first = pool.take(1)) >= 0 : pool.grow(first, blocks);
+  if (!ok) {
+    poolFull = true;
+    return false;
+  }
+  blocks++;
+  return true;
+}
+
+size_t MqttRxStream::write(uint8_t b)
+{
+  total++;
+  if (rejected) return 1; // keep draining: the packet must still be consumed
+  if (len == (uint32_t)blocks * MQTT_RX_BLOCK && !reserve()) {
+    rejected = true;
+    release();
+    return 1;
+  }
+  pool.block(first)[len++] = b;
+  return 1;
+}
+
+size_t MqttRxStream::write(const uint8_t *buf, size_t size)
+{
+  for (size_t i = 0; i < size; ++i) write(buf[i]);
+  return size;
+}
+
+bool MqttRxStream::finish(az_span &body)
+{
+  body = rejected || !len ? AZ_SPAN_EMPTY : az_span_create(pool.block(first), (int32_t)len);
+  if (!counted) {
+    counted = true;
+    MqttRxStats &s = rxStats;
+    if (!rejected) {
+      s.messages++;
+      s.bytes += len;
+      if (len > s.largest) s.largest = len;
+    } else if (topicTooLong) {
+      s.longTopic++;
+    } else if (poolFull) {
+      s.noBlocks++;
+    } else {
+      s.oversize++;
+    }
+    s.blocksPeak = pool.peak();
+  }
+  return !rejected;
+}
+
+void MqttRxGuard::reset()
+{
+  state = Rx::Header;
+  npending = 0;
+}
+
+void MqttRxGuard::track(uint8_t b)
+{
+  switch (state) {
+    case Rx::Header:
+      publish = (b & 0xF0) == 0x30;
+      remaining = 0;
+      shift = 0;
+      state = Rx::Length;
+      break;
+    case Rx::Length:
+      remaining |= (uint32_t)(b & 0x7F) << shift;
+      shift += 7;
+      if ((b & 0x80) && shift < 28) break; // a fifth length byte makes PubSubClient drop the link
+      state = publish && remaining >= 2 ? Rx::TopicLength : remaining ? Rx::Body : Rx::Header;
+      break;
+    case Rx::Body:
+      if (!--remaining) state = Rx::Header;
+      break;
+    case Rx::TopicLength:
+      break; // consumed by topicLength()
+  }
+}
+
+bool MqttRxGuard::topicLength()
+{
+  if (npending || state != Rx::TopicLength) return true;
+  if (inner.available() < 2) return false;
+  const int hi = inner.read();
+  const int lo = inner.read();
+  if (hi < 0 || lo < 0) return false; // link lost in between: PubSubClient times out
+  uint16_t len = (uint16_t)(hi << 8 | lo);
+  if (len > maxTopic) {
+    len = 0;
+    rx.rejectTopic();
+  }
+  pending[0] = (uint8_t)(len >> 8);
+  pending[1] = (uint8_t)len;
+  npending = 2;
+  remaining -= 2;
+  state = remaining ? Rx::Body : Rx::Header;
+  return true;
+}
+
+int MqttRxGuard::available()
+{
+  if (!topicLength()) return 0;
+  return npending + inner.available();
+}
+
+int MqttRxGuard::read()
+{
+  if (!topicLength()) return -1;
+  if (npending) {
+    const uint8_t b = pending[2 - npending];
+    npending--;
+    return b;
+  }
+  const int c = inner.read();
+  if (c >= 0) track((uint8_t)c);
+  return c;
+}
+
+int MqttRxGuard::read(uint8_t *buf, size_t size)
+{
+  size_t n = 0;
+  for (int c; n < size && (c = read()) >= 0;) buf[n++] = (uint8_t)c;
+  return n ? (int)n : -1;
+}
+
+int MqttRxGuard::peek()
+{
+  if (!topicLength()) return -1;
+  return npending ? pending[2 - npending] : inner.peek();
+}
+
+bool mqttPublish(PubSubClient &mqtt, const char *topic, const uint8_t *body, size_t len)
+{
+  if (!mqtt.beginPublish(topic, (unsigned int)len, false)) return false;
+  if (len && mqtt.write(body, len) != len) return false;
+  return mqtt.endPublish() != 0;
+}
+
+#if defined(MQTT_RX_BENCH)
+// --- Self-check: crafted PUBLISH packets through PubSubClient, the guard and the pool ---
+
+// In-memory socket: serves one queued packet, generated byte by byte
+// (topic: a prefix, then filler; body: a position pattern), swallows writes
+class BenchSocket : public Client
+{
+public:
+  static constexpr const char *PREFIX = "devices/bench/messages/devicebound/";
+
+  static uint8_t topicByte(uint32_t i) { return i < strlen(PREFIX) ? PREFIX[i] : 'a' + i % 26; }
+  static uint8_t bodyByte(uint32_t i) { return (uint8_t)(i * 31 + 7); }
+
+  void connack()
+  {
+    static const uint8_t ack[] = { 0x20, 0x02, 0x00, 0x00 };
+    load(ack, sizeof(ack), 0, 0);
+  }
+  void publish(uint16_t topicLen, uint32_t bodyLen)
+  {
+    uint8_t h[7];
+    uint8_t n = 0;
+    h[n++] = 0x30; // PUBLISH, QoS 0
+    for (uint32_t rem = 2 + topicLen + bodyLen;;) {
+      h[n++] = (uint8_t)(rem & 0x7F) | (rem > 0x7F ? 0x80 : 0);
+      if (!(rem >>= 7)) break;
+    }
+    h[n++] = (uint8_t)(topicLen >> 8);
+    h[n++] = (uint8_t)topicLen;
+    load(h, n, topicLen, bodyLen);
+  }
+
+  int connect(IPAddress, uint16_t) override { return open = true; }
+  int connect(const char *, uint16_t) override { return open = true; }
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+  int connect(IPAddress, uint16_t, int32_t) override { return open = true; }
+  int connect(const char *, uint16_t, int32_t) override { return open = true; }
+#endif
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t *, size_t size) override { return size; }
+  int available() override { return (int)(size() - pos); }
+  int read() override { return pos < size() ? at(pos++) : -1; }
+  int read(uint8_t *buf, size_t n) override
+  {
+    size_t k = 0;
+    while (k < n && pos < size()) buf[k++] = at(pos++);
+    return (int)k;
+  }
+  int peek() override { return pos < size() ? at(pos) : -1; }
+  void flush() override {}
+  void stop() override { open = false; }
+  uint8_t connected() override { return open; }
+  operator bool() override { return open; }
+
+private:
+  void load(const uint8_t *h, uint8_t n, uint32_t t, uint32_t b)
+  {
+    memcpy(head, h, n);
+    headLen = n;
+    topicLen = t;
+    bodyLen = b;
+    pos = 0;
+  }
+  uint32_t size() const { return headLen + topicLen + bodyLen; }
+  uint8_t at(uint32_t i) const
+  {
+    if (i < headLen) return head[i];
+    i -= headLen;
+    return i < topicLen ? topicByte(i) : bodyByte(i - topicLen);
+  }
+
+  uint8_t head[7];
+  uint8_t headLen = 0;
+  uint32_t topicLen = 0, bodyLen = 0, pos = 0;
+  bool open = false;
+};
+
+static MqttBlockPool benchPool;
+static MqttRxStream benchStream(benchPool);
+static uint32_t sCalls, sTopicLen, sBodyLen;
+static bool sTopicOk, sBodyOk, sKept;
+
+static void benchCallback(char *topic, uint8_t *, unsigned int)
+{
+  sCalls++;
+  sTopicLen = strlen(topic);
+  sTopicOk = true;
+  for (uint32_t i = 0; i < sTopicLen; ++i) sTopicOk &= (uint8_t)topic[i] == BenchSocket::topicByte(i);
+  az_span body;
+  sKept = benchStream.finish(body);
+  sBodyLen = (uint32_t)az_span_size(body);
+  sBodyOk = true;
+  for (uint32_t i = 0; i < sBodyLen; ++i) sBodyOk &= az_span_ptr(body)[i] == BenchSocket::bodyByte(i);
+  benchStream.release();
+}
+
+void mqttRxBenchmark(Print &out)
+{
+  static BenchSocket sock;
+  static MqttRxGuard guard(sock, benchStream, MQTT_HEADER_BUF);
+  static PubSubClient client(guard);
+  static const uint32_t POOL = (uint32_t)MQTT_RX_BLOCKS * MQTT_RX_BLOCK;
+  static const uint16_t MAX_TOPIC = MQTT_HEADER_BUF - 7;
+  client.setServer("bench", 1883);
+  client.setBufferSize(MQTT_HEADER_BUF);
+  client.setStream(benchStream);
+  client.setCallback(benchCallback);
+  sock.connack();
+  uint32_t packets = 0, failures = 0;
+  auto check = [&](bool ok, const char *what, uint32_t topicLen, uint32_t bodyLen) {
+    if (ok) return;
+    failures++;
+    out.printf("[MQTT RX BENCH] FAIL %s (topic=%lu body=%lu)\n", what, (unsigned long)topicLen, (unsigned long)bodyLen);
+  };
+  check(client.connect("bench"), "connect", 0, 0);
+
+  // One packet through loop(): a kept body arrives intact, a rejected one empty, the pool ends empty
+  auto run = [&](uint16_t topicLen, uint32_t bodyLen) {
+    const bool topicFits = topicLen <= MAX_TOPIC;
+    const bool bodyFits = bodyLen <= POOL;
+    sCalls = 0;
+    sock.publish(topicLen, bodyLen);
+    benchStream.begin();
+    client.loop();
+    packets++;
+    check(sCalls == 1 && sock.available() == 0, "packet consumed, one callback", topicLen, bodyLen);
+    check(sTopicOk && sTopicLen == (topicFits ? topicLen : 0), "topic intact or rejected", topicLen, bodyLen);
+    check(sKept == (topicFits && bodyFits) && sBodyOk && sBodyLen == (sKept ? bodyLen : 0), "body intact or rejected",
+          topicLen, bodyLen);
+    check(benchStream.topicRejected() == !topicFits && benchPool.inUse() == 0, "pool returned", topicLen, bodyLen);
+  };
+
+  // Body sizes around the block and pool edges, then a sweep to 5000 bytes
+  static const uint16_t TOPIC = 60;
+  const uint32_t edges[] = { 0, 1, MQTT_RX_BLOCK - 1, MQTT_RX_BLOCK, MQTT_RX_BLOCK + 1, POOL - 1, POOL, POOL + 1 };
+  for (uint32_t b : edges) run(TOPIC, b);
+  for (uint32_t b = 0; b <= 5000; b += 13) run(TOPIC, b);
+  // Topic lengths around what the client buffer holds, up to the protocol maximum;
+  // each is followed by a normal packet, so the stream must stay in step
+  const uint16_t topics[] = { (uint16_t)(MAX_TOPIC - 1), MAX_TOPIC, (uint16_t)(MAX_TOPIC + 1), MQTT_HEADER_BUF, 1000, 65535 };
+  for (uint16_t t : topics) {
+    run(t, 16);
+    run(t, POOL + 1);
+    run(TOPIC, 16);
+  }
+  check(client.connected(), "session still up", 0, 0);
+
+  const MqttRxStats &st = benchStream.stats();
+  out.printf("[MQTT RX BENCH] packets=%lu kept=%lu oversize=%lu long_topic=%lu blocks_peak=%u failures=%lu\n",
+             (unsigned long)packets, (unsigned long)st.messages, (unsigned long)st.oversize, (unsigned long)st.longTopic,
+             (unsigned)st.blocksPeak, (unsigned long)failures);
+}
+#endif
@@ -0,0 +1,161 @@
+#pragma once
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <az_span.h>
+
+// Inbound MQTT payloads streamed into a fixed-block pool.
+// With setStream(), PubSubClient hands every PUBLISH payload byte to the
+// stream as it comes off the socket, so its own buffer only needs the fixed
+// header and topic. Bodies land in static MQTT_RX_BLOCK-byte blocks taken as
+// one run (grown block by block), so a message is still a single span for
+// the decoders; nothing touches the heap. A body that outgrows the pool is
+// drained and flagged instead of being dropped unseen. Outgoing publishes
+// stream from the caller's buffer (mqttPublish), so the client buffer stays
+// small in both directions.
+//
+// PubSubClient reads at most one packet per loop(); call begin() before each
+// loop() and release() once the callback is done with the body.
+//
+// loop() moves the topic inside the client buffer by the length it read off
+// the wire, unchecked, so MqttRxGuard sits between the client and the socket
+// and rejects a topic the buffer cannot hold before loop() sees its length.
+
+#ifndef MQTT_RX_BLOCK
+#define MQTT_RX_BLOCK 256
+#endif
+#ifndef MQTT_RX_BLOCKS
+#define MQTT_RX_BLOCKS 8       // 2 KB: the largest accepted payload
+#endif
+#ifndef MQTT_HEADER_BUF
+#define MQTT_HEADER_BUF 384    // PubSubClient buffer: header + longest topic (C2D carries properties)
+#endif
+
+static_assert(MQTT_RX_BLOCKS >= 1 && MQTT_RX_BLOCKS <= 32, "block map is one 32-bit word");
+
+class MqttBlockPool
+{
+public:
+    // First run of n free blocks; -1 when none
+    int take(uint8_t n);
+    // Claims the block right after a run of n starting at 'first'
+    bool grow(int first, uint8_t n);
+    void give(int first, uint8_t n);
+
+    uint8_t *block(int i) { return mem[i]; }
+    uint8_t inUse() const { return used; }
+    uint8_t peak() const { return peakUsed; }
+
+private:
+    alignas(4) uint8_t mem[MQTT_RX_BLOCKS][MQTT_RX_BLOCK];
+    uint32_t map = 0;          // bit i: block i taken
+    uint8_t used = 0;
+    uint8_t peakUsed = 0;
+};
+
+struct MqttRxStats
+{
+    uint32_t messages = 0;
+    uint64_t bytes = 0;        // accepted payload bytes
+    uint32_t largest = 0;      // largest accepted payload
+    uint32_t oversize = 0;     // rejected: larger than the pool
+    uint32_t noBlocks = 0;     // rejected: pool busy (blocks still held)
+    uint32_t longTopic = 0;    // rejected: topic longer than the client buffer holds
+    uint8_t blocksPeak = 0;
+};
+
+class MqttRxStream : public Stream
+{
+public:
+    explicit MqttRxStream(MqttBlockPool &p) : pool(p) {}
+
+    // Starts a packet (releases a body the callback did not release)
+    void begin();
+    // Accounts the current packet; false when it was rejected (body is then empty)
+    bool finish(az_span &body);
+    void release();
+    // The current packet's topic did not fit (MqttRxGuard): its bytes arrive as payload and are drained
+    void rejectTopic() { rejected = topicTooLong = true; }
+    bool topicRejected() const { return topicTooLong; }
+
+    uint32_t received() const { return total; }   // payload bytes seen, kept or not
+    const MqttRxStats &stats() const { return rxStats; }
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+private:
+    bool reserve();
+
+    MqttBlockPool &pool;
+    int first = -1;
+    uint8_t blocks = 0;
+    uint32_t len = 0;
+    uint32_t total = 0;
+    bool rejected = false;
+    bool poolFull = false;
+    bool topicTooLong = false;
+    bool counted = false;
+    MqttRxStats rxStats;
+};
+
+// Pass-through Client that follows the inbound MQTT framing. A PUBLISH topic
+// longer than maxTopic (client buffer minus the largest fixed header and the
+// terminator loop() writes) reaches PubSubClient as length 0: the topic bytes
+// then count as payload, which 'rx' drains and rejects, and the callback gets
+// an empty topic. The packet is consumed in full, so the session stays in step.
+// The two length bytes are read together; until both are in, available() is 0.
+class MqttRxGuard : public Client
+{
+public:
+    MqttRxGuard(Client &c, MqttRxStream &s, uint16_t bufferSize)
+        : inner(c), rx(s), maxTopic(bufferSize > 7 ? bufferSize - 7 : 0) {}
+
+    int connect(IPAddress ip, uint16_t port) override { reset(); return inner.connect(ip, port); }
+    int connect(const char *host, uint16_t port) override { reset(); return inner.connect(host, port); }
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    int connect(IPAddress ip, uint16_t port, int32_t t) override { reset(); return inner.connect(ip, port, t); }
+    int connect(const char *host, uint16_t port, int32_t t) override { reset(); return inner.connect(host, port, t); }
+#endif
+    size_t write(uint8_t b) override { return inner.write(b); }
+    size_t write(const uint8_t *buf, size_t size) override { return inner.write(buf, size); }
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override;
+    void flush() override { inner.flush(); }
+    void stop() override { inner.stop(); }
+    uint8_t connected() override { return inner.connected(); }
+    operator bool() override { return inner.connected(); }
+
+    // Back to a packet boundary; connect() does it, call it too when 'inner' is connected directly
+    void reset();
+
+private:
+    enum class Rx : uint8_t { Header, Length, TopicLength, Body };
+
+    void track(uint8_t b);
+    bool topicLength(); // reads (and bounds) both topic-length bytes once they are in
+
+    Client &inner;
+    MqttRxStream &rx;
+    const uint16_t maxTopic;
+    Rx state = Rx::Header;
+    bool publish = false;
+    uint8_t shift = 0;
+    uint32_t remaining = 0;    // bytes left in the current packet
+    uint8_t pending[2];        // topic length as handed on
+    uint8_t npending = 0;
+};
+
+// PUBLISH through beginPublish/write/endPublish: only the header and topic
+// pass through the client buffer.
+bool mqttPublish(PubSubClient &mqtt, const char *topic, const uint8_t *body, size_t len);
+
+#if defined(MQTT_RX_BENCH)
+// Crafted PUBLISH packets through PubSubClient, MqttRxGuard and the pool: body
+// sizes to 5000 bytes and topics to 65535; prints to 'out'
+void mqttRxBenchmark(Print &out);
+#endif
@@ -0,0 +1,129 @@
+#include "mqtt_TopicRouter.h"
+
+const MqttMethodRoute *MqttTopicRouter::findMethod(az_span name) const
+{
+  for (size_t i = 0; i < methodCount; ++i) {
+    const MqttMethodRoute &r = methodRoutes[i];
+    az_span n = az_span_create((uint8_t *)r.name, (int32_t)strlen(r.name));
+    if (az_span_is_content_equal(n, name)) return &r;
+  }
+  return nullptr;
+}
+
+bool MqttTopicRouter::route(char *topic, const uint8_t *payload, unsigned int length, bool rejected)
+{
+  az_span t = az_span_create_from_str(topic);
+  az_span p = rejected ? AZ_SPAN_EMPTY : az_span_create((uint8_t *)payload, (int32_t)length);
+  if (rejected) payloadsRejected++;
+
+  // --- Direct methods: $iothub/methods/POST/{name}/?$rid={rid} ---
+  az_iot_hub_client_method_request req;
+  if (az_result_succeeded(az_iot_hub_client_methods_parse_received_topic(client, t, &req)))
+  {
+    const MqttMethodRoute *r = findMethod(req.name);
+    MqttMethodResult res = { 404, "{\"error\":\"method_not_found\"}" };
+    if (r && rejected) {
+      res = { 413, "{\"error\":\"payload_too_large\"}" };
+    } else if (r) {
+      res = r->handler(p);
+      methodsRouted++;
+    } else {
+      methodsUnknown++;
+    }
+    if (onReply) onReply(req.request_id, res.status, res.body);
+    return true;
+  }
+
+  // --- Twin: $iothub/twin/res/{status}/?$rid={rid} and desired PATCH ---
+  az_iot_hub_client_twin_response twin;
+  if (az_result_succeeded(az_iot_hub_client_twin_parse_received_topic(client, t, &twin)))
+  {
+    twinRouted++;
+    if (onTwin) onTwin(twin, p);
+    return true;
+  }
+
+  // --- C2D: devices/{id}/messages/devicebound/... ---
+  az_iot_hub_client_c2d_request c2d;
+  if (az_result_succeeded(az_iot_hub_client_c2d_parse_received_topic(client, t, &c2d)))
+  {
+    c2dRouted++;
+    if (onC2d && !rejected) onC2d(p);
+    return true;
+  }
+
+  topicsUnmatched++;
+  return false;
+}
+
+#if defined(ROUTER_BENCH)
+// --- Self-check: a topic corpus through route() with stub handlers ---
+#include "diag_HeapStats.h"
+
+static uint32_t sMethods, sC2d, sTwin, sReplies, sLastStatus;
+static MqttMethodResult benchMethod(az_span) { sMethods++; return { 200, "{\"ok\":true}" }; }
+static void benchC2d(az_span) { sC2d++; }
+static void benchTwin(const az_iot_hub_client_twin_response &, az_span) { sTwin++; }
+static void benchReply(az_span, int status, const char *) { sReplies++; sLastStatus = (uint32_t)status; }
+
+void topicRouterBenchmark(Print &out, uint32_t rounds)
+{
+  static const MqttMethodRoute routes[] = {
+    MQTT_METHOD("relayOn", benchMethod), MQTT_METHOD("relayOff", benchMethod), MQTT_METHOD("activateRelay", benchMethod),
+  };
+  // route() takes the topic as PubSubClient hands it over: a mutable C string
+  static char topics[][112] = {
+    "$iothub/methods/POST/relayOff/?$rid=1",
+    "$iothub/methods/POST/activateRelay/?$rid=2f",
+    "$iothub/methods/POST/reboot/?$rid=3",                      // not in the table: 404
+    "devices/bench/messages/devicebound/%24.mid=7&%24.to=%2Fdevices%2Fbench%2Fmessages%2FdeviceBound&k=v",
+    "$iothub/twin/res/200/?$rid=4",
+    "$iothub/twin/PATCH/properties/desired/?$version=5",
+    "devices/bench/messages/events/",                           // device-to-cloud: unmatched
+  };
+  static const uint8_t payload[] = "{\"cmd\":\"relayOff\",\"ch\":0}";
+  static const uint32_t TOPICS = sizeof(topics) / sizeof(topics[0]);
+
+  az_iot_hub_client client;
+  az_iot_hub_client_init(&client, AZ_SPAN_FROM_STR("bench.azure-devices.net"), AZ_SPAN_FROM_STR("bench"), NULL);
+  MqttTopicRouter router(&client, routes, benchC2d, benchReply, benchTwin);
+  uint32_t failures = 0;
+  sMethods = sC2d = sTwin = sReplies = sLastStatus = 0;
+  auto check = [&](bool ok, const char *what) {
+    if (ok) return;
+    failures++;
+    out.printf("[ROUTER BENCH] FAIL %s\n", what);
+  };
+
+  HeapScope tag(HeapTag::Mqtt);
+  const uint32_t allocs0 = heapTagAllocs(HeapTag::Mqtt);
+  uint32_t recognized = 0;
+  const uint32_t t0 = micros();
+  for (uint32_t r = 0; r < rounds; ++r)
+    for (uint32_t i = 0; i < TOPICS; ++i) recognized += router.route(topics[i], payload, sizeof(payload) - 1);
+  const uint32_t us = micros() - t0;
+  const uint32_t allocs = heapTagAllocs(HeapTag::Mqtt) - allocs0;
+  const uint32_t msgs = rounds * TOPICS;
+
+  check(recognized == rounds * (TOPICS - 1), "every hub topic recognized, the D2C one not");
+  check(router.methodsRouted == 2 * rounds && sMethods == 2 * rounds, "known methods dispatched");
+  check(router.methodsUnknown == rounds && sReplies == 3 * rounds, "unknown method answered");
+  check(router.c2dRouted == rounds && sC2d == rounds, "C2D delivered");
+  check(router.twinRouted == 2 * rounds && sTwin == 2 * rounds, "twin response and desired patch delivered");
+  check(router.topicsUnmatched == rounds, "D2C topic unmatched");
+  check(!heapStatsCounting() || allocs == 0, "no heap allocation while routing");
+
+  // A payload the receive path could not keep: the method answers 413 without running, C2D is dropped
+  const uint32_t methods = sMethods, c2d = sC2d;
+  router.route(topics[0], nullptr, 0, true);
+  check(sLastStatus == 413 && sMethods == methods, "rejected method payload answered 413");
+  router.route(topics[3], nullptr, 0, true);
+  check(sC2d == c2d && router.payloadsRejected == 2, "rejected C2D payload dropped");
+
+  out.printf("[ROUTER BENCH] msgs=%lu %lu msgs/s (%lu ns/msg) allocs=", (unsigned long)msgs,
+             (unsigned long)(us ? (uint64_t)msgs * 1000000 / us : 0), (unsigned long)(msgs ? (uint64_t)us * 1000 / msgs : 0));
+  if (heapStatsCounting()) out.printf("%lu", (unsigned long)allocs);
+  else out.printf("n/a (build with HEAP_STATS)");
+  out.printf(" failures=%lu\n", (unsigned long)failures);
+}
+#endif
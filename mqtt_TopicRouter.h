@@ -0,0 +1,69 @@
+#pragma once
+#include <Arduino.h>
+#include <az_iot_hub_client.h>
+#include <az_span.h>
+
+// Zero-allocation router for inbound IoT Hub topics.
+// Topics and payloads are parsed in place as az_spans (no String copies);
+// direct methods are dispatched through a compile-time table; twin
+// responses go to an optional handler. A payload the receive path could not
+// keep (rejected) still routes: methods answer 413, C2D is dropped, twin
+// handlers see an empty payload.
+
+// Result of a direct method handler: HTTP-like status + response body (strict JSON).
+struct MqttMethodResult
+{
+    int status;
+    const char *body;
+};
+
+typedef MqttMethodResult (*MqttMethodHandler)(az_span payload);
+typedef void (*MqttC2dHandler)(az_span payload);
+typedef void (*MqttMethodReply)(az_span requestId, int status, const char *body);
+typedef void (*MqttTwinHandler)(const az_iot_hub_client_twin_response &response, az_span payload);
+
+struct MqttMethodRoute
+{
+    const char *name;
+    MqttMethodHandler handler;
+};
+
+// Declares one entry of a method table, e.g.
+//   static const MqttMethodRoute kRoutes[] = { MQTT_METHOD("relayOff", onRelayOff) };
+#define MQTT_METHOD(name, fn) { name, fn }
+
+class MqttTopicRouter
+{
+public:
+    template <size_t N>
+    MqttTopicRouter(az_iot_hub_client *c, const MqttMethodRoute (&routes)[N],
+                    MqttC2dHandler c2d, MqttMethodReply reply, MqttTwinHandler twin = nullptr)
+        : client(c), methodRoutes(routes), methodCount(N), onC2d(c2d), onReply(reply), onTwin(twin) {}
+
+    // Returns true when the topic was recognized (method, twin or C2D).
+    bool route(char *topic, const uint8_t *payload, unsigned int length, bool rejected = false);
+
+    // Counters (no heap; sent with the task metrics as {"router":{...}})
+    uint32_t methodsRouted = 0;
+    uint32_t methodsUnknown = 0;
+    uint32_t c2dRouted = 0;
+    uint32_t twinRouted = 0;
+    uint32_t topicsUnmatched = 0;
+    uint32_t payloadsRejected = 0;
+
+private:
+    const MqttMethodRoute *findMethod(az_span name) const;
+
+    az_iot_hub_client *client;
+    const MqttMethodRoute *methodRoutes;
+    size_t methodCount;
+    MqttC2dHandler onC2d;
+    MqttMethodReply onReply;
+    MqttTwinHandler onTwin;
+};
+
+#if defined(ROUTER_BENCH)
+// Routes a method/twin/C2D/unmatched topic corpus 'rounds' times through stub
+// handlers: msgs/s, and with HEAP_STATS the allocations (must be 0); prints to 'out'
+void topicRouterBenchmark(Print &out, uint32_t rounds = 10000);
+#endif
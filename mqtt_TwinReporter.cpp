@@ -0,0 +1,77 @@
+#include "mqtt_TwinReporter.h"
+#include "mqtt_PayloadStream.h"
+
+void MqttTwinReporter::changed()
+{
+  if (dirty) twinStats.coalesced++;
+  dirty = true;
+}
+
+void MqttTwinReporter::connected()
+{
+  inFlight = false; // a response to the old session will not come
+  dirty = true;
+  sentOnce = false; // first report of a session goes out at once
+}
+
+void MqttTwinReporter::poll(uint32_t now)
+{
+  if (inFlight) {
+    if (now - lastSentMs < ACK_TIMEOUT_MS) return;
+    inFlight = false;
+    twinStats.timeouts++;
+    dirty = true;
+  }
+  const bool heartbeat = sentOnce && now - lastSentMs >= TWIN_HEARTBEAT_S * 1000UL;
+  if (!dirty && !heartbeat) return;
+  if (sentOnce && now - lastSentMs < interval) return; // coalescing window
+  publish(now);
+}
+
+bool MqttTwinReporter::publish(uint32_t now)
+{
+  TwinReport r;
+  if (fill) fill(r);
+  const int n = snprintf(body, sizeof(body),
+                         "{\"relay\":{\"levels\":%lu,\"channels\":%u},\"uptimeS\":%lu,"
+                         "\"conn\":{\"connects\":%lu,\"failures\":%lu,\"tlsFull\":%lu,\"tlsResumed\":%lu,\"rssi\":%ld}}",
+                         (unsigned long)r.relays, (unsigned)r.channels, (unsigned long)r.uptimeS,
+                         (unsigned long)r.connects, (unsigned long)r.connFailures, (unsigned long)r.tlsFull,
+                         (unsigned long)r.tlsResumed, (long)r.rssi);
+  snprintf(ridBuf, sizeof(ridBuf), "%lu", (unsigned long)nextRid++);
+
+  // Counts as an attempt either way: a failed publish retries after the interval
+  lastSentMs = now;
+  sentOnce = true;
+  size_t topicLen = 0;
+  if (n <= 0 || (size_t)n >= sizeof(body) ||
+      az_result_failed(az_iot_hub_client_twin_patch_get_publish_topic(
+          client, az_span_create_from_str(ridBuf), topicBuf, sizeof(topicBuf), &topicLen)) ||
+      !mqttPublish(mqtt, topicBuf, (const uint8_t *)body, (size_t)n))
+    return false;
+
+  dirty = false;
+  inFlight = true;
+  twinStats.published++;
+  return true;
+}
+
+void MqttTwinReporter::onResponse(const az_iot_hub_client_twin_response &r, uint32_t now)
+{
+  if (r.response_type != AZ_IOT_HUB_CLIENT_TWIN_RESPONSE_TYPE_REPORTED_PROPERTIES) return;
+  if (!inFlight || !az_span_is_content_equal(r.request_id, az_span_create_from_str(ridBuf))) return;
+  inFlight = false;
+  const int status = (int)r.status;
+  twinStats.lastStatus = status;
+  if (status >= 200 && status < 300) {
+    twinStats.acked++;
+    interval = TWIN_MIN_INTERVAL_MS;
+  } else if (status == 429) {
+    twinStats.throttled++;
+    interval = std::min<uint32_t>(interval * 2, TWIN_MAX_INTERVAL_MS);
+    lastSentMs = now; // the window restarts from the refusal
+    dirty = true;
+  } else {
+    twinStats.rejected++;
+  }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <az_iot_hub_client.h>
+#include <az_span.h>
+#include "mqtt_MethodResponder.h" // MQTT_TOPIC_MAX
+
+// Device twin reported properties (relay state, uptime, connection stats).
+// State changes only mark the report dirty; poll() publishes the latest
+// snapshot at most once per interval (at once when idle, at the end of the
+// window otherwise), so a burst of commands costs one twin update. A 429
+// from the hub doubles the interval; a reconnect resends the snapshot.
+
+#ifndef TWIN_MIN_INTERVAL_MS
+#define TWIN_MIN_INTERVAL_MS 5000
+#endif
+#ifndef TWIN_MAX_INTERVAL_MS
+#define TWIN_MAX_INTERVAL_MS 300000 // cap while throttled
+#endif
+#ifndef TWIN_HEARTBEAT_S
+#define TWIN_HEARTBEAT_S 3600       // refresh uptime/stats without a change
+#endif
+
+// Filled by the app right before each publish
+struct TwinReport
+{
+    uint32_t relays = 0;        // RelayMask of driven levels
+    uint8_t channels = 0;
+    uint32_t uptimeS = 0;
+    uint32_t connects = 0;      // completed connects (Subscribed reached)
+    uint32_t connFailures = 0;  // failed/timed-out connection steps
+    uint32_t tlsFull = 0;
+    uint32_t tlsResumed = 0;
+    int32_t rssi = 0;
+};
+typedef void (*TwinFillFn)(TwinReport &r);
+
+struct TwinStats
+{
+    uint32_t published = 0;
+    uint32_t acked = 0;       // 2xx
+    uint32_t throttled = 0;   // 429
+    uint32_t rejected = 0;    // other statuses
+    uint32_t timeouts = 0;    // no response within the ack timeout
+    uint32_t coalesced = 0;   // changes folded into an already pending report
+    int lastStatus = 0;
+};
+
+class MqttTwinReporter
+{
+public:
+    static constexpr uint32_t ACK_TIMEOUT_MS = 10000;
+
+    MqttTwinReporter(az_iot_hub_client *c, PubSubClient &m, TwinFillFn f) : client(c), mqtt(m), fill(f) {}
+
+    const char *responseTopic() const { return AZ_IOT_HUB_CLIENT_TWIN_RESPONSE_SUBSCRIBE_TOPIC; }
+
+    void changed();                  // reported state changed; coalesced
+    void connected();                // after (re)subscribing: resend the snapshot
+    void poll(uint32_t now);         // call every tick while online
+    void onResponse(const az_iot_hub_client_twin_response &r, uint32_t now);
+
+    uint32_t intervalMs() const { return interval; }
+    const TwinStats &stats() const { return twinStats; }
+
+private:
+    bool publish(uint32_t now);
+
+    az_iot_hub_client *client;
+    PubSubClient &mqtt;
+    TwinFillFn fill;
+
+    char topicBuf[MQTT_TOPIC_MAX];
+    char body[256];
+    char ridBuf[12] = "";
+    uint32_t nextRid = 1;
+
+    bool dirty = false;
+    bool inFlight = false;
+    bool sentOnce = false;
+    uint32_t lastSentMs = 0;
+    uint32_t interval = TWIN_MIN_INTERVAL_MS;
+    TwinStats twinStats;
+};
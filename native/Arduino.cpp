@@ -0,0 +1,140 @@
+#include "Arduino.h"
+#include "WiFi.h"
+#include <chrono>
+#include <thread>
+#include <random>
+#include <mutex>
+#include <unistd.h>
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+EspClass ESP;
+
+// --- Time (monotonic, from process start) ---
+static const std::chrono::steady_clock::time_point s_start = std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+  using namespace std::chrono;
+  return (unsigned long)(uint32_t)duration_cast<milliseconds>(steady_clock::now() - s_start).count();
+}
+
+unsigned long micros()
+{
+  using namespace std::chrono;
+  return (unsigned long)(uint32_t)duration_cast<microseconds>(steady_clock::now() - s_start).count();
+}
+
+uint32_t EspClass::getCycleCount()
+{
+  using namespace std::chrono;
+  return (uint32_t)duration_cast<nanoseconds>(steady_clock::now() - s_start).count();
+}
+
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+void yield() { std::this_thread::yield(); }
+
+void configTime(long, int, const char *, const char *, const char *) {}
+
+#if !defined(__GLIBC__) || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+  }
+  return len;
+}
+#endif
+
+// --- GPIO: pin levels are only remembered (CADIOT_TRACE_GPIO=1 prints writes) ---
+static std::atomic<uint8_t> s_pins[64];
+static const bool s_traceGpio = getenv("CADIOT_TRACE_GPIO") != nullptr;
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  s_pins[pin & 63] = val ? HIGH : LOW;
+  if (s_traceGpio) fprintf(stderr, "[gpio] %lu pin %u = %u\n", millis(), pin, val ? 1u : 0u);
+}
+
+int digitalRead(uint8_t pin) { return s_pins[pin & 63]; }
+
+// --- random() ---
+static std::mutex s_rngMux;
+static std::minstd_rand s_rng(1);
+
+void randomSeed(unsigned long seed)
+{
+  std::lock_guard<std::mutex> lock(s_rngMux);
+  s_rng.seed((uint32_t)seed);
+}
+
+long random(long min, long max)
+{
+  if (max <= min) return min;
+  std::lock_guard<std::mutex> lock(s_rngMux);
+  return min + (long)(s_rng() % (unsigned long)(max - min));
+}
+
+long random(long max) { return random(0, max); }
+
+// --- Print / Serial ---
+size_t Print::printf(const char *fmt, ...)
+{
+  char small[256];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(small, sizeof(small), fmt, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  if ((size_t)n < sizeof(small)) return write((const uint8_t *)small, (size_t)n);
+
+  std::string big((size_t)n + 1, '\0');
+  va_start(ap, fmt);
+  vsnprintf(&big[0], big.size(), fmt, ap);
+  va_end(ap);
+  return write((const uint8_t *)big.data(), (size_t)n);
+}
+
+size_t HardwareSerial::write(uint8_t b) { return write(&b, 1); }
+
+static thread_local uint32_t t_serialWrites;
+static thread_local uint64_t t_serialBytes;
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t size)
+{
+  t_serialWrites++;
+  t_serialBytes += size;
+  return fwrite(buf, 1, size, stdout);
+}
+
+uint32_t HardwareSerial::threadWrites() { return t_serialWrites; }
+uint64_t HardwareSerial::threadBytes() { return t_serialBytes; }
+
+void HardwareSerial::flush() { fflush(stdout); }
+
+String IPAddress::toString() const
+{
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(buf);
+}
+
+// --- WiFi ---
+int WiFiClass::begin(const char *s, const char *, int32_t, const uint8_t *, bool)
+{
+  ssid = s ? s : "";
+  started = true;
+  return WL_CONNECTED;
+}
+
+bool WiFiClass::disconnect(bool, bool)
+{
+  started = false;
+  return true;
+}
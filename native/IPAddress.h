@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include "WString.h"
+
+class IPAddress
+{
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+    IPAddress(uint32_t v) { for (int i = 0; i < 4; ++i) bytes[i] = (uint8_t)(v >> (8 * i)); }
+
+    operator uint32_t() const
+    {
+        return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    }
+    uint8_t operator[](int i) const { return bytes[i & 3]; }
+    uint8_t &operator[](int i) { return bytes[i & 3]; }
+    bool operator==(const IPAddress &o) const { return (uint32_t)*this == (uint32_t)o; }
+    String toString() const;
+
+private:
+    uint8_t bytes[4] = {0, 0, 0, 0};
+};
@@ -0,0 +1,30 @@
+#pragma once
+// Host shim of the M5Unified subset ui_M5CoreS3Ui uses: M5.Display is a 320x240 RecordingCanvas.
+#include "RecordingCanvas.h"
+
+class M5GFX : public RecordingCanvas
+{
+public:
+    M5GFX() : RecordingCanvas(240, 320) {}
+    void wakeup() {}
+    void powerSaveOff() {}
+    void setBrightness(uint8_t) {}
+};
+
+namespace m5
+{
+class M5Unified
+{
+public:
+    struct config_t
+    {
+    };
+    config_t config() const { return config_t(); }
+    void begin(const config_t &) {}
+    void update() {}
+
+    M5GFX Display;
+};
+} // namespace m5
+
+extern m5::M5Unified M5;
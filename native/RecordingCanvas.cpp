@@ -0,0 +1,117 @@
+#include "RecordingCanvas.h"
+#include "M5Unified.h"
+
+CanvasStats RecordingCanvas::totals;
+m5::M5Unified M5;
+
+static constexpr uint32_t WINDOW_BYTES = 11; // CASET(1+4) + RASET(1+4) + RAMWR(1)
+static constexpr uint32_t UNKNOWN = 0xFFFFFFFFUL; // panel RAM before the first write
+
+RecordingCanvas::RecordingCanvas(int16_t width, int16_t height)
+    : baseW(width), baseH(height), w(width), h(height), px((size_t)width * height, UNKNOWN)
+{
+}
+
+void RecordingCanvas::setRotation(uint8_t r)
+{
+  w = (r & 1) ? baseH : baseW;
+  h = (r & 1) ? baseW : baseH;
+}
+
+void RecordingCanvas::window(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t value)
+{
+  if (x < 0) { rw += x; x = 0; }
+  if (y < 0) { rh += y; y = 0; }
+  if (x + rw > w) rw = w - x;
+  if (y + rh > h) rh = h - y;
+  if (rw <= 0 || rh <= 0) return;
+  totals.busBytes += WINDOW_BYTES + 2ULL * rw * rh;
+  totals.pixels += (uint64_t)rw * rh;
+  for (int32_t j = y; j < y + rh; ++j) {
+    uint32_t *row = &px[(size_t)j * w];
+    for (int32_t i = x; i < x + rw; ++i) {
+      if (row[i] == value) totals.overdraw++;
+      row[i] = value;
+    }
+  }
+}
+
+void RecordingCanvas::fillRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color)
+{
+  totals.fills++;
+  window(x, y, rw, rh, color);
+}
+
+void RecordingCanvas::fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color)
+{
+  totals.fills++;
+  for (int32_t dy = -r; dy <= r; ++dy) { // one span per row, as TFT_eSPI does
+    int32_t dx = 0;
+    while ((dx + 1) * (dx + 1) + dy * dy <= r * r) dx++;
+    window(x - dx, y + dy, 2 * dx + 1, 1, color);
+  }
+}
+
+void RecordingCanvas::drawPixel(int32_t x, int32_t y, uint32_t color)
+{
+  totals.draws++;
+  window(x, y, 1, 1, color);
+}
+
+void RecordingCanvas::drawFastHLine(int32_t x, int32_t y, int32_t len, uint32_t color)
+{
+  totals.draws++;
+  window(x, y, len, 1, color);
+}
+
+void RecordingCanvas::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color)
+{
+  totals.draws++;
+  const int32_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+  const int32_t dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+  for (int32_t err = dx + dy;;) { // Bresenham, one window per pixel
+    window(x0, y0, 1, 1, color);
+    if (x0 == x1 && y0 == y1) break;
+    const int32_t e2 = 2 * err;
+    if (e2 >= dy) { err += dy; x0 += sx; }
+    if (e2 <= dx) { err += dx; y0 += sy; }
+  }
+}
+
+void RecordingCanvas::drawRoundRect(int32_t x, int32_t y, int32_t rw, int32_t rh, int32_t, uint32_t color)
+{
+  totals.draws++;
+  window(x, y, rw, 1, color);
+  window(x, y + rh - 1, rw, 1, color);
+  window(x, y + 1, 1, rh - 2, color);
+  window(x + rw - 1, y + 1, 1, rh - 2, color);
+}
+
+// A 6x8 cell per glyph (GLCD font), painted with its background in one window
+void RecordingCanvas::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size)
+{
+  totals.draws++;
+  totals.glyphs++;
+  const uint32_t value = 0x80000000UL | (((uint32_t)c << 16) ^ (color * 31 + bg) ^ ((uint32_t)size << 28));
+  window(x, y, 6 * size, 8 * size, value);
+}
+
+size_t RecordingCanvas::write(uint8_t c)
+{
+  if (c == '\n') {
+    cx = 0;
+    cy += 8 * textSize;
+  } else if (c != '\r') {
+    drawChar(cx, cy, c, textFg, textBg, textSize);
+    totals.draws--; // counted as part of the print
+    cx += 6 * textSize;
+  }
+  return 1;
+}
+
+size_t RecordingCanvas::write(const uint8_t *buf, size_t size)
+{
+  totals.prints++;
+  for (size_t i = 0; i < size; ++i) write(buf[i]);
+  return size;
+}
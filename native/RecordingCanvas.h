@@ -0,0 +1,79 @@
+#pragma once
+// Host stand-in for a display panel ([env:native]): the TFT_eSPI and M5GFX
+// shims draw into it, so an unmodified UI adapter can be measured on Linux.
+// Nothing is rasterized; each pixel keeps a value (the color, or a hash of
+// glyph + colors for text cells) so a write that leaves a pixel unchanged is
+// counted as overdraw. Bus bytes model an SPI panel: every primitive opens an
+// address window (CASET + RASET + RAMWR, 11 bytes), then 2 bytes per pixel.
+#include "Arduino.h"
+#include <vector>
+
+// Colors and datums shared by the TFT_eSPI and M5GFX shims (RGB565)
+#define TFT_BLACK     0x0000
+#define TFT_NAVY      0x000F
+#define TFT_MAROON    0x7800
+#define TFT_DARKGREY  0x7BEF
+#define TFT_BLUE      0x001F
+#define TFT_GREEN     0x07E0
+#define TFT_CYAN      0x07FF
+#define TFT_RED       0xF800
+#define TFT_YELLOW    0xFFE0
+#define TFT_WHITE     0xFFFF
+#define TFT_LIGHTGREY 0xD69A
+#define TL_DATUM 0
+
+struct CanvasStats
+{
+    uint32_t fills = 0;     // fillScreen / fillRect / fillCircle / fillRoundRect
+    uint32_t draws = 0;     // drawChar / drawLine / drawFastHLine / drawRoundRect / drawPixel
+    uint32_t prints = 0;    // print / printf calls (their glyphs are counted below)
+    uint32_t glyphs = 0;
+    uint64_t pixels = 0;    // pixel writes
+    uint64_t overdraw = 0;  // pixel writes that left the pixel as it was
+    uint64_t busBytes = 0;
+};
+
+class RecordingCanvas : public Print
+{
+public:
+    RecordingCanvas(int16_t w, int16_t h);
+
+    // Totals over every canvas since the last reset (one adapter is measured at a time)
+    static const CanvasStats &stats() { return totals; }
+    static void resetStats() { totals = CanvasStats(); }
+
+    int16_t width() const { return w; }
+    int16_t height() const { return h; }
+    void setRotation(uint8_t r);
+
+    void fillScreen(uint32_t color) { fillRect(0, 0, w, h, color); }
+    void fillRect(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t color);
+    void fillRoundRect(int32_t x, int32_t y, int32_t rw, int32_t rh, int32_t, uint32_t color) { fillRect(x, y, rw, rh, color); }
+    void fillCircle(int32_t x, int32_t y, int32_t r, uint32_t color);
+    void drawPixel(int32_t x, int32_t y, uint32_t color);
+    void drawFastHLine(int32_t x, int32_t y, int32_t len, uint32_t color);
+    void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color);
+    void drawRoundRect(int32_t x, int32_t y, int32_t rw, int32_t rh, int32_t, uint32_t color);
+    void drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size);
+
+    void setCursor(int16_t x, int16_t y) { cx = x; cy = y; }
+    void setTextSize(uint8_t s) { textSize = s ? s : 1; }
+    void setTextColor(uint16_t fg) { textFg = fg; textBg = fg; }
+    void setTextColor(uint16_t fg, uint16_t bg) { textFg = fg; textBg = bg; }
+    void setTextDatum(uint8_t) {}
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buf, size_t size) override;
+    using Print::write;
+
+private:
+    // One address window: rw x rh pixels all set to 'value'
+    void window(int32_t x, int32_t y, int32_t rw, int32_t rh, uint32_t value);
+
+    static CanvasStats totals;
+    int16_t baseW, baseH, w, h;
+    std::vector<uint32_t> px;     // per-pixel value, baseW * baseH
+    int16_t cx = 0, cy = 0;
+    uint8_t textSize = 1;
+    uint16_t textFg = TFT_WHITE, textBg = TFT_BLACK;
+};
@@ -0,0 +1,10 @@
+#pragma once
+// Host shim of the TFT_eSPI subset ui_TFT_eSPI uses: a 240x320 panel drawn into a RecordingCanvas.
+#include "RecordingCanvas.h"
+
+class TFT_eSPI : public RecordingCanvas
+{
+public:
+    TFT_eSPI() : RecordingCanvas(240, 320) {}
+    void init() {}
+};
@@ -0,0 +1,66 @@
+#include "UiBench.h"
+#include "RecordingCanvas.h"
+#include "../ui_MeteredUi.h"
+#include "../ui_HeadlessUi.h"
+#include "../ui_SSD1306Ui.h"
+#include "../ui_M5CoreS3Ui.h"
+#include "../ui_TFT_eSPI.h"
+
+// Per-call report straight to stdout, so it is not counted as adapter output
+class StdoutPrint : public Print
+{
+public:
+    size_t write(uint8_t b) override { return fwrite(&b, 1, 1, stdout); }
+    size_t write(const uint8_t *buf, size_t size) override { return fwrite(buf, 1, size, stdout); }
+};
+
+template <typename Sink>
+static void run(Sink &sink, Print &out, const char *target, uint16_t relayCommands)
+{
+  UiVirtual<Sink> erased(sink);
+  MeteredUi bench(erased);
+  StdoutPrint report;
+  fflush(stdout);
+
+  RecordingCanvas::resetStats();
+  const uint64_t b0 = HardwareSerial::threadBytes();
+  bench.begin();
+  const CanvasStats boot = RecordingCanvas::stats();
+  const uint64_t bootSerial = HardwareSerial::threadBytes() - b0;
+
+  RecordingCanvas::resetStats();
+  const uint32_t w1 = HardwareSerial::threadWrites();
+  const uint64_t b1 = HardwareSerial::threadBytes();
+  uiReplayBenchmark(bench, report, target, relayCommands);
+  const CanvasStats s = RecordingCanvas::stats();
+  const uint32_t serialWrites = HardwareSerial::threadWrites() - w1;
+  const uint64_t serialBytes = HardwareSerial::threadBytes() - b1;
+  fflush(stdout);
+
+  uint32_t events = 0; // replayed calls, begin() excluded
+  for (uint8_t c = (uint8_t)UiCall::Link; c < (uint8_t)UiCall::Count; ++c) events += bench.stats((UiCall)c).calls;
+  if (!events) events = 1;
+  out.printf("[UI BENCH][%s] begin: fills=%lu draws=%lu prints=%lu px=%llu bus=%lluB serial=%lluB\n", target,
+             (unsigned long)boot.fills, (unsigned long)boot.draws, (unsigned long)boot.prints,
+             (unsigned long long)boot.pixels, (unsigned long long)boot.busBytes, (unsigned long long)bootSerial);
+  out.printf("[UI BENCH][%s] replay: fills=%lu draws=%lu prints=%lu glyphs=%lu px=%llu overdraw=%llu (%lu%%)\n",
+             target, (unsigned long)s.fills, (unsigned long)s.draws, (unsigned long)s.prints,
+             (unsigned long)s.glyphs, (unsigned long long)s.pixels, (unsigned long long)s.overdraw,
+             (unsigned long)(s.pixels ? s.overdraw * 100 / s.pixels : 0));
+  out.printf("[UI BENCH][%s] replay: bus=%lluB (%lluB/event) serial=%lluB in %lu writes (%lluB/event)\n", target,
+             (unsigned long long)s.busBytes, (unsigned long long)(s.busBytes / events),
+             (unsigned long long)serialBytes, (unsigned long)serialWrites,
+             (unsigned long long)(serialBytes / events));
+}
+
+void uiBenchAllAdapters(Print &out, uint16_t relayCommands)
+{
+  static HeadlessUi headless;
+  static SSD1306Ui ssd1306;
+  static M5CoreS3Ui m5;
+  static TftEspiUi tft;
+  run(headless, out, "HEADLESS", relayCommands);
+  run(ssd1306, out, "SSD1306", relayCommands);
+  run(m5, out, "M5CORES3", relayCommands);
+  run(tft, out, "TFT_eSPI", relayCommands);
+}
@@ -0,0 +1,8 @@
+#pragma once
+// [env:native] -D UI_BENCH: the replay benchmark against every target's UI adapter
+#include "Arduino.h"
+
+// Replays uiReplayBenchmark through each adapter (Headless, SSD1306, M5CoreS3,
+// TFT_eSPI) and prints what it drew: canvas fill/draw/print calls, pixels,
+// overdraw and modeled SPI bytes, plus Serial bytes for the text adapters.
+void uiBenchAllAdapters(Print &out, uint16_t relayCommands = 1000);
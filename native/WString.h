@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <stdlib.h>
+#include <ctype.h>
+
+// Arduino String on top of std::string (subset).
+class String
+{
+public:
+    String() {}
+    String(const char *c) : s(c ? c : "") {}
+    String(const std::string &c) : s(c) {}
+    explicit String(char c) : s(1, c) {}
+    explicit String(int v) : s(std::to_string(v)) {}
+    explicit String(unsigned v) : s(std::to_string(v)) {}
+    explicit String(long v) : s(std::to_string(v)) {}
+    explicit String(unsigned long v) : s(std::to_string(v)) {}
+
+    const char *c_str() const { return s.c_str(); }
+    unsigned length() const { return (unsigned)s.size(); }
+    bool reserve(unsigned n) { s.reserve(n); return true; }
+    char operator[](unsigned i) const { return i < s.size() ? s[i] : 0; }
+
+    String &operator+=(const String &o) { s += o.s; return *this; }
+    String &operator+=(const char *o) { s += o ? o : ""; return *this; }
+    String &operator+=(char c) { s += c; return *this; }
+    bool concat(const char *o) { *this += o; return true; }
+
+    bool operator==(const String &o) const { return s == o.s; }
+    bool operator==(const char *o) const { return s == (o ? o : ""); }
+    bool operator!=(const String &o) const { return s != o.s; }
+
+    bool startsWith(const String &p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+    bool endsWith(const String &p) const
+    {
+        return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0;
+    }
+    int indexOf(char c, unsigned from = 0) const { return pos(s.find(c, from)); }
+    int indexOf(const String &p, unsigned from = 0) const { return pos(s.find(p.s, from)); }
+    String substring(unsigned from) const { return from < s.size() ? String(s.substr(from)) : String(); }
+    String substring(unsigned from, unsigned to) const
+    {
+        return from < to && from < s.size() ? String(s.substr(from, to - from)) : String();
+    }
+    long toInt() const { return strtol(s.c_str(), nullptr, 10); }
+    void toLowerCase() { for (char &c : s) c = (char)tolower((unsigned char)c); }
+    void toUpperCase() { for (char &c : s) c = (char)toupper((unsigned char)c); }
+
+    friend String operator+(String a, const String &b) { a += b; return a; }
+    friend String operator+(String a, const char *b) { a += b; return a; }
+
+private:
+    static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+    std::string s;
+};
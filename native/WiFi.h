@@ -0,0 +1,40 @@
+#pragma once
+#include "Arduino.h"
+
+// The host network is always "associated"; begin() only records the SSID.
+#define WL_IDLE_STATUS 0
+#define WL_NO_SSID_AVAIL 1
+#define WL_CONNECTED 3
+#define WL_CONNECT_FAILED 4
+#define WL_DISCONNECTED 6
+#define WIFI_STA 1
+
+class WiFiClass
+{
+public:
+    int begin(const char *ssid, const char *pass = nullptr, int32_t channel = 0,
+              const uint8_t *bssid = nullptr, bool connect = true);
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    bool mode(int m) { (void)m; return true; }
+    void persistent(bool p) { (void)p; }
+    bool config(IPAddress ip, IPAddress gw, IPAddress mask, IPAddress dns = IPAddress())
+    {
+        (void)ip; (void)gw; (void)mask; (void)dns;
+        return true;
+    }
+    int status() const { return started ? WL_CONNECTED : WL_DISCONNECTED; }
+    IPAddress localIP() const { return IPAddress(127, 0, 0, 1); }
+    int RSSI() const { return 0; }
+    int32_t channel() const { return 0; }
+    uint8_t *BSSID() { return nullptr; } // no AP: the fast-boot cache stays empty
+    IPAddress gatewayIP() const { return IPAddress(127, 0, 0, 1); }
+    IPAddress subnetMask() const { return IPAddress(255, 0, 0, 0); }
+    IPAddress dnsIP(uint8_t n = 0) const { (void)n; return IPAddress(127, 0, 0, 1); }
+    String SSID() const { return ssid; }
+
+private:
+    bool started = false;
+    String ssid;
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,19 @@
+#pragma once
+// Host shim: a touch panel that is never pressed (the IRQ line stays high)
+#include "SPI.h"
+
+class TS_Point
+{
+public:
+    int16_t x = 0, y = 0, z = 0;
+};
+
+class XPT2046_Touchscreen
+{
+public:
+    XPT2046_Touchscreen(uint8_t cs, uint8_t irq = 255) { (void)cs; (void)irq; }
+    bool begin(SPIClass &) { return true; }
+    void setRotation(uint8_t) {}
+    bool tirqTouched() { return false; }
+    TS_Point getPoint() { return TS_Point(); }
+};
@@ -0,0 +1,7 @@
+#pragma once
+// Placement attributes are meaningless on the host; RTC_NOINIT data simply
+// starts zeroed (like a cold power-on).
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
@@ -0,0 +1,136 @@
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include <Arduino.h>
+#include <chrono>
+#include <condition_variable>
+#include <vector>
+#include <thread>
+
+struct NativeTask
+{
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notify = 0;
+};
+
+// Threads not created through xTaskCreate (e.g. main) get a handle lazily
+static thread_local NativeTask *t_self = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *, uint32_t, void *arg,
+                                   UBaseType_t, TaskHandle_t *handle, BaseType_t)
+{
+  NativeTask *t = new NativeTask();
+  if (handle) *handle = t;
+  std::thread([t, fn, arg]() {
+    t_self = t;
+    fn(arg);
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stackDepth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle)
+{
+  return xTaskCreatePinnedToCore(fn, name, stackDepth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  if (!t_self) t_self = new NativeTask();
+  return t_self;
+}
+
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+
+void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t period)
+{
+  *previousWake += period;
+  const int32_t wait = (int32_t)(*previousWake - xTaskGetTickCount());
+  if (wait > 0) vTaskDelay((TickType_t)wait);
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+  if (!task) return;
+  {
+    std::lock_guard<std::mutex> lock(task->m);
+    task->notify++;
+  }
+  task->cv.notify_one();
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+  xTaskNotifyGive(task);
+  if (woken) *woken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait)
+{
+  NativeTask *t = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(t->m);
+  auto ready = [t]() { return t->notify != 0; };
+  if (ticksToWait == portMAX_DELAY) t->cv.wait(lock, ready);
+  else t->cv.wait_for(lock, std::chrono::milliseconds(ticksToWait), ready);
+
+  const uint32_t v = t->notify;
+  if (v) t->notify = clearOnExit ? 0 : v - 1;
+  return v;
+}
+
+// --- Queues ---
+struct NativeQueue
+{
+  std::mutex m;
+  std::condition_variable cv;
+  std::vector<uint8_t> buf;
+  size_t itemSize, length, head = 0, count = 0;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+  NativeQueue *q = new NativeQueue();
+  q->buf.resize((size_t)length * itemSize);
+  q->itemSize = itemSize;
+  q->length = length;
+  return q;
+}
+
+template <typename Pred>
+static bool waitFor(NativeQueue *q, std::unique_lock<std::mutex> &lock, TickType_t ticks, Pred ready)
+{
+  if (ticks == portMAX_DELAY) {
+    q->cv.wait(lock, ready);
+    return true;
+  }
+  return q->cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticksToWait)
+{
+  std::unique_lock<std::mutex> lock(q->m);
+  if (!waitFor(q, lock, ticksToWait, [q]() { return q->count < q->length; })) return pdFALSE;
+  memcpy(&q->buf[((q->head + q->count) % q->length) * q->itemSize], item, q->itemSize);
+  q->count++;
+  q->cv.notify_all();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticksToWait)
+{
+  std::unique_lock<std::mutex> lock(q->m);
+  if (!waitFor(q, lock, ticksToWait, [q]() { return q->count > 0; })) return pdFALSE;
+  memcpy(item, &q->buf[q->head * q->itemSize], q->itemSize);
+  q->head = (q->head + 1) % q->length;
+  q->count--;
+  q->cv.notify_all();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+  std::lock_guard<std::mutex> lock(q->m);
+  return (UBaseType_t)q->count;
+}
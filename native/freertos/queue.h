@@ -0,0 +1,10 @@
+#pragma once
+#include "FreeRTOS.h"
+
+// Fixed-size item queue (copy in, copy out), as in FreeRTOS
+typedef struct NativeQueue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticksToWait);
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticksToWait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
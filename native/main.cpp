@@ -0,0 +1,18 @@
+// [env:native] entry point: the sketch is compiled unmodified as a Linux process.
+//   CADIOT_RUN_SECONDS=N  exit cleanly after N seconds (profiling runs)
+//   CADIOT_TRACE_GPIO=1   print relay pin writes to stderr
+#include "../CadIOT-ESP32.ino"
+
+int main()
+{
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  const char *runFor = getenv("CADIOT_RUN_SECONDS");
+  const unsigned long stopAtMs = runFor ? (unsigned long)atol(runFor) * 1000UL : 0;
+
+  setup();
+  while (!stopAtMs || millis() < stopAtMs) loop();
+
+  dlog::flush();
+  fflush(stdout);
+  quick_exit(0); // task threads are still running; skip static destructors
+}
@@ -0,0 +1,263 @@
+#include "net_ConnectionFsm.h"
+
+const char *ConnectionFsm::name(ConnState s)
+{
+  switch (s) {
+    case ConnState::WiFi:        return "WiFi";
+    case ConnState::Time:        return "Time";
+    case ConnState::Credentials: return "Credentials";
+    case ConnState::Tls:         return "TLS";
+    case ConnState::Mqtt:        return "MQTT";
+    case ConnState::Subscribed:  return "Subscribed";
+    default:                     return "?";
+  }
+}
+
+void ConnectionFsm::begin(uint32_t now)
+{
+  current = ConnState::WiFi;
+  entered = false;
+  waiting = false;
+  failStreak = 0;
+  enteredAtMs = now;
+}
+
+void ConnectionFsm::moveTo(ConnState s, uint32_t now, bool failed)
+{
+  if (observer) observer(current, s, now - enteredAtMs, failed);
+  current = s;
+  entered = false;
+  enteredAtMs = now;
+}
+
+uint32_t ConnectionFsm::nextBackoffMs()
+{
+  uint8_t shift = failStreak > 0 ? failStreak - 1 : 0;
+  if (shift > 16) shift = 16;
+  uint32_t d = backoffBaseMs << shift;
+  if (d > backoffMaxMs || d < backoffBaseMs) d = backoffMaxMs;
+  uint32_t span = (uint32_t)((uint64_t)d * backoffJitterPct / 100);
+  return d + (span ? (uint32_t)random((long)span + 1) : 0);
+}
+
+void ConnectionFsm::fail(uint32_t now)
+{
+  ConnStateStats &st = stateStats[(size_t)current];
+  st.failures++;
+  if (failStreak < 255) failStreak++;
+  moveTo(cfg[(size_t)current].fallback, now, true);
+  waiting = true;
+  retryAtMs = now + nextBackoffMs();
+}
+
+void ConnectionFsm::tick(uint32_t now)
+{
+  if (waiting) {
+    if ((int32_t)(now - retryAtMs) < 0) return;
+    waiting = false;
+  }
+
+  const ConnStateConfig &c = cfg[(size_t)current];
+  ConnStateStats &st = stateStats[(size_t)current];
+  const bool first = !entered;
+  if (first) {
+    entered = true;
+    enteredAtMs = now;
+    st.attempts++;
+  }
+
+  uint32_t t0 = micros();
+  ConnStep r = c.step(first);
+  lastStepDurUs = micros() - t0;
+  if (lastStepDurUs > maxStepDurUs) maxStepDurUs = lastStepDurUs;
+
+  if (r == ConnStep::Pending) {
+    if (c.timeoutMs && now - enteredAtMs >= c.timeoutMs) fail(now);
+    return;
+  }
+  if (r == ConnStep::Failed) {
+    fail(now);
+    return;
+  }
+
+  // Done: record timing and advance (Subscribed wraps to its fallback)
+  uint32_t elapsed = now - enteredAtMs;
+  st.lastMs = elapsed;
+  if (elapsed > st.maxMs) st.maxMs = elapsed;
+
+  ConnState next = (current == ConnState::Subscribed)
+                     ? c.fallback
+                     : (ConnState)((uint8_t)current + 1);
+  if (next == ConnState::Subscribed) failStreak = 0;
+  moveTo(next, now, false);
+}
+
+#if defined(FSM_BENCH)
+// --- Self-check: stub steps replay WiFi/NTP/TLS/MQTT outcomes on a fake clock ---
+static ConnStep sResult[(size_t)ConnState::Count]; // what each stub step returns
+static uint32_t sCalls[(size_t)ConnState::Count];
+static uint32_t sTransitions, sFailedTransitions;
+static ConnState sLastTo;
+
+static ConnStep stub(ConnState s)
+{
+  sCalls[(size_t)s]++;
+  return sResult[(size_t)s];
+}
+static ConnStep stubWiFi(bool)        { return stub(ConnState::WiFi); }
+static ConnStep stubTime(bool)        { return stub(ConnState::Time); }
+static ConnStep stubCredentials(bool) { return stub(ConnState::Credentials); }
+static ConnStep stubTls(bool)         { return stub(ConnState::Tls); }
+static ConnStep stubMqtt(bool)        { return stub(ConnState::Mqtt); }
+static ConnStep stubSubscribed(bool)  { return stub(ConnState::Subscribed); }
+
+static void stubTransition(ConnState, ConnState to, uint32_t, bool failed)
+{
+  sTransitions++;
+  if (failed) sFailedTransitions++;
+  sLastTo = to;
+}
+
+void connectionFsmBenchmark(Print &out)
+{
+  static const ConnStateConfig states[] = {
+    /* WiFi        */ { stubWiFi,        20000, ConnState::WiFi },
+    /* Time        */ { stubTime,        15000, ConnState::Time },
+    /* Credentials */ { stubCredentials, 0,     ConnState::Credentials },
+    /* Tls         */ { stubTls,         0,     ConnState::WiFi },
+    /* Mqtt        */ { stubMqtt,        0,     ConnState::WiFi },
+    /* Subscribed  */ { stubSubscribed,  0,     ConnState::WiFi },
+  };
+  static const uint32_t BASE = 500, MAX = 60000;
+  static const uint8_t JITTER = 25;
+  ConnectionFsm fsm(states, stubTransition);
+  fsm.setBackoff(BASE, MAX, JITTER);
+  for (size_t i = 0; i < (size_t)ConnState::Count; ++i) sResult[i] = ConnStep::Done;
+  sResult[(size_t)ConnState::Subscribed] = ConnStep::Pending;
+
+  uint32_t now = 1000, checks = 0, failures = 0;
+  auto check = [&](bool ok, const char *what) {
+    checks++;
+    if (!ok) {
+      failures++;
+      out.printf("[FSM BENCH] FAIL %s (state=%s now=%lu)\n", what, ConnectionFsm::name(fsm.state()),
+                 (unsigned long)now);
+    }
+  };
+  // After the k-th consecutive failure the retry is due in [d, d + d*JITTER/100]
+  auto backoffOk = [&](uint8_t k) {
+    uint32_t d = k > 17 ? MAX : BASE << (k - 1);
+    if (d > MAX) d = MAX;
+    const uint32_t in = fsm.retryInMs(now);
+    return fsm.backingOff() && in >= d && in <= d + d * JITTER / 100;
+  };
+  // Ticks 10 ms apart (as the network task does) until online, backing off or 'limit' ticks
+  auto run = [&](uint32_t limit) {
+    for (uint32_t i = 0; i < limit; ++i) {
+      fsm.tick(now);
+      if (fsm.online() || fsm.backingOff()) return;
+      now += 10;
+    }
+  };
+
+  // Clean connect: one tick per state
+  fsm.begin(now);
+  run(10);
+  check(fsm.online() && sTransitions == 5 && !sFailedTransitions, "clean connect");
+  now += 10;
+  fsm.tick(now); // subscribe
+  for (size_t i = 0; i < (size_t)ConnState::Count; ++i) check(fsm.stats((ConnState)i).attempts == 1, "one attempt per state");
+  now += 10;
+
+  // MQTT refused while online: back to WiFi after the base backoff
+  sResult[(size_t)ConnState::Subscribed] = ConnStep::Failed;
+  fsm.tick(now);
+  check(fsm.state() == ConnState::WiFi && sLastTo == ConnState::WiFi && !fsm.online(), "link loss falls back to WiFi");
+  check(fsm.consecutiveFailures() == 1 && fsm.stats(ConnState::Subscribed).failures == 1, "link loss counted");
+  check(backoffOk(1), "first backoff within [base, base+jitter]");
+  sResult[(size_t)ConnState::Subscribed] = ConnStep::Pending;
+
+  // No step runs before the retry is due
+  const uint32_t wifiCalls = sCalls[(size_t)ConnState::WiFi];
+  const uint32_t due = now + fsm.retryInMs(now);
+  now = due - 1;
+  fsm.tick(now);
+  check(sCalls[(size_t)ConnState::WiFi] == wifiCalls && fsm.backingOff(), "no step during backoff");
+
+  // TLS handshake fails repeatedly: backoff doubles up to the cap, WiFi restarts each time
+  sResult[(size_t)ConnState::Tls] = ConnStep::Failed;
+  now = due;
+  for (uint8_t k = 2; k <= 12; ++k) {
+    now += fsm.retryInMs(now);
+    run(10);
+    check(fsm.state() == ConnState::WiFi && fsm.consecutiveFailures() == k, "TLS failure falls back to WiFi");
+    check(backoffOk(k), "backoff doubles, capped at max+jitter");
+  }
+  check(fsm.stats(ConnState::Tls).failures == 11, "TLS failures counted");
+  check(fsm.retryInMs(now) >= MAX, "backoff reached the cap");
+
+  // TLS recovers: the streak resets once subscribed
+  sResult[(size_t)ConnState::Tls] = ConnStep::Done;
+  now += fsm.retryInMs(now);
+  run(10);
+  check(fsm.online() && fsm.consecutiveFailures() == 0, "recovery resets the failure streak");
+
+  // Voluntary reconnect (SAS renewal): Subscribed returns Done, no backoff
+  sResult[(size_t)ConnState::Subscribed] = ConnStep::Done;
+  fsm.tick(now);
+  check(fsm.state() == ConnState::WiFi && !fsm.backingOff(), "voluntary reconnect without backoff");
+  sResult[(size_t)ConnState::Subscribed] = ConnStep::Pending;
+
+  // NTP never answers: Time times out after 15 s and retries itself
+  sResult[(size_t)ConnState::Time] = ConnStep::Pending;
+  run(2); // WiFi done, Time entered
+  const uint32_t timeEntered = now - 10;
+  const uint32_t timeFailures = fsm.stats(ConnState::Time).failures;
+  while (!fsm.backingOff() && now - timeEntered < 30000) {
+    now += 10;
+    fsm.tick(now);
+  }
+  check(fsm.stats(ConnState::Time).failures == timeFailures + 1, "NTP timeout counted");
+  check(now - timeEntered == 15000, "NTP timeout fires at 15 s");
+  check(fsm.state() == ConnState::Time && backoffOk(1), "NTP timeout retries Time after backoff");
+
+  // A bad key stays in Credentials; MQTT refused goes back to WiFi, whose join then stalls (20 s timeout)
+  sResult[(size_t)ConnState::Time] = ConnStep::Done;
+  sResult[(size_t)ConnState::Credentials] = ConnStep::Failed;
+  now += fsm.retryInMs(now);
+  run(3);
+  check(fsm.state() == ConnState::Credentials && fsm.backingOff() && backoffOk(2), "credentials failure retries itself");
+  sResult[(size_t)ConnState::Credentials] = ConnStep::Done;
+  sResult[(size_t)ConnState::Mqtt] = ConnStep::Failed;
+  sResult[(size_t)ConnState::WiFi] = ConnStep::Pending;
+  now += fsm.retryInMs(now);
+  run(10);
+  check(fsm.state() == ConnState::WiFi && backoffOk(3), "MQTT failure falls back to WiFi");
+  now += fsm.retryInMs(now);
+  const uint32_t wifiEntered = now;
+  const uint32_t wifiFailures = fsm.stats(ConnState::WiFi).failures;
+  fsm.tick(now);
+  while (!fsm.backingOff() && now - wifiEntered < 40000) {
+    now += 10;
+    fsm.tick(now);
+  }
+  check(fsm.stats(ConnState::WiFi).failures == wifiFailures + 1 && backoffOk(4), "WiFi timeout backs off");
+  check(now - wifiEntered == 20000, "WiFi timeout fires at 20 s");
+
+  // Jitter spread: many first failures stay within the bounds
+  sResult[(size_t)ConnState::WiFi] = ConnStep::Failed;
+  uint32_t lo = UINT32_MAX, hi = 0;
+  for (uint32_t i = 0; i < 1000; ++i) {
+    fsm.begin(now);
+    fsm.tick(now);
+    const uint32_t in = fsm.retryInMs(now);
+    if (in < lo) lo = in;
+    if (in > hi) hi = in;
+  }
+  check(lo >= BASE && hi <= BASE + BASE * JITTER / 100 && hi > lo, "jitter spread within bounds");
+
+  out.printf("[FSM BENCH] checks=%lu failures=%lu transitions=%lu failed=%lu jitter=%lu..%lums maxStep=%luus\n",
+             (unsigned long)checks, (unsigned long)failures, (unsigned long)sTransitions,
+             (unsigned long)sFailedTransitions, (unsigned long)lo, (unsigned long)hi, (unsigned long)fsm.maxStepUs());
+}
+#endif
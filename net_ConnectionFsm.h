@@ -0,0 +1,100 @@
+#pragma once
+#include <Arduino.h>
+
+// Tick-driven connectivity state machine:
+//   WiFi -> Time -> Credentials -> Tls -> Mqtt -> Subscribed
+// Each state is driven by a non-blocking step function supplied by the app.
+// Steps return Pending until done; failures/timeouts back off with jitter.
+
+enum class ConnState : uint8_t
+{
+    WiFi = 0,
+    Time,
+    Credentials,
+    Tls,
+    Mqtt,
+    Subscribed,
+    Count
+};
+
+enum class ConnStep : uint8_t
+{
+    Pending, // keep polling this state
+    Done,    // advance to next state
+    Failed   // back off, then retry from the state's fallback
+};
+
+// Called every tick while in a state; 'entered' is true on the first call.
+typedef ConnStep (*ConnStepFn)(bool entered);
+// Optional observer for transitions (logging/UI).
+typedef void (*ConnTransitionFn)(ConnState from, ConnState to, uint32_t elapsedMs, bool failed);
+
+struct ConnStateConfig
+{
+    ConnStepFn step;
+    uint32_t timeoutMs;  // 0 = no timeout
+    ConnState fallback;  // where to resume after a failure in this state
+};
+
+struct ConnStateStats
+{
+    uint32_t lastMs = 0;     // duration of the last completed visit
+    uint32_t maxMs = 0;      // longest completed visit
+    uint32_t attempts = 0;   // entries into this state
+    uint32_t failures = 0;   // failed/timed-out visits
+};
+
+class ConnectionFsm
+{
+public:
+    explicit ConnectionFsm(const ConnStateConfig (&states)[(size_t)ConnState::Count],
+                           ConnTransitionFn onTransition = nullptr)
+        : cfg(states), observer(onTransition) {}
+
+    // Backoff: base * 2^failures, capped, plus up to jitterPct% random jitter.
+    void setBackoff(uint32_t baseMs, uint32_t maxMs, uint8_t jitterPct)
+    {
+        backoffBaseMs = baseMs; backoffMaxMs = maxMs; backoffJitterPct = jitterPct;
+    }
+
+    void begin(uint32_t now);
+    void tick(uint32_t now);
+
+    ConnState state() const { return current; }
+    bool online() const { return current == ConnState::Subscribed && !waiting; }
+    bool backingOff() const { return waiting; }
+    uint32_t retryInMs(uint32_t now) const { return waiting ? (uint32_t)(retryAtMs - now) : 0; }
+    uint8_t consecutiveFailures() const { return failStreak; }
+    const ConnStateStats &stats(ConnState s) const { return stateStats[(size_t)s]; }
+    uint32_t lastStepUs() const { return lastStepDurUs; } // cost of the last step call
+    uint32_t maxStepUs() const { return maxStepDurUs; }   // worst step call so far
+
+    static const char *name(ConnState s);
+
+private:
+    void moveTo(ConnState s, uint32_t now, bool failed);
+    void fail(uint32_t now);
+    uint32_t nextBackoffMs();
+
+    const ConnStateConfig (&cfg)[(size_t)ConnState::Count];
+    ConnTransitionFn observer;
+    ConnStateStats stateStats[(size_t)ConnState::Count];
+
+    ConnState current = ConnState::WiFi;
+    bool entered = false;
+    bool waiting = false;
+    uint32_t enteredAtMs = 0;
+    uint32_t retryAtMs = 0;
+    uint32_t lastStepDurUs = 0;
+    uint32_t maxStepDurUs = 0;
+    uint8_t failStreak = 0;
+
+    uint32_t backoffBaseMs = 500;
+    uint32_t backoffMaxMs = 60000;
+    uint8_t backoffJitterPct = 25;
+};
+
+#if defined(FSM_BENCH)
+// Stub steps on a fake clock: transitions, failure counts, timeouts and backoff bounds; prints to 'out'
+void connectionFsmBenchmark(Print &out);
+#endif
@@ -0,0 +1,135 @@
+#include "net_FastBoot.h"
+#include <esp_attr.h>
+#include <sys/time.h>
+#if defined(ESP_PLATFORM)
+#include <esp_sntp.h>
+#endif
+
+// --- Association cache in RTC memory (survives soft reset / deep sleep) ---
+struct FastBootCache
+{
+  uint32_t magic;
+  uint32_t ssidHash;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t hasLease;
+  uint32_t ip, gateway, mask, dns;
+  uint32_t leaseEpoch;   // wall clock when the lease was seen (0: unknown)
+  uint32_t sum;          // checksum of the fields above (RTC_NOINIT is garbage after power-on)
+};
+RTC_NOINIT_ATTR static FastBootCache s_cache;
+static constexpr uint32_t CACHE_MAGIC = 0x46425431; // "FBT1"
+
+static volatile bool s_ntpSynced = false;
+
+static uint32_t fnv1a(const void *data, size_t n, uint32_t h = 2166136261u)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 16777619u; }
+  return h;
+}
+
+static uint32_t cacheSum() { return fnv1a(&s_cache, offsetof(FastBootCache, sum)); }
+
+static bool cacheValid(const char *ssid)
+{
+  return s_cache.magic == CACHE_MAGIC && s_cache.sum == cacheSum() &&
+         s_cache.ssidHash == fnv1a(ssid, strlen(ssid)) && s_cache.channel != 0;
+}
+
+void FastBoot::beginWiFi(const char *s, const char *p, uint32_t now)
+{
+  ssid = s;
+  pass = p;
+  joining = true;
+  joinStartMs = now;
+  WiFi.persistent(false); // no NVS write per join
+  if (!cacheValid(ssid)) {
+    scan();
+    return;
+  }
+
+  const time_t t = time(NULL);
+  const bool leaseFresh = s_cache.hasLease && s_cache.leaseEpoch >= MIN_EPOCH && t >= (time_t)MIN_EPOCH &&
+                          (uint32_t)t - s_cache.leaseEpoch < FASTBOOT_LEASE_S;
+  if (leaseFresh) {
+    WiFi.config(IPAddress(s_cache.ip), IPAddress(s_cache.gateway), IPAddress(s_cache.mask), IPAddress(s_cache.dns));
+  }
+  directedJoin = true;
+  bootStats.directed = true;
+  bootStats.leaseReused = leaseFresh;
+  WiFi.begin(ssid, pass, s_cache.channel, s_cache.bssid);
+}
+
+void FastBoot::scan()
+{
+  directedJoin = false;
+  WiFi.config(IPAddress(), IPAddress(), IPAddress()); // back to DHCP
+  WiFi.begin(ssid, pass);
+}
+
+void FastBoot::pollWiFi(uint32_t now)
+{
+  if (!joining || !directedJoin || now - joinStartMs < FASTBOOT_DIRECTED_MS) return;
+  // The AP moved, changed channel or the lease went elsewhere: forget it and scan
+  s_cache.magic = 0;
+  bootStats.directed = false;
+  bootStats.leaseReused = false;
+  bootStats.fallbacks++;
+  WiFi.disconnect();
+  scan();
+}
+
+void FastBoot::remember()
+{
+  joining = false;
+  directedJoin = false;
+  if (!ssid) return;
+  const uint8_t *b = WiFi.BSSID();
+  if (!b) return;
+  memcpy(s_cache.bssid, b, sizeof(s_cache.bssid));
+  s_cache.ssidHash = fnv1a(ssid, strlen(ssid));
+  s_cache.channel = (uint8_t)WiFi.channel();
+  s_cache.ip = (uint32_t)WiFi.localIP();
+  s_cache.gateway = (uint32_t)WiFi.gatewayIP();
+  s_cache.mask = (uint32_t)WiFi.subnetMask();
+  s_cache.dns = (uint32_t)WiFi.dnsIP();
+  s_cache.hasLease = s_cache.ip != 0 && s_cache.mask != 0;
+  if (!bootStats.leaseReused) { // a reused lease keeps its age: resets must not extend it
+    const time_t t = time(NULL);
+    // A provisional clock would make the lease look younger than it is
+    s_cache.leaseEpoch = t >= (time_t)MIN_EPOCH && !clockProvisional() ? (uint32_t)t : 0;
+  }
+  s_cache.magic = CACHE_MAGIC;
+  s_cache.sum = cacheSum();
+}
+
+bool FastBoot::leaseExpired() const
+{
+  if (!bootStats.leaseReused) return false;
+  const time_t t = time(NULL);
+  return t >= (time_t)MIN_EPOCH && (uint32_t)t - s_cache.leaseEpoch >= FASTBOOT_LEASE_S;
+}
+
+// --- Clock ---
+#if defined(ESP_PLATFORM)
+static void onNtpSync(struct timeval *) { s_ntpSynced = true; }
+#endif
+
+bool FastBoot::seedClock(uint32_t lastKnownEpoch)
+{
+#if defined(ESP_PLATFORM)
+  sntp_set_time_sync_notification_cb(onNtpSync);
+#endif
+  if (time(NULL) >= (time_t)MIN_EPOCH) return true; // kept by the RTC across the reset
+  if (lastKnownEpoch < MIN_EPOCH) return false;
+  struct timeval tv = { (time_t)lastKnownEpoch, 0 };
+  if (settimeofday(&tv, nullptr) != 0) return false;
+  bootStats.clockSeeded = true;
+  return true;
+}
+
+bool FastBoot::clockProvisional() const
+{
+  return bootStats.clockSeeded && !s_ntpSynced;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Fast-boot path for the connection state machine.
+// - WiFi: the last good association (BSSID, channel, DHCP lease) is kept in
+//   RTC memory like the TLS session, so a soft reset or deep-sleep wake
+//   joins that AP directly with the old address: no scan, no DHCP. A
+//   directed attempt that stalls drops the cache and falls back to a scan;
+//   a reused address is handed back to DHCP once FASTBOOT_LEASE_S is up.
+// - Clock: an unset clock is seeded from a last-known time (e.g. the relay
+//   state log) so WiFi and TLS can start before NTP answers. A seeded clock
+//   is provisional and may be hours old: nothing is signed on it (the app
+//   holds the SAS and MQTT CONNECT until NTP), and once TLS rejects it or
+//   NTP stays silent, the Time state waits for NTP again.
+
+#ifndef FASTBOOT_DIRECTED_MS
+#define FASTBOOT_DIRECTED_MS 4000   // directed join budget before scanning
+#endif
+#ifndef FASTBOOT_LEASE_S
+#define FASTBOOT_LEASE_S 1800       // use a DHCP lease without DHCP at most this long
+#endif
+
+struct FastBootStats
+{
+    bool directed = false;      // this boot joined the cached AP
+    bool leaseReused = false;   // ... with the cached address (no DHCP)
+    bool clockSeeded = false;   // clock set from a last-known time
+    uint32_t fallbacks = 0;     // directed attempts that had to scan
+};
+
+class FastBoot
+{
+public:
+    static constexpr uint32_t MIN_EPOCH = 1609459200; // 2021-01-01: anything earlier is unset
+
+    // Starts association (directed when the cache matches 'ssid'); call after WiFi.mode(WIFI_STA)
+    void beginWiFi(const char *ssid, const char *pass, uint32_t now);
+    // Every tick while not associated: a stalled directed join falls back to a scan
+    void pollWiFi(uint32_t now);
+    // Once associated: caches BSSID, channel and lease for the next boot
+    void remember();
+    bool associating() const { return joining; }
+    // The reused address is past FASTBOOT_LEASE_S: reconnect so DHCP takes over
+    bool leaseExpired() const;
+
+    // Sets an unset clock to 'lastKnownEpoch'; true when the clock is usable
+    bool seedClock(uint32_t lastKnownEpoch);
+    // True while the clock only holds the seed (NTP has not answered)
+    bool clockProvisional() const;
+    // The hub/TLS refused us on the seed: wait for NTP from now on
+    void distrustClock() { if (clockProvisional()) distrusted = true; }
+    bool clockUsable() const { return time(NULL) >= (time_t)MIN_EPOCH && !(distrusted && clockProvisional()); }
+
+    const FastBootStats &stats() const { return bootStats; }
+
+private:
+    void scan();
+
+    const char *ssid = nullptr;
+    const char *pass = nullptr;
+    bool joining = false;
+    bool directedJoin = false;
+    bool distrusted = false;
+    uint32_t joinStartMs = 0;
+    FastBootStats bootStats;
+};
@@ -0,0 +1,59 @@
+#include "net_SocketWait.h"
+#include <sys/select.h>
+#include <unistd.h>
+#if defined(ESP_PLATFORM)
+#include <esp_vfs_eventfd.h>
+#else
+#include <sys/eventfd.h>
+#endif
+
+bool SocketWait::begin()
+{
+  if (efd >= 0) return true;
+#if defined(ESP_PLATFORM)
+  esp_vfs_eventfd_config_t cfg = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+  esp_vfs_eventfd_register(&cfg); // ESP_ERR_INVALID_STATE if already registered: fine
+#endif
+  efd = eventfd(0, 0);
+  return efd >= 0;
+}
+
+void SocketWait::wake()
+{
+  if (efd < 0) return;
+  const uint64_t one = 1;
+  (void)!write(efd, &one, sizeof(one));
+}
+
+uint8_t SocketWait::wait(int sock, uint32_t timeoutMs)
+{
+  fd_set rd;
+  FD_ZERO(&rd);
+  int maxFd = -1;
+  if (sock >= 0) { FD_SET(sock, &rd); maxFd = sock; }
+  if (efd >= 0) { FD_SET(efd, &rd); if (efd > maxFd) maxFd = efd; }
+  if (maxFd < 0) { // no eventfd: plain sleep
+    delay(timeoutMs);
+    waitStats.timeouts++;
+    return Timeout;
+  }
+
+  struct timeval tv = { (time_t)(timeoutMs / 1000), (suseconds_t)((timeoutMs % 1000) * 1000) };
+  const int n = select(maxFd + 1, &rd, nullptr, nullptr, &tv);
+  if (n <= 0) { // timeout (or EINTR / a socket closed under us: the caller re-checks)
+    waitStats.timeouts++;
+    return Timeout;
+  }
+  uint8_t r = Timeout;
+  if (sock >= 0 && FD_ISSET(sock, &rd)) {
+    r |= Readable;
+    waitStats.readable++;
+  }
+  if (efd >= 0 && FD_ISSET(efd, &rd)) {
+    uint64_t v;
+    (void)!read(efd, &v, sizeof(v)); // resets the counter
+    r |= Woken;
+    waitStats.woken++;
+  }
+  return r;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+
+// Blocks the network task until the MQTT socket has data, another task
+// calls wake(), or a timeout. The wake side is an eventfd in the same
+// select() as the socket, so neither source waits behind a fixed sleep.
+
+struct SocketWaitStats
+{
+    uint32_t readable = 0;  // woke for socket data
+    uint32_t woken = 0;     // woke for wake()
+    uint32_t timeouts = 0;
+};
+
+class SocketWait
+{
+public:
+    enum Result : uint8_t { Timeout = 0, Readable = 1, Woken = 2 }; // Readable | Woken when both
+
+    bool begin();                    // creates the eventfd; false if unsupported
+    void wake();                     // from any task (not from an ISR)
+    // sock < 0: wake()/timeout only
+    uint8_t wait(int sock, uint32_t timeoutMs);
+
+    const SocketWaitStats &stats() const { return waitStats; }
+
+private:
+    int efd = -1;
+    SocketWaitStats waitStats;
+};
@@ -0,0 +1,307 @@
+#include "net_TlsSessionClient.h"
+#include <esp_attr.h>
+#include <mbedtls/version.h>
+
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+#define TLS_SESSION_FIELD(s, f) (s).MBEDTLS_PRIVATE(f)
+#else
+#define TLS_SESSION_FIELD(s, f) (s).f
+#endif
+
+// --- Session cache in RTC memory (survives soft reset / deep sleep) ---
+struct TlsSessionCache
+{
+  uint32_t magic;
+  uint32_t key;   // host:port hash
+  uint32_t len;
+  uint32_t sum;   // blob checksum (RTC_NOINIT is garbage after power-on)
+  uint8_t blob[TLS_SESSION_CACHE_BYTES];
+};
+RTC_NOINIT_ATTR static TlsSessionCache s_cache;
+static constexpr uint32_t CACHE_MAGIC = 0x544C5331; // "TLS1"
+
+// Hash of the master secret of the session we offered; a match after the
+// handshake means the server accepted it (works for tickets and session IDs).
+// TLS 1.2 only: a TLS 1.3 session has no master secret, so setupConfig() pins
+// the protocol to 1.2 (mbedTLS 3.x would otherwise negotiate 1.3).
+static uint32_t s_offeredMaster = 0;
+
+static uint32_t fnv1a(const uint8_t *p, size_t n, uint32_t h = 2166136261u)
+{
+  for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 16777619u; }
+  return h;
+}
+
+static uint32_t cacheKey(const char *host, uint16_t port)
+{
+  uint32_t h = fnv1a((const uint8_t *)host, strlen(host));
+  return fnv1a((const uint8_t *)&port, sizeof(port), h);
+}
+
+static uint32_t masterHash(const mbedtls_ssl_session &s)
+{
+  return fnv1a(TLS_SESSION_FIELD(s, master), sizeof(TLS_SESSION_FIELD(s, master)));
+}
+
+TlsSessionClient::TlsSessionClient()
+{
+  mbedtls_net_init(&fd);
+  mbedtls_ssl_init(&ssl);
+  mbedtls_ssl_config_init(&conf);
+  mbedtls_entropy_init(&entropy);
+  mbedtls_ctr_drbg_init(&drbg);
+  mbedtls_x509_crt_init(&ca);
+}
+
+TlsSessionClient::~TlsSessionClient()
+{
+  stop();
+  mbedtls_ssl_free(&ssl);
+  mbedtls_ssl_config_free(&conf);
+  mbedtls_x509_crt_free(&ca);
+  mbedtls_ctr_drbg_free(&drbg);
+  mbedtls_entropy_free(&entropy);
+}
+
+void TlsSessionClient::clearSession()
+{
+  s_cache.magic = 0;
+}
+
+bool TlsSessionClient::setupConfig()
+{
+  if (configured) return true;
+  int rc = mbedtls_ctr_drbg_seed(&drbg, mbedtls_entropy_func, &entropy,
+                                 (const unsigned char *)"cadiot", 6);
+  if (rc == 0 && caPem)
+    rc = mbedtls_x509_crt_parse(&ca, (const unsigned char *)caPem, strlen(caPem) + 1);
+  if (rc == 0)
+    rc = mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT,
+                                     MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+  if (rc != 0) { lastErr = rc; return false; }
+
+  mbedtls_ssl_conf_authmode(&conf, caPem ? MBEDTLS_SSL_VERIFY_REQUIRED : MBEDTLS_SSL_VERIFY_NONE);
+  mbedtls_ssl_conf_ca_chain(&conf, &ca, NULL);
+  mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &drbg);
+  mbedtls_ssl_conf_read_timeout(&conf, 1000);
+#if MBEDTLS_VERSION_NUMBER >= 0x03020000
+  mbedtls_ssl_conf_max_tls_version(&conf, MBEDTLS_SSL_VERSION_TLS1_2);
+#else
+  mbedtls_ssl_conf_max_version(&conf, MBEDTLS_SSL_MAJOR_VERSION_3, MBEDTLS_SSL_MINOR_VERSION_3);
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+  mbedtls_ssl_conf_session_tickets(&conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
+  configured = true;
+  return true;
+}
+
+void TlsSessionClient::loadSession(const char *host, uint16_t port)
+{
+  s_offeredMaster = 0;
+  if (s_cache.magic != CACHE_MAGIC || s_cache.key != cacheKey(host, port) ||
+      s_cache.len == 0 || s_cache.len > sizeof(s_cache.blob) ||
+      s_cache.sum != fnv1a(s_cache.blob, s_cache.len))
+    return;
+
+  mbedtls_ssl_session s;
+  mbedtls_ssl_session_init(&s);
+  if (mbedtls_ssl_session_load(&s, s_cache.blob, s_cache.len) == 0 &&
+      mbedtls_ssl_set_session(&ssl, &s) == 0)
+    s_offeredMaster = masterHash(s);
+  else
+    clearSession();
+  mbedtls_ssl_session_free(&s);
+}
+
+void TlsSessionClient::saveSession(const char *host, uint16_t port)
+{
+  mbedtls_ssl_session s;
+  mbedtls_ssl_session_init(&s);
+  size_t len = 0;
+  if (mbedtls_ssl_get_session(&ssl, &s) == 0)
+  {
+    hs.lastWasResumed = s_offeredMaster != 0 && masterHash(s) == s_offeredMaster;
+    if (mbedtls_ssl_session_save(&s, s_cache.blob, sizeof(s_cache.blob), &len) == 0 && len > 0)
+    {
+      s_cache.key = cacheKey(host, port);
+      s_cache.len = (uint32_t)len;
+      s_cache.sum = fnv1a(s_cache.blob, len);
+      s_cache.magic = CACHE_MAGIC;
+    }
+    else
+    {
+      clearSession(); // too large for TLS_SESSION_CACHE_BYTES; stay on full handshakes
+    }
+  }
+  mbedtls_ssl_session_free(&s);
+}
+
+void TlsSessionClient::fail(int err)
+{
+  lastErr = err;
+  close();
+}
+
+void TlsSessionClient::close()
+{
+  open = false;
+  mbedtls_ssl_free(&ssl);
+  mbedtls_ssl_init(&ssl);
+  mbedtls_net_free(&fd);
+  mbedtls_net_init(&fd);
+}
+
+int TlsSessionClient::connect(IPAddress ip, uint16_t port)
+{
+  return connect(ip.toString().c_str(), port);
+}
+
+int TlsSessionClient::connect(const char *host, uint16_t port)
+{
+  stop();
+  if (!setupConfig()) return 0;
+
+  char portStr[6];
+  snprintf(portStr, sizeof(portStr), "%u", (unsigned)port);
+  int rc = mbedtls_net_connect(&fd, host, portStr, MBEDTLS_NET_PROTO_TCP);
+  if (rc == 0) rc = mbedtls_ssl_setup(&ssl, &conf);
+  if (rc == 0) rc = mbedtls_ssl_set_hostname(&ssl, host);
+  if (rc != 0) { fail(rc); return 0; }
+  mbedtls_ssl_set_bio(&ssl, &fd, mbedtls_net_send, NULL, mbedtls_net_recv_timeout);
+
+  hs.lastWasResumed = false; // set by saveSession() only if the server took our session
+  loadSession(host, port);
+
+  const uint32_t t0 = millis();
+  while ((rc = mbedtls_ssl_handshake(&ssl)) != 0)
+  {
+    const bool retry = rc == MBEDTLS_ERR_SSL_WANT_READ || rc == MBEDTLS_ERR_SSL_WANT_WRITE ||
+                       rc == MBEDTLS_ERR_SSL_TIMEOUT;
+    if (!retry || millis() - t0 > handshakeTimeoutMs)
+    {
+      if (s_offeredMaster) clearSession(); // don't keep offering a session that breaks handshakes
+      hs.failed++;
+      fail(rc);
+      return 0;
+    }
+  }
+  hs.lastMs = millis() - t0;
+
+  saveSession(host, port);
+  if (hs.lastWasResumed) { hs.resumed++; hs.lastResumedMs = hs.lastMs; }
+  else                   { hs.full++;    hs.lastFullMs = hs.lastMs; }
+
+  // Switch to non-blocking I/O for the MQTT session
+  mbedtls_net_set_nonblock(&fd);
+  mbedtls_ssl_set_bio(&ssl, &fd, mbedtls_net_send, mbedtls_net_recv, NULL);
+  open = true;
+  return 1;
+}
+
+size_t TlsSessionClient::write(const uint8_t *buf, size_t size)
+{
+  size_t done = 0;
+  const uint32_t t0 = millis();
+  while (open && done < size)
+  {
+    int r = mbedtls_ssl_write(&ssl, buf + done, size - done);
+    if (r > 0) { done += (size_t)r; continue; }
+    if (r != MBEDTLS_ERR_SSL_WANT_WRITE && r != MBEDTLS_ERR_SSL_WANT_READ) { fail(r); break; }
+    if (millis() - t0 > 5000) break;
+    delay(1);
+  }
+  return done;
+}
+
+int TlsSessionClient::available()
+{
+  if (!open) return 0;
+  int n = (int)mbedtls_ssl_get_bytes_avail(&ssl);
+  if (n == 0)
+  {
+    // Pump one record without consuming application data
+    int r = mbedtls_ssl_read(&ssl, NULL, 0);
+    if (r < 0 && r != MBEDTLS_ERR_SSL_WANT_READ && r != MBEDTLS_ERR_SSL_WANT_WRITE)
+    {
+      fail(r);
+      return peeked >= 0 ? 1 : 0;
+    }
+    n = (int)mbedtls_ssl_get_bytes_avail(&ssl);
+  }
+  return n + (peeked >= 0 ? 1 : 0);
+}
+
+int TlsSessionClient::read(uint8_t *buf, size_t size)
+{
+  if (size == 0) return 0;
+  size_t off = 0;
+  if (peeked >= 0) { buf[off++] = (uint8_t)peeked; peeked = -1; }
+  if (!open || off == size) return off ? (int)off : -1;
+
+  int r = mbedtls_ssl_read(&ssl, buf + off, size - off);
+  if (r > 0) return (int)off + r;
+  if (r == 0 || (r != MBEDTLS_ERR_SSL_WANT_READ && r != MBEDTLS_ERR_SSL_WANT_WRITE)) fail(r);
+  return off ? (int)off : -1;
+}
+
+int TlsSessionClient::read()
+{
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int TlsSessionClient::peek()
+{
+  if (peeked < 0 && available() > 0) peeked = read();
+  return peeked;
+}
+
+void TlsSessionClient::stop()
+{
+  if (open) mbedtls_ssl_close_notify(&ssl);
+  close();
+  peeked = -1;
+}
+
+uint8_t TlsSessionClient::connected()
+{
+  return open || peeked >= 0;
+}
+
+#if defined(TLS_BENCH)
+// --- Check: full handshake, then resumed ones, against a local TLS server ---
+void tlsResumptionBenchmark(Print &out, const char *host, uint16_t port, const char *caPem, uint8_t rounds)
+{
+  static TlsSessionClient c; // mbedTLS contexts are too large for the setup() stack
+  c.setCACert(caPem);
+  c.clearSession();
+  uint32_t checks = 0, failures = 0, fullMs = 0, resumedMs = 0, nFull = 0, nResumed = 0;
+
+  auto handshake = [&](bool wantResumed, const char *what) {
+    checks++;
+    const bool ok = c.connect(host, port) && c.stats().lastWasResumed == wantResumed;
+    if (!ok) {
+      failures++;
+      out.printf("[TLS BENCH] FAIL %s (resumed=%d err=-0x%04x)\n", what, c.stats().lastWasResumed, -c.lastError());
+    } else {
+      (wantResumed ? resumedMs : fullMs) += c.stats().lastMs;
+      (wantResumed ? nResumed : nFull)++;
+    }
+    c.stop();
+  };
+
+  handshake(false, "first handshake is full");
+  for (uint8_t i = 0; i < rounds; ++i) handshake(true, "reconnect resumes the session");
+  c.clearSession(); // as after a power cycle
+  handshake(false, "no cached session: full handshake");
+  handshake(true, "resumes again after a full handshake");
+
+  const TlsHandshakeStats &s = c.stats();
+  out.printf("[TLS BENCH] %s:%u checks=%lu failures=%lu full=%lu resumed=%lu failed=%lu\n", host, (unsigned)port,
+             (unsigned long)checks, (unsigned long)failures, (unsigned long)s.full, (unsigned long)s.resumed,
+             (unsigned long)s.failed);
+  out.printf("[TLS BENCH] full avg=%lums resumed avg=%lums\n", (unsigned long)(nFull ? fullMs / nFull : 0),
+             (unsigned long)(nResumed ? resumedMs / nResumed : 0));
+}
+#endif
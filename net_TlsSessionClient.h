@@ -0,0 +1,93 @@
+#pragma once
+#include <Arduino.h>
+#include <Client.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/x509_crt.h>
+
+// TLS client (Arduino Client over mbedTLS) with session resumption.
+// WiFiClientSecure has no session API, so this owns the mbedTLS context and
+// offers the last session (ticket or session ID) on every reconnect. The
+// serialized session lives in RTC memory so it survives soft resets and
+// deep sleep; a stale/rejected session simply falls back to a full handshake.
+// The protocol is pinned to TLS 1.2: resumption is detected from the session's
+// master secret, which TLS 1.3 (tickets as PSKs) does not have.
+
+#ifndef TLS_SESSION_CACHE_BYTES
+#define TLS_SESSION_CACHE_BYTES 3072
+#endif
+
+struct TlsHandshakeStats
+{
+    uint32_t lastMs = 0;        // duration of the last handshake (TCP excluded)
+    uint32_t lastFullMs = 0;    // last full handshake
+    uint32_t lastResumedMs = 0; // last abbreviated handshake
+    uint32_t full = 0;
+    uint32_t resumed = 0;
+    uint32_t failed = 0;
+    bool lastWasResumed = false;
+};
+
+class TlsSessionClient : public Client
+{
+public:
+    TlsSessionClient();
+    ~TlsSessionClient();
+
+    void setCACert(const char *pem) { caPem = pem; }
+    void setHandshakeTimeout(uint32_t ms) { handshakeTimeoutMs = ms; }
+    void clearSession();
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char *host, uint16_t port) override;
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+    int connect(IPAddress ip, uint16_t port, int32_t) override { return connect(ip, port); }
+    int connect(const char *host, uint16_t port, int32_t) override { return connect(host, port); }
+#endif
+    size_t write(uint8_t b) override { return write(&b, 1); }
+    size_t write(const uint8_t *buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size) override;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+
+    const TlsHandshakeStats &stats() const { return hs; }
+    int lastError() const { return lastErr; }
+    int socketFd() const { return open ? fd.fd : -1; } // for select()
+    // Decrypted but unread: the socket will not turn readable for these
+    size_t pendingBytes() const { return open ? mbedtls_ssl_get_bytes_avail(&ssl) + (peeked >= 0 ? 1 : 0) : 0; }
+
+private:
+    bool setupConfig();
+    void loadSession(const char *host, uint16_t port);
+    void saveSession(const char *host, uint16_t port);
+    void fail(int err);
+    void close();
+
+    const char *caPem = nullptr;
+    uint32_t handshakeTimeoutMs = 15000;
+    bool configured = false;
+    bool open = false;
+    int peeked = -1;
+    int lastErr = 0;
+    TlsHandshakeStats hs;
+
+    mbedtls_net_context fd;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_x509_crt ca;
+};
+
+#if defined(TLS_BENCH)
+// Connects to host:port 'rounds' + 3 times: the first handshake must be full,
+// reconnects resumed, and a cleared cache full again; prints to 'out'
+void tlsResumptionBenchmark(Print &out, const char *host, uint16_t port, const char *caPem, uint8_t rounds = 5);
+#endif
@@ -0,0 +1,227 @@
+#include "relay_PulseEngine.h"
+
+static inline RelayMask bit(uint8_t ch) { return (RelayMask)1 << ch; }
+
+void RelayPulseEngine::apply(RelayMask want, RelayMask claim, const char *src)
+{
+  want &= RELAY_ALL;
+  level = write ? (write(want, claim & want, src) & RELAY_ALL) : want;
+  disarm(RELAY_ALL & ~level); // a timed OFF is moot once the channel is OFF
+}
+
+void RelayPulseEngine::disarm(RelayMask mask)
+{
+  for (uint8_t ch = 0; ch < RELAY_CHANNELS; ++ch) {
+    if (mask & bit(ch)) timers[ch].armed = false;
+  }
+}
+
+void RelayPulseEngine::on(uint8_t ch, const char *src)
+{
+  if (ch >= RELAY_CHANNELS) return;
+  setMask(bit(ch), 0, src);
+}
+
+void RelayPulseEngine::off(uint8_t ch, const char *src)
+{
+  if (ch >= RELAY_CHANNELS) return;
+  setMask(0, bit(ch), src);
+}
+
+bool RelayPulseEngine::onFor(uint8_t ch, uint32_t ms, const char *src, uint32_t now)
+{
+  return ch < RELAY_CHANNELS && onForMask(bit(ch), ms, src, now);
+}
+
+bool RelayPulseEngine::cancel(uint8_t ch)
+{
+  return ch < RELAY_CHANNELS && cancelMask(bit(ch)) != 0;
+}
+
+void RelayPulseEngine::setMask(RelayMask onMask, RelayMask offMask, const char *src)
+{
+  onMask &= RELAY_ALL;
+  offMask &= RELAY_ALL & ~onMask;
+  disarm(onMask | offMask);
+  apply((level | onMask) & ~offMask, onMask, src);
+}
+
+bool RelayPulseEngine::onForMask(RelayMask mask, uint32_t ms, const char *src, uint32_t now)
+{
+  mask &= RELAY_ALL;
+  if (!mask || ms < MIN_PULSE_MS || ms > MAX_PULSE_MS) return false;
+  for (uint8_t ch = 0; ch < RELAY_CHANNELS; ++ch) {
+    if (mask & bit(ch)) timers[ch] = { now + ms, src, true };
+  }
+  if ((level & mask) != mask) apply(level | mask, mask, src);
+  return (level & mask) == mask; // false if an interlock refused a channel
+}
+
+RelayMask RelayPulseEngine::cancelMask(RelayMask mask)
+{
+  RelayMask hit = 0;
+  for (uint8_t ch = 0; ch < RELAY_CHANNELS; ++ch) {
+    if ((mask & bit(ch)) && timers[ch].armed) {
+      timers[ch].armed = false;
+      hit |= bit(ch);
+    }
+  }
+  return hit;
+}
+
+RelayMask RelayPulseEngine::pendingMask() const
+{
+  RelayMask m = 0;
+  for (uint8_t ch = 0; ch < RELAY_CHANNELS; ++ch) {
+    if (timers[ch].armed) m |= bit(ch);
+  }
+  return m;
+}
+
+uint32_t RelayPulseEngine::nextDueMs(uint32_t now) const
+{
+  uint32_t next = UINT32_MAX;
+  for (uint8_t ch = 0; ch < RELAY_CHANNELS; ++ch) {
+    if (!timers[ch].armed) continue;
+    const int32_t left = (int32_t)(timers[ch].dueMs - now);
+    if (left <= 0) return 0;
+    if ((uint32_t)left < next) next = (uint32_t)left;
+  }
+  return next;
+}
+
+uint32_t RelayPulseEngine::remainingMs(uint8_t ch, uint32_t now) const
+{
+  if (!pending(ch)) return 0;
+  int32_t left = (int32_t)(timers[ch].dueMs - now);
+  return left > 0 ? (uint32_t)left : 0;
+}
+
+void RelayPulseEngine::poll(uint32_t now)
+{
+  if (polled) {
+    uint32_t gap = now - lastPollMs;
+    if (gap > maxPollGapMs) maxPollGapMs = gap;
+  }
+  lastPollMs = now;
+  polled = true;
+
+  // Pulses due in the same tick end together (one write)
+  RelayMask due = 0;
+  const char *src = nullptr;
+  for (uint8_t ch = 0; ch < RELAY_CHANNELS; ++ch) {
+    Timer &t = timers[ch];
+    if (!t.armed || (int32_t)(now - t.dueMs) < 0) continue;
+    t.armed = false;
+    lastLateMs = now - t.dueMs;
+    if (lastLateMs > maxLateMs) maxLateMs = lastLateMs;
+    pulsesFired++;
+    due |= bit(ch);
+    if (!src) src = t.src;
+  }
+  if (due) apply(level & ~due, 0, src);
+}
+
+#if defined(PULSE_BENCH)
+// --- Self-check: overlapping pulses on a fake clock (no GPIO) ---
+static RelayMask sDriven;
+static uint32_t sWrites;
+
+static RelayMask mockWrite(RelayMask levels, RelayMask, const char *)
+{
+  sDriven = levels;
+  sWrites++;
+  return levels;
+}
+
+void relayPulseBenchmark(Print &out, uint32_t commands)
+{
+  const uint8_t n = RELAY_CHANNELS < 8 ? RELAY_CHANNELS : 8;
+  uint32_t checks = 0, failures = 0, ends = 0, polls = 0, pollUs = 0;
+  uint32_t due[RELAY_CHANNELS] = {};
+  RelayMask armed = 0; // model: channels in a pulse
+  uint32_t now = 0xFFFF0000UL; // the clock wraps during the run
+
+  auto check = [&](bool ok, const char *what) {
+    checks++;
+    if (!ok) {
+      failures++;
+      out.printf("[PULSE BENCH] FAIL %s now=%lu driven=0x%lx armed=0x%lx\n", what, (unsigned long)now,
+                 (unsigned long)sDriven, (unsigned long)armed);
+    }
+  };
+  // Channels whose deadline has passed in the model
+  auto dueNow = [&]() {
+    RelayMask m = 0;
+    for (uint8_t ch = 0; ch < n; ++ch) {
+      if ((armed >> ch & 1) && (int32_t)(now - due[ch]) >= 0) m |= bit(ch);
+    }
+    return m;
+  };
+  auto poll = [&](RelayPulseEngine &e) {
+    const RelayMask ending = dueNow();
+    const uint32_t w0 = sWrites;
+    const uint32_t t0 = micros();
+    e.poll(now);
+    pollUs += micros() - t0;
+    polls++;
+    armed &= ~ending;
+    ends += __builtin_popcount(ending);
+    check(sDriven == armed && e.levels() == armed && e.pendingMask() == armed, "levels after poll");
+    check(sWrites - w0 == (ending ? 1u : 0u), "pulses due together end in one write");
+  };
+  // Random pulses on random channel groups; a channel already ON is retriggered
+  auto command = [&](RelayPulseEngine &e) {
+    const RelayMask mask = (RelayMask)random(1, (long)(1UL << n));
+    const uint32_t ms = (uint32_t)random(RelayPulseEngine::MIN_PULSE_MS, 500);
+    check(e.onForMask(mask, ms, "bench", now), "pulse accepted");
+    for (uint8_t ch = 0; ch < n; ++ch) {
+      if (mask >> ch & 1) due[ch] = now + ms;
+    }
+    armed |= mask;
+    check(sDriven == armed, "levels after pulse");
+  };
+
+  // Event-driven, as loop(): sleep until nextDueMs() or the next command; every end is on time
+  randomSeed(1);
+  {
+    RelayPulseEngine e(mockWrite);
+    sDriven = 0;
+    for (uint32_t i = 0; i < commands || armed; ++i) {
+      const uint32_t until = now + (uint32_t)random(300);
+      for (uint32_t d; (d = e.nextDueMs(now)) != UINT32_MAX && (int32_t)(now + d - until) <= 0;) {
+        now += d;
+        poll(e);
+      }
+      now = until;
+      if (i < commands) command(e);
+    }
+    check(e.maxLateMs == 0 && e.pulsesFired == ends, "event-driven: every pulse ends on its deadline");
+    out.printf("[PULSE BENCH] event-driven channels=%u pulses=%lu late.max=%lums\n", (unsigned)n,
+               (unsigned long)e.pulsesFired, (unsigned long)e.maxLateMs);
+  }
+
+  // Fixed tick (a loop that only polls every TICK ms): an end is at most one tick late
+  static constexpr uint32_t TICK = 5;
+  {
+    RelayPulseEngine e(mockWrite);
+    sDriven = 0;
+    ends = 0;
+    for (uint32_t i = 0; i < commands || armed; ++i) {
+      const uint32_t until = now + (uint32_t)random(300);
+      while ((int32_t)(until - now) >= (int32_t)TICK) {
+        now += TICK;
+        poll(e);
+      }
+      if (i < commands) command(e);
+    }
+    check(e.maxLateMs < TICK && e.pulsesFired == ends, "fixed tick: lateness below one tick");
+    out.printf("[PULSE BENCH] tick=%lums pulses=%lu late.max=%lums pollGap.max=%lums\n", (unsigned long)TICK,
+               (unsigned long)e.pulsesFired, (unsigned long)e.maxLateMs, (unsigned long)e.maxPollGapMs);
+  }
+
+  out.printf("[PULSE BENCH] checks=%lu failures=%lu polls=%lu avgPoll=%luns\n", (unsigned long)checks,
+             (unsigned long)failures, (unsigned long)polls,
+             (unsigned long)(polls ? (uint64_t)pollUs * 1000 / polls : 0));
+}
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+#include <Arduino.h>
+
+// Non-blocking relay actuation scheduler.
+// Owns every relay transition; timed actions (pulse / on-for-N-ms) are armed
+// as per-channel deadlines and fired from poll(), called each loop().
+// Levels are kept as a channel bitmask so group changes reach the output
+// stage as one write.
+
+#ifndef RELAY_CHANNELS
+#define RELAY_CHANNELS 1
+#endif
+static_assert(RELAY_CHANNELS >= 1 && RELAY_CHANNELS <= 32, "RELAY_CHANNELS must be 1..32");
+
+typedef uint32_t RelayMask; // bit n = channel n
+
+static constexpr RelayMask RELAY_ALL =
+    RELAY_CHANNELS == 32 ? 0xFFFFFFFFUL : ((1UL << RELAY_CHANNELS) - 1);
+
+// Performs the physical transition (GPIO + log/UI). Called only by the engine.
+// 'levels' is the wanted state of every channel, 'claim' the channels this
+// request switches ON explicitly; returns the levels actually driven (an
+// interlock may refuse a claim or force channels OFF).
+typedef RelayMask (*RelayWriteFn)(RelayMask levels, RelayMask claim, const char *src);
+
+class RelayPulseEngine
+{
+public:
+    static constexpr uint32_t MIN_PULSE_MS = 10;
+    static constexpr uint32_t MAX_PULSE_MS = 3600000UL; // 1 h
+
+    explicit RelayPulseEngine(RelayWriteFn w) : write(w) {}
+
+    void on(uint8_t ch, const char *src);   // latch ON (drops any pending OFF)
+    void off(uint8_t ch, const char *src);  // OFF now (drops any pending OFF)
+    bool onFor(uint8_t ch, uint32_t ms, const char *src, uint32_t now); // ON, then OFF after ms
+    bool cancel(uint8_t ch);                // drop pending OFF; relay keeps its level
+
+    // Group forms: every channel in the masks changes in one write
+    void setMask(RelayMask onMask, RelayMask offMask, const char *src);
+    bool onForMask(RelayMask mask, uint32_t ms, const char *src, uint32_t now);
+    RelayMask cancelMask(RelayMask mask);   // returns the channels that had a pending OFF
+
+    void poll(uint32_t now);
+
+    bool isOn(uint8_t ch) const { return ch < RELAY_CHANNELS && (level >> ch) & 1; }
+    bool pending(uint8_t ch) const { return ch < RELAY_CHANNELS && timers[ch].armed; }
+    RelayMask levels() const { return level; }
+    RelayMask pendingMask() const;          // channels with a timed OFF armed
+    uint32_t nextDueMs(uint32_t now) const; // until the earliest timed OFF; UINT32_MAX if none
+    uint32_t remainingMs(uint8_t ch, uint32_t now) const;
+
+    // Accuracy/latency stats (ms)
+    uint32_t lastLateMs = 0;   // how late the last timed OFF fired
+    uint32_t maxLateMs = 0;    // worst timed OFF lateness
+    uint32_t maxPollGapMs = 0; // worst gap between poll() calls (loop latency)
+    uint32_t pulsesFired = 0;
+
+private:
+    struct Timer
+    {
+        uint32_t dueMs;
+        const char *src;
+        bool armed;
+    };
+
+    void apply(RelayMask want, RelayMask claim, const char *src);
+    void disarm(RelayMask mask);
+
+    RelayWriteFn write;
+    Timer timers[RELAY_CHANNELS] = {};
+    RelayMask level = 0;
+    uint32_t lastPollMs = 0;
+    bool polled = false;
+};
+
+#if defined(PULSE_BENCH)
+// Overlapping random pulses on a fake clock (mock write, no GPIO): every pulse
+// must end on its deadline, due pulses in one write; prints to 'out'
+void relayPulseBenchmark(Print &out, uint32_t commands = 2000);
+#endif
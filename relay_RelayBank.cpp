@@ -0,0 +1,186 @@
+#include "relay_RelayBank.h"
+#if defined(ESP_PLATFORM)
+#include <soc/gpio_struct.h>
+#include <soc/soc_caps.h>
+#endif
+
+void relayGpioPort(const uint32_t clr[2], const uint32_t set[2])
+{
+#if defined(ESP_PLATFORM)
+  GPIO.out_w1tc = clr[0];
+#if SOC_GPIO_PIN_COUNT > 32
+  if (clr[1]) GPIO.out1_w1tc.val = clr[1];
+#endif
+  GPIO.out_w1ts = set[0];
+#if SOC_GPIO_PIN_COUNT > 32
+  if (set[1]) GPIO.out1_w1ts.val = set[1];
+#endif
+#else
+  // Native build: no port registers; per-pin writes keep the GPIO trace
+  for (uint8_t w = 0; w < 2; ++w) {
+    for (uint8_t b = 0; b < 32; ++b) {
+      if (clr[w] >> b & 1) digitalWrite(w * 32 + b, LOW);
+    }
+  }
+  for (uint8_t w = 0; w < 2; ++w) {
+    for (uint8_t b = 0; b < 32; ++b) {
+      if (set[w] >> b & 1) digitalWrite(w * 32 + b, HIGH);
+    }
+  }
+#endif
+}
+
+RelayBank::RelayBank(const uint8_t *p, uint8_t n, RelayPortFn fn)
+  : pins(p), count(n > RELAY_CHANNELS ? RELAY_CHANNELS : n), port(fn),
+    allMask(count >= 32 ? 0xFFFFFFFFUL : ((1UL << count) - 1))
+{
+}
+
+void RelayBank::begin()
+{
+  uint32_t clr[2] = { 0, 0 }, set[2] = { 0, 0 };
+  for (uint8_t ch = 0; ch < count; ++ch) {
+    pinMode(pins[ch], OUTPUT);
+    clr[pins[ch] >> 5] |= 1UL << (pins[ch] & 31);
+  }
+  port(clr, set);
+  driven = 0;
+}
+
+bool RelayBank::addInterlock(RelayMask group)
+{
+  group &= allMask;
+  if (groupCount >= RELAY_MAX_INTERLOCKS || !(group & (group - 1))) return false;
+  groups[groupCount++] = group;
+  return true;
+}
+
+bool RelayBank::allowed(RelayMask m) const
+{
+  for (uint8_t i = 0; i < groupCount; ++i) {
+    const RelayMask on = m & groups[i];
+    if (on & (on - 1)) return false;
+  }
+  return true;
+}
+
+RelayMask RelayBank::resolve(RelayMask want, RelayMask claim) const
+{
+  RelayMask out = want & allMask;
+  for (uint8_t i = 0; i < groupCount; ++i) {
+    const RelayMask g = groups[i];
+    const RelayMask on = out & g;
+    if (!(on & (on - 1))) continue;          // zero or one ON: fine
+    const RelayMask c = claim & on;
+    if (c && !(c & (c - 1))) out &= ~(g & ~c); // the claimed channel wins
+    else out = (out & ~g) | (driven & g);    // ambiguous: group keeps its state
+  }
+  // Overlapping groups can still conflict after the pass; refuse the change then
+  return allowed(out) ? out : driven;
+}
+
+RelayMask RelayBank::commit(RelayMask want, RelayMask claim)
+{
+  const RelayMask next = resolve(want, claim);
+  if (next != (want & allMask)) bankStats.interlockTrips++;
+  const RelayMask changed = next ^ driven;
+  if (!changed) return driven;
+
+  uint32_t clr[2] = { 0, 0 }, set[2] = { 0, 0 };
+  for (uint8_t ch = 0; ch < count; ++ch) {
+    if (!(changed >> ch & 1)) continue;
+    const uint8_t pin = pins[ch];
+    (next >> ch & 1 ? set : clr)[pin >> 5] |= 1UL << (pin & 31);
+  }
+  port(clr, set);
+  bankStats.commits++;
+  driven = next;
+  return driven;
+}
+
+#if defined(RELAY_BENCH)
+// --- Benchmark / self-check (mock port: nothing physical switches) ---
+static uint32_t mockOut[2];
+static uint32_t mockWrites;
+
+static void mockPort(const uint32_t clr[2], const uint32_t set[2])
+{
+  for (uint8_t w = 0; w < 2; ++w) mockOut[w] = (mockOut[w] & ~clr[w]) | set[w];
+  mockWrites++;
+}
+
+void relayBankBenchmark(Print &out, uint32_t iterations)
+{
+  // Channels 0-3 on one port, 4 on the high port; 0/1 and 2/3 interlocked
+  static const uint8_t pins[] = { 2, 4, 5, 18, 33 };
+  static const uint8_t n = sizeof(pins) / sizeof(pins[0]) < RELAY_CHANNELS
+                               ? sizeof(pins) / sizeof(pins[0]) : RELAY_CHANNELS;
+  RelayBank bank(pins, n, mockPort);
+  mockOut[0] = mockOut[1] = 0xFFFFFFFFUL;
+  mockWrites = 0;
+  bank.begin();
+  bank.addInterlock(0x3);
+  bank.addInterlock(0xC);
+
+  auto pinsOf = [&](RelayMask m, uint8_t w) {
+    uint32_t v = 0;
+    for (uint8_t ch = 0; ch < n; ++ch) {
+      if ((m >> ch & 1) && pins[ch] >> 5 == w) v |= 1UL << (pins[ch] & 31);
+    }
+    return v;
+  };
+  uint32_t checks = 0, failures = 0;
+  auto expect = [&](RelayMask want, RelayMask wantDriven) {
+    const uint32_t w0 = mockWrites;
+    const RelayMask before = bank.levels();
+    const RelayMask got = bank.commit(want);
+    const RelayMask exp = wantDriven & bank.all();
+    checks++;
+    bool ok = got == exp && bank.levels() == exp &&
+              mockOut[0] == (pinsOf(exp, 0) | (mockOut[0] & ~pinsOf(bank.all(), 0))) &&
+              mockOut[1] == (pinsOf(exp, 1) | (mockOut[1] & ~pinsOf(bank.all(), 1))) &&
+              mockWrites - w0 == (exp != before ? 1u : 0u);
+    if (!ok) {
+      failures++;
+      out.printf("[RELAY BENCH] FAIL want=0x%lx got=0x%lx expected=0x%lx\n",
+                 (unsigned long)want, (unsigned long)got, (unsigned long)exp);
+    }
+  };
+
+  // Mask semantics
+  expect(0x00, 0x00);
+  expect(0x01, 0x01);
+  expect(0x15, 0x15);        // group ON across both ports: one write
+  expect(0x10, 0x10);        // group OFF
+  expect(0xFFFFFFE0, 0x00);  // bits beyond the bank are ignored
+  // Interlocks (needs both groups in the bank)
+  if (n >= 4) {
+    expect(0x01, 0x01);
+    expect(0x03, 0x02);        // ch1 requested while ch0 ON: ch1 wins, ch0 OFF
+    expect(0x0A, 0x0A);        // other group independent
+    expect(0x0E, 0x06);        // ch2 wins over ch3
+    expect(0x0F, 0x09);        // ch0 and ch3 newly requested: both win their groups
+    expect(0x00, 0x00);
+    expect(0x03, 0x00);        // both of a group at once: refused
+    expect(0x0F, 0x00);
+    expect(0x05, 0x05);
+    expect(0x06, 0x06);
+    checks++;                  // group request claiming both ch0 and ch1: refused as a whole
+    if (bank.commit(0x07, 0x03) != 0x06) {
+      failures++;
+      out.printf("[RELAY BENCH] FAIL claim=0x3 got=0x%lx expected=0x6\n", (unsigned long)bank.levels());
+    }
+  }
+
+  // Commit cost: alternate all-ON-allowed / all-OFF
+  const RelayMask a = 0x15 & bank.all();
+  const uint32_t t0 = micros();
+  for (uint32_t i = 0; i < iterations; ++i) bank.commit(i & 1 ? a : 0);
+  const uint32_t us = micros() - t0;
+
+  out.printf("[RELAY BENCH] channels=%u checks=%lu failures=%lu trips=%lu\n", (unsigned)n,
+             (unsigned long)checks, (unsigned long)failures, (unsigned long)bank.stats().interlockTrips);
+  out.printf("[RELAY BENCH] commits=%lu avg=%luns (one port write per commit)\n",
+             (unsigned long)iterations, (unsigned long)(iterations ? (uint64_t)us * 1000 / iterations : 0));
+}
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+#include <Arduino.h>
+#include "relay_PulseEngine.h"
+
+// Multi-channel relay output stage.
+// Each channel maps to a GPIO; commit() turns a target mask into per-port
+// clear/set words and writes them through the W1TC/W1TS registers, so all
+// channels on one port change on the same cycle (OFF edges first, i.e.
+// break-before-make). Interlock groups allow at most one ON channel each.
+
+#ifndef RELAY_MAX_INTERLOCKS
+#define RELAY_MAX_INTERLOCKS 8
+#endif
+
+// Port words cover GPIO 0-31 ([0]) and 32-63 ([1]); writes 'clr' then 'set'
+typedef void (*RelayPortFn)(const uint32_t clr[2], const uint32_t set[2]);
+void relayGpioPort(const uint32_t clr[2], const uint32_t set[2]);
+
+struct RelayBankStats
+{
+    uint32_t commits = 0;        // port writes
+    uint32_t interlockTrips = 0; // commits where an interlock changed the request
+};
+
+class RelayBank
+{
+public:
+    RelayBank(const uint8_t *pins, uint8_t count, RelayPortFn port = relayGpioPort);
+
+    void begin();                        // outputs, every channel OFF in one write
+    bool addInterlock(RelayMask group);  // false: table full or fewer than 2 channels
+
+    // Applies interlocks to 'want' given the current levels (no I/O).
+    // 'claim' holds the channels the request switches ON explicitly (default:
+    // those not ON yet). A single claimed channel wins its group (the others
+    // go OFF); claiming two channels of one group leaves that group unchanged.
+    RelayMask resolve(RelayMask want, RelayMask claim) const;
+    RelayMask commit(RelayMask want) { return commit(want, want & ~driven); }
+    RelayMask commit(RelayMask want, RelayMask claim); // resolve + write; returns the levels driven
+
+    RelayMask levels() const { return driven; }
+    RelayMask all() const { return allMask; }
+    const RelayBankStats &stats() const { return bankStats; }
+
+private:
+    bool allowed(RelayMask m) const;
+
+    const uint8_t *pins;
+    uint8_t count;
+    RelayPortFn port;
+    RelayMask allMask;
+    RelayMask driven = 0;
+    RelayMask groups[RELAY_MAX_INTERLOCKS] = {};
+    uint8_t groupCount = 0;
+    RelayBankStats bankStats;
+};
+
+#if defined(RELAY_BENCH)
+// Mask/interlock checks against a mock port plus commit cost; prints to 'out'
+void relayBankBenchmark(Print &out, uint32_t iterations = 10000);
+#endif
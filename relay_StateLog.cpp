@@ -0,0 +1,391 @@
+#include "relay_StateLog.h"
+#if defined(ESP_PLATFORM)
+#include <esp_partition.h>
+#endif
+
+#ifndef RELAY_STATE_PARTITION
+#define RELAY_STATE_PARTITION "relaystate"
+#endif
+
+static constexpr uint32_t SECTOR_MAGIC = 0x52534C31; // "RSL1"
+static constexpr uint32_t COMMITTED = 0x5AFE0000;    // only clears bits of 0xFFFFFFFF
+static constexpr size_t CRC_SPAN = offsetof(RelayStateRecord, crc);
+
+static uint32_t crc32(const void *data, size_t n)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t c = 0xFFFFFFFFUL;
+  while (n--) {
+    c ^= *p++;
+    for (uint8_t k = 0; k < 8; ++k) c = (c >> 1) ^ (0xEDB88320UL & (0 - (c & 1)));
+  }
+  return ~c;
+}
+
+static bool erased(const void *data, size_t n)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < n; ++i) {
+    if (p[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+static bool valid(const RelayStateRecord &r)
+{
+  return r.commit == COMMITTED && r.crc == crc32(&r, CRC_SPAN);
+}
+
+// --- Platform flash ---
+#if defined(ESP_PLATFORM)
+static const esp_partition_t *s_part = nullptr;
+static constexpr uint32_t PART_SECTOR = 4096; // flash erase unit
+
+static bool partRead(uint32_t a, void *d, size_t n) { return esp_partition_read(s_part, a, d, n) == ESP_OK; }
+static bool partWrite(uint32_t a, const void *s, size_t n) { return esp_partition_write(s_part, a, s, n) == ESP_OK; }
+static bool partErase(uint32_t a) { return esp_partition_erase_range(s_part, a, PART_SECTOR) == ESP_OK; }
+
+bool relayStateFlash(RelayStateFlash &out)
+{
+  s_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, RELAY_STATE_PARTITION);
+  if (!s_part) return false;
+  const uint32_t sectors = s_part->size / PART_SECTOR;
+  out = { partRead, partWrite, partErase, PART_SECTOR, (uint8_t)(sectors > 255 ? 255 : sectors) };
+  return sectors >= 2;
+}
+#else
+// Native: a file image with NOR semantics, kept across runs
+static FILE *s_image = nullptr;
+static constexpr uint32_t IMAGE_SECTOR = 4096;
+
+static bool fileRead(uint32_t a, void *d, size_t n)
+{
+  return fseek(s_image, (long)a, SEEK_SET) == 0 && fread(d, 1, n, s_image) == n;
+}
+
+static bool fileWrite(uint32_t a, const void *s, size_t n)
+{
+  uint8_t cur[64];
+  const uint8_t *src = (const uint8_t *)s;
+  for (size_t done = 0; done < n;) {
+    const size_t k = std::min(n - done, sizeof(cur));
+    if (!fileRead(a + done, cur, k)) return false;
+    for (size_t i = 0; i < k; ++i) cur[i] &= src[done + i];
+    if (fseek(s_image, (long)(a + done), SEEK_SET) != 0 || fwrite(cur, 1, k, s_image) != k) return false;
+    done += k;
+  }
+  return fflush(s_image) == 0;
+}
+
+static bool fileErase(uint32_t a)
+{
+  uint8_t ff[256];
+  memset(ff, 0xFF, sizeof(ff));
+  if (fseek(s_image, (long)a, SEEK_SET) != 0) return false;
+  for (uint32_t i = 0; i < IMAGE_SECTOR; i += sizeof(ff)) {
+    if (fwrite(ff, 1, sizeof(ff), s_image) != sizeof(ff)) return false;
+  }
+  return fflush(s_image) == 0;
+}
+
+bool relayStateFlash(RelayStateFlash &out)
+{
+  const char *path = getenv("CADIOT_STATE_FILE");
+  if (!path) path = "relaystate.bin";
+  if (!s_image) s_image = fopen(path, "r+b");
+  if (!s_image) {
+    s_image = fopen(path, "w+b");
+    if (!s_image) return false;
+    for (uint8_t s = 0; s < RELAY_STATE_SECTORS; ++s) fileErase(s * IMAGE_SECTOR);
+  }
+  out = { fileRead, fileWrite, fileErase, IMAGE_SECTOR, RELAY_STATE_SECTORS };
+  return true;
+}
+#endif
+
+// --- Log ---
+
+bool RelayStateLog::readHeader(uint8_t s, uint32_t &gen) const
+{
+  SectorHeader h;
+  if (!f.read(sectorAddr(s), &h, sizeof(h))) return false;
+  if (h.magic != SECTOR_MAGIC || h.genInv != ~h.gen) return false;
+  gen = h.gen;
+  return true;
+}
+
+// Finds the newest committed record in sector 's' and the first free slot
+bool RelayStateLog::scan(uint8_t s, RelayStateRecord &best, bool &found, uint32_t &next)
+{
+  next = slots();
+  for (uint32_t i = 1; i < slots(); ++i) {
+    RelayStateRecord r;
+    if (!f.read(sectorAddr(s) + i * RECORD_SIZE, &r, sizeof(r))) return false;
+    if (erased(&r, sizeof(r))) {
+      next = i; // appends are sequential: the rest is free
+      break;
+    }
+    if (!valid(r)) {
+      logStats.torn++;
+      continue;
+    }
+    if (!found || (int32_t)(r.seq - best.seq) > 0) best = r;
+    found = true;
+  }
+  return true;
+}
+
+bool RelayStateLog::begin(const RelayStateFlash &flash)
+{
+  const uint32_t t0 = micros();
+  f = flash;
+  ok = false;
+  haveLast = false;
+  lastInActive = false;
+  active = -1;
+  spare = -1;
+  if (!f.read || !f.write || !f.erase || f.sectors < 2 || f.sectorSize % RECORD_SIZE ||
+      f.sectorSize / RECORD_SIZE < 2)
+    return false;
+
+  // Newest and second-newest sector by generation
+  int16_t prev = -1;
+  uint32_t prevGen = 0;
+  for (uint8_t s = 0; s < f.sectors; ++s) {
+    uint32_t gen;
+    if (!readHeader(s, gen)) continue;
+    if (active < 0 || (int32_t)(gen - activeGen) > 0) {
+      prev = active;
+      prevGen = activeGen;
+      active = s;
+      activeGen = gen;
+    } else if (prev < 0 || (int32_t)(gen - prevGen) > 0) {
+      prev = s;
+      prevGen = gen;
+    }
+  }
+
+  if (active >= 0) {
+    if (!scan((uint8_t)active, last, haveLast, nextSlot)) return false;
+    lastInActive = haveLast;
+    // Power lost right after starting a sector: the state is in the previous one
+    uint32_t unused;
+    if (!haveLast && prev >= 0 && !scan((uint8_t)prev, last, haveLast, unused)) return false;
+  }
+  ok = true;
+  logStats.mountUs = micros() - t0;
+  return true;
+}
+
+bool RelayStateLog::latest(RelayStateRecord &out) const
+{
+  if (!ok || !haveLast) return false;
+  out = last;
+  return true;
+}
+
+bool RelayStateLog::startSector(uint8_t s, uint32_t gen)
+{
+  if (s == spare) {
+    spare = -1; // erased by prepare(): only the header is left to write
+  } else {
+    logStats.erases++;
+    if (!f.erase(sectorAddr(s))) return false;
+  }
+  SectorHeader h;
+  memset(&h, 0xFF, sizeof(h));
+  h.magic = SECTOR_MAGIC;
+  h.gen = gen;
+  h.genInv = ~gen;
+  return f.write(sectorAddr(s), &h, sizeof(h));
+}
+
+bool RelayStateLog::save(RelayMask levels, RelayMask pulsing, const char *src, uint32_t epoch)
+{
+  if (!ok) return false;
+  if (haveLast && last.levels == levels && last.pulsing == pulsing) return true; // unchanged
+  const uint32_t t0 = micros();
+
+  RelayStateRecord r;
+  memset(&r, 0, sizeof(r));
+  r.seq = haveLast ? last.seq + 1 : 1;
+  r.levels = levels;
+  r.pulsing = pulsing;
+  r.epoch = epoch;
+  if (src) strncpy(r.src, src, sizeof(r.src));
+  r.crc = crc32(&r, CRC_SPAN);
+  r.commit = 0xFFFFFFFFUL; // written last
+
+  if (active < 0 || nextSlot >= slots()) {
+    const uint8_t s = active < 0 ? 0 : (uint8_t)((active + 1) % f.sectors);
+    if (!startSector(s, activeGen + 1)) return false;
+    active = s;
+    activeGen++;
+    nextSlot = 1;
+    lastInActive = false;
+  }
+
+  const uint32_t addr = sectorAddr((uint8_t)active) + nextSlot++ * RECORD_SIZE; // slot is used even on failure
+  const uint32_t commit = COMMITTED;
+  if (!f.write(addr, &r, sizeof(r)) ||
+      !f.write(addr + offsetof(RelayStateRecord, commit), &commit, sizeof(commit)))
+    return false;
+
+  r.commit = COMMITTED;
+  last = r;
+  haveLast = true;
+  lastInActive = true;
+  logStats.appends++;
+  logStats.writeUs = micros() - t0;
+  return true;
+}
+
+bool RelayStateLog::blank(uint8_t s) const
+{
+  uint8_t buf[64];
+  for (uint32_t a = 0; a < f.sectorSize; a += sizeof(buf)) {
+    const size_t n = std::min<size_t>(sizeof(buf), f.sectorSize - a);
+    if (!f.read(sectorAddr(s) + a, buf, n) || !erased(buf, n)) return false;
+  }
+  return true;
+}
+
+bool RelayStateLog::prepare()
+{
+  if (!ok || spare >= 0) return ok;
+  // Until the active sector holds the newest record, the one the wrap would
+  // erase may be the only copy (power lost right after starting a sector)
+  if (active >= 0 && !lastInActive) return true;
+  const uint8_t s = active < 0 ? 0 : (uint8_t)((active + 1) % f.sectors);
+  if (!blank(s)) {
+    const uint32_t t0 = micros();
+    logStats.erases++;
+    logStats.preErases++;
+    if (!f.erase(sectorAddr(s))) return false;
+    logStats.prepareUs = micros() - t0;
+  }
+  spare = s;
+  return true;
+}
+
+#if defined(PERSIST_BENCH)
+// --- Power-loss simulation (RAM flash, byte-granular cuts) ---
+static constexpr uint32_t SIM_SECTOR = 256;   // 7 records per sector: wraps often
+static constexpr uint8_t SIM_SECTORS = 3;
+static constexpr int32_t SIM_ERASE_COST = 64; // budget units per erase
+static uint8_t simMem[SIM_SECTOR * SIM_SECTORS];
+static uint32_t simErases[SIM_SECTORS];
+static int32_t simBudget;                     // operations left before power is cut; <0: unlimited
+static bool simCut;
+
+static bool simRead(uint32_t a, void *d, size_t n)
+{
+  memcpy(d, simMem + a, n);
+  return true;
+}
+
+static bool simWrite(uint32_t a, const void *s, size_t n)
+{
+  const uint8_t *src = (const uint8_t *)s;
+  for (size_t i = 0; i < n; ++i) {
+    if (simCut) return false;
+    if (simBudget == 0) { // cut mid-byte: only some bits got programmed
+      simMem[a + i] &= src[i] | (uint8_t)random(256);
+      simCut = true;
+      return false;
+    }
+    simMem[a + i] &= src[i];
+    if (simBudget > 0) simBudget--;
+  }
+  return true;
+}
+
+static bool simErase(uint32_t a)
+{
+  if (simCut) return false;
+  if (simBudget >= 0 && simBudget < SIM_ERASE_COST) { // cut mid-erase: some cells reset
+    for (uint32_t i = 0; i < SIM_SECTOR; ++i) {
+      if (random(2)) simMem[a + i] = 0xFF;
+    }
+    simCut = true;
+    return false;
+  }
+  if (simBudget > 0) simBudget -= SIM_ERASE_COST;
+  memset(simMem + a, 0xFF, SIM_SECTOR);
+  simErases[a / SIM_SECTOR]++;
+  return true;
+}
+
+void relayStateLogBenchmark(Print &out, uint32_t trials)
+{
+  const RelayStateFlash sim = { simRead, simWrite, simErase, SIM_SECTOR, SIM_SECTORS };
+  memset(simMem, 0xFF, sizeof(simMem));
+  memset(simErases, 0, sizeof(simErases));
+
+  struct State { bool any; RelayMask levels, pulsing; };
+  State acked = {}, inflight = {};
+  uint32_t cuts = 0, violations = 0, appends = 0, torn = 0, restored = 0, mountUs = 0, appendUs = 0, preErases = 0;
+  RelayMask levels = 0, pulsing = 0;
+
+  for (uint32_t t = 0; t < trials; ++t) {
+    // Reboot: the restored state must be the last acknowledged or the in-flight one
+    simCut = false;
+    simBudget = -1;
+    RelayStateLog log;
+    RelayStateRecord r;
+    const bool mounted = log.begin(sim);
+    const bool found = log.latest(r);
+    const bool isAcked = found && acked.any && r.levels == acked.levels && r.pulsing == acked.pulsing;
+    const bool isInflight = found && inflight.any && r.levels == inflight.levels && r.pulsing == inflight.pulsing;
+    if (!mounted || !(isAcked || isInflight || (!found && !acked.any))) {
+      violations++;
+      out.printf("[PERSIST BENCH] FAIL trial=%lu found=%d levels=0x%lx acked=0x%lx inflight=0x%lx\n",
+                 (unsigned long)t, found, found ? (unsigned long)r.levels : 0UL,
+                 (unsigned long)acked.levels, (unsigned long)inflight.levels);
+    }
+    torn += log.stats().torn;
+    mountUs += log.stats().mountUs;
+    if (found) {
+      restored++;
+      levels = r.levels;
+      pulsing = r.pulsing;
+      acked = { true, levels, pulsing };
+    }
+    inflight.any = false;
+
+    // Run until the power is cut somewhere inside a write or an erase
+    simBudget = random(1, (long)sizeof(simMem) * 2);
+    for (uint8_t k = 0; k < 40 && !simCut; ++k) {
+      RelayMask next = (RelayMask)random(1L << (RELAY_CHANNELS < 8 ? RELAY_CHANNELS : 8));
+      RelayMask nextPulsing = next & (RelayMask)random(4);
+      if (next == levels && nextPulsing == pulsing) next ^= 1;
+      nextPulsing &= next;
+      if (random(4) == 0) log.prepare(); // the persist task erases ahead between appends
+      if (log.save(next, nextPulsing, "bench", t)) {
+        appends++;
+        appendUs += log.stats().writeUs;
+        acked = { true, next, nextPulsing };
+      } else {
+        inflight = { true, next, nextPulsing };
+      }
+      levels = next;
+      pulsing = nextPulsing;
+    }
+    if (simCut) cuts++;
+    preErases += log.stats().preErases;
+  }
+
+  uint32_t minErase = simErases[0], maxErase = simErases[0];
+  for (uint8_t s = 1; s < SIM_SECTORS; ++s) {
+    if (simErases[s] < minErase) minErase = simErases[s];
+    if (simErases[s] > maxErase) maxErase = simErases[s];
+  }
+  out.printf("[PERSIST BENCH] trials=%lu cuts=%lu restored=%lu violations=%lu torn=%lu\n",
+             (unsigned long)trials, (unsigned long)cuts, (unsigned long)restored,
+             (unsigned long)violations, (unsigned long)torn);
+  out.printf("[PERSIST BENCH] appends=%lu avgAppend=%luus avgMount=%luus erases/sector=%lu..%lu preErased=%lu\n",
+             (unsigned long)appends, (unsigned long)(appends ? appendUs / appends : 0),
+             (unsigned long)(trials ? mountUs / trials : 0), (unsigned long)minErase, (unsigned long)maxErase,
+             (unsigned long)preErases);
+}
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+#include <Arduino.h>
+#include "relay_PulseEngine.h"
+
+// Power-safe, wear-leveled relay state log in raw flash.
+// Records are appended to a ring of erase sectors; a sector is erased only
+// when the ring wraps onto it, so every sector wears evenly. prepare() does
+// that erase ahead of time, so the append at the wrap only writes. Each record is
+// written body-first and then committed by a separate word, and carries a
+// CRC: a write torn by power loss is skipped at mount and the previous
+// record wins. Mounting reads two sectors at most.
+//
+// Sector: [header slot][record][record]...   (all slots RECORD_SIZE bytes)
+
+#ifndef RELAY_STATE_SECTORS
+#define RELAY_STATE_SECTORS 4
+#endif
+
+struct RelayStateRecord
+{
+    uint32_t seq;        // increases with every append
+    RelayMask levels;    // driven levels
+    RelayMask pulsing;   // channels that were ON only for a timed pulse
+    uint32_t epoch;      // wall clock of the change (0 before NTP)
+    char src[8];         // command source, truncated ("direct_m", "c2d", ...)
+    uint32_t crc;        // CRC-32 of the fields above
+    uint32_t commit;     // COMMITTED once the rest is on flash
+};
+static_assert(sizeof(RelayStateRecord) == 32, "record must fill one slot");
+
+// NOR flash access: writes can only clear bits, erase sets a sector to 0xFF
+struct RelayStateFlash
+{
+    bool (*read)(uint32_t addr, void *dst, size_t n);
+    bool (*write)(uint32_t addr, const void *src, size_t n);
+    bool (*erase)(uint32_t sectorAddr);
+    uint32_t sectorSize;  // multiple of RECORD_SIZE
+    uint8_t sectors;      // >= 2 (erasing the only sector would lose the state)
+};
+
+// Platform store: the "relaystate" data partition (ESP32) or a file image
+// (native, $CADIOT_STATE_FILE). Returns false when there is no backing store.
+bool relayStateFlash(RelayStateFlash &out);
+
+struct RelayStateLogStats
+{
+    uint32_t appends = 0;
+    uint32_t erases = 0;
+    uint32_t preErases = 0; // of those, done by prepare()
+    uint32_t torn = 0;     // unreadable records skipped at mount
+    uint32_t mountUs = 0;
+    uint32_t writeUs = 0;  // last append, including any erase
+    uint32_t prepareUs = 0; // last prepare() that erased
+};
+
+class RelayStateLog
+{
+public:
+    static constexpr uint32_t RECORD_SIZE = sizeof(RelayStateRecord);
+
+    // Scans the sector headers and the newest sectors; no writes
+    bool begin(const RelayStateFlash &flash);
+    bool mounted() const { return ok; }
+
+    // Newest committed record; false on a blank or unreadable store
+    bool latest(RelayStateRecord &out) const;
+
+    // Appends when levels/pulsing differ from the newest record
+    bool save(RelayMask levels, RelayMask pulsing, const char *src, uint32_t epoch);
+
+    // Erases the sector the next wrap starts (a 4 KB erase: tens of ms) unless
+    // it is blank already; call from a task that may block, not the command path
+    bool prepare();
+
+    const RelayStateLogStats &stats() const { return logStats; }
+
+private:
+    struct SectorHeader
+    {
+        uint32_t magic;
+        uint32_t gen;      // increases every time a sector is (re)started
+        uint32_t genInv;   // ~gen
+        uint8_t pad[RECORD_SIZE - 12];
+    };
+
+    uint32_t sectorAddr(uint8_t s) const { return (uint32_t)s * f.sectorSize; }
+    uint32_t slots() const { return f.sectorSize / RECORD_SIZE; }
+    bool readHeader(uint8_t s, uint32_t &gen) const;
+    bool scan(uint8_t s, RelayStateRecord &best, bool &found, uint32_t &next);
+    bool startSector(uint8_t s, uint32_t gen);
+    bool blank(uint8_t s) const;
+
+    RelayStateFlash f = {};
+    bool ok = false;
+    bool haveLast = false;
+    RelayStateRecord last = {};
+    int16_t active = -1;     // sector receiving appends
+    uint32_t activeGen = 0;
+    uint32_t nextSlot = 0;   // in the active sector
+    bool lastInActive = false; // the newest record is in 'active' (the others may go)
+    int16_t spare = -1;      // sector known to be blank: the next wrap skips its erase
+    RelayStateLogStats logStats;
+};
+
+#if defined(PERSIST_BENCH)
+// Power-loss simulation on a RAM flash: random cuts mid-write/erase, then
+// remount and check that the restored record is the last one acknowledged
+// or the one being written. Prints results to 'out'.
+void relayStateLogBenchmark(Print &out, uint32_t trials = 2000);
+#endif
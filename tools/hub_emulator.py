@@ -0,0 +1,408 @@
+#!/usr/bin/env python3
+"""Local stand-in for Azure IoT Hub's device MQTT endpoint, with a load generator.
+
+Speaks the subset the firmware uses (MQTT 3.1.1 over TLS):
+  - CONNECT with SAS username/password (signature, resource and expiry checked)
+  - $iothub/methods/POST/{name}/?$rid={rid}   hub -> device requests
+  - $iothub/methods/res/{status}/?$rid={rid}  device -> hub responses
+  - devices/{id}/messages/devicebound/...     hub -> device C2D
+  - $iothub/twin/PATCH/properties/reported/?$rid={rid}  answered on $iothub/twin/res/...
+  - devices/{id}/messages/events/...          device -> hub telemetry (counted)
+and reports direct-method round-trip latency (p50/p99/p999), loss and C2D rate.
+
+Faults: --drop (lose requests/responses), --slow-ack (delay CONNACK/SUBACK/PUBACK),
+--disconnect-every (drop the connection so the device's reconnect path runs),
+--twin-throttle (answer reported-property patches with 429).
+
+  python3 tools/hub_emulator.py --cert srv.pem --key srv.key --device-key <base64> \\
+      --rate 500 --duration 60 --method relayOff --c2d-rate 20 --drop 1 --disconnect-every 20
+"""
+import argparse
+import asyncio
+import base64
+import hashlib
+import hmac
+import json
+import random
+import ssl
+import time
+import urllib.parse
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 1, 2, 3, 4
+SUBSCRIBE, SUBACK, PINGREQ, PINGRESP, DISCONNECT = 8, 9, 12, 13, 14
+
+
+# --- MQTT framing ---
+def enc_len(n):
+    out = bytearray()
+    while True:
+        b, n = n % 128, n // 128
+        out.append(b | (0x80 if n else 0))
+        if not n:
+            return bytes(out)
+
+
+def enc_str(s):
+    b = s.encode() if isinstance(s, str) else s
+    return len(b).to_bytes(2, "big") + b
+
+
+def packet(ptype, flags, body):
+    return bytes([(ptype << 4) | flags]) + enc_len(len(body)) + body
+
+
+async def read_packet(reader):
+    h = await reader.readexactly(1)
+    n, mult = 0, 1
+    while True:
+        b = (await reader.readexactly(1))[0]
+        n += (b & 0x7F) * mult
+        if not b & 0x80:
+            break
+        mult *= 128
+    return h[0] >> 4, h[0] & 0x0F, await reader.readexactly(n)
+
+
+def dec_str(buf, p):
+    n = int.from_bytes(buf[p:p + 2], "big")
+    return buf[p + 2:p + 2 + n].decode(errors="replace"), p + 2 + n
+
+
+# --- SAS validation (same string-to-sign as az_iot_hub_client_sas_get_signature) ---
+def check_sas(password, host, device_id, key_b64):
+    if not key_b64:
+        return None
+    if not password.startswith("SharedAccessSignature "):
+        return "not a SAS token"
+    fields = dict(urllib.parse.parse_qsl(password[len("SharedAccessSignature "):]))
+    sr, sig, se = fields.get("sr", ""), fields.get("sig", ""), fields.get("se", "0")
+    if sr != "%s/devices/%s" % (host, device_id):
+        return "resource %r does not match device" % sr
+    if int(se) < time.time():
+        return "token expired"
+    to_sign = (urllib.parse.quote(sr, safe="") + "\n" + se).encode()
+    want = base64.b64encode(hmac.new(base64.b64decode(key_b64), to_sign, hashlib.sha256).digest()).decode()
+    return None if hmac.compare_digest(want, sig) else "bad signature"
+
+
+def pct(sorted_vals, p):
+    if not sorted_vals:
+        return float("nan")
+    return sorted_vals[min(len(sorted_vals) - 1, int(p / 100.0 * len(sorted_vals)))]
+
+
+class Stats:
+    def __init__(self):
+        self.sent = self.answered = self.lost = self.dropped_req = self.dropped_res = 0
+        self.late = self.c2d = self.connects = self.rejected = self.forced = 0
+        self.twin_updates = self.twin_throttled = self.telemetry = 0
+        self.twin_reported = None
+        self.status = {}
+        self.lat_ms = []
+
+    def report(self, elapsed):
+        lat = sorted(self.lat_ms)
+        done = self.answered + self.lost
+        return {
+            "elapsed_s": round(elapsed, 1),
+            "methods_sent": self.sent,
+            "answered": self.answered,
+            "lost": self.lost,
+            "loss_pct": round(100.0 * self.lost / done, 3) if done else 0.0,
+            "late_responses": self.late,
+            "p50_ms": round(pct(lat, 50), 2),
+            "p99_ms": round(pct(lat, 99), 2),
+            "p999_ms": round(pct(lat, 99.9), 2),
+            "max_ms": round(lat[-1], 2) if lat else float("nan"),
+            "methods_per_s": round(self.answered / elapsed, 1) if elapsed else 0.0,
+            "c2d_sent": self.c2d,
+            "c2d_per_s": round(self.c2d / elapsed, 1) if elapsed else 0.0,
+            "status": self.status,
+            "connects": self.connects,
+            "rejected_connects": self.rejected,
+            "forced_disconnects": self.forced,
+            "dropped_requests": self.dropped_req,
+            "dropped_responses": self.dropped_res,
+            "twin_updates": self.twin_updates,
+            "twin_throttled": self.twin_throttled,
+            "twin_reported": self.twin_reported,
+            "telemetry": self.telemetry,
+        }
+
+
+class Device:
+    def __init__(self, writer, device_id):
+        self.writer = writer
+        self.device_id = device_id
+        self.methods = False     # subscribed to $iothub/methods/POST/#
+        self.c2d = False
+        self.keepalive = 0
+        self.lock = asyncio.Lock()
+
+    async def send(self, data):
+        async with self.lock:
+            self.writer.write(data)
+            await self.writer.drain()
+
+
+class Hub:
+    def __init__(self, a):
+        self.a = a
+        self.stats = Stats()
+        self.device = None
+        self.pending = {}        # rid -> send time (perf_counter)
+        self.ready = asyncio.Event()
+
+    def dropped(self):
+        return self.a.drop > 0 and random.random() * 100.0 < self.a.drop
+
+    async def slow_ack(self):
+        if self.a.slow_ack:
+            await asyncio.sleep(self.a.slow_ack / 1000.0)
+
+    async def handle(self, reader, writer):
+        dev = None
+        try:
+            ptype, _, body = await asyncio.wait_for(read_packet(reader), 10)
+            if ptype != CONNECT:
+                return
+            dev = await self.on_connect(body, writer)
+            if not dev:
+                return
+            while True:
+                keepalive = dev.keepalive * 1.5 if dev.keepalive else None
+                ptype, flags, body = await asyncio.wait_for(read_packet(reader), keepalive)
+                if ptype == PUBLISH:
+                    await self.on_publish(dev, flags, body)
+                elif ptype == SUBSCRIBE:
+                    await self.on_subscribe(dev, body)
+                elif ptype == PINGREQ:
+                    await dev.send(packet(PINGRESP, 0, b""))
+                elif ptype == DISCONNECT:
+                    return
+        except (asyncio.IncompleteReadError, asyncio.TimeoutError, ConnectionError, ssl.SSLError):
+            pass
+        finally:
+            if dev is not None and self.device is dev:
+                self.device = None
+                self.ready.clear()
+            writer.close()
+
+    async def on_connect(self, body, writer):
+        _, p = dec_str(body, 0)
+        flags = body[p + 1]
+        keepalive = int.from_bytes(body[p + 2:p + 4], "big")
+        p += 4
+        client_id, p = dec_str(body, p)
+        if flags & 0x04:                      # will topic + message (unused by the firmware)
+            _, p = dec_str(body, p)
+            _, p = dec_str(body, p)
+        user, p = dec_str(body, p) if flags & 0x80 else ("", p)
+        password, p = dec_str(body, p) if flags & 0x40 else ("", p)
+
+        err = None
+        if not user.startswith("%s/%s/" % (self.a.host, client_id)):
+            err = "username %r does not match %s/%s/" % (user, self.a.host, client_id)
+        if not err:
+            err = check_sas(password, self.a.host, client_id, self.a.device_key)
+        await self.slow_ack()
+        if err:
+            self.stats.rejected += 1
+            print("[hub] reject %s: %s" % (client_id, err), flush=True)
+            writer.write(packet(CONNACK, 0, b"\x00\x05"))   # not authorized
+            await writer.drain()
+            return None
+
+        writer.write(packet(CONNACK, 0, b"\x00\x00"))
+        await writer.drain()
+        if self.device:
+            self.device.writer.close()        # newest session wins, like IoT Hub
+        self.device = Device(writer, client_id)
+        self.device.keepalive = keepalive
+        self.stats.connects += 1
+        print("[hub] %s connected (keepalive %ds)" % (client_id, keepalive), flush=True)
+        return self.device
+
+    async def on_subscribe(self, dev, body):
+        pid = body[:2]
+        p, granted = 2, bytearray()
+        while p < len(body):
+            topic, p = dec_str(body, p)
+            qos = body[p] & 0x03
+            p += 1
+            if topic.startswith("$iothub/methods/POST/"):
+                dev.methods = True
+            elif topic.startswith("devices/%s/messages/devicebound/" % dev.device_id):
+                dev.c2d = True
+            granted.append(min(qos, 1))
+        await self.slow_ack()
+        await dev.send(packet(SUBACK, 0, pid + bytes(granted)))
+        if dev.methods:
+            self.ready.set()
+
+    async def on_publish(self, dev, flags, body):
+        topic, p = dec_str(body, 0)
+        qos = (flags >> 1) & 0x03
+        if qos:
+            pid = body[p:p + 2]
+            await self.slow_ack()
+            await dev.send(packet(PUBACK, 0, pid))
+        if topic.startswith("$iothub/twin/PATCH/properties/reported/"):
+            await self.on_twin_patch(dev, topic, body[p + (2 if qos else 0):])
+            return
+        if topic.startswith("devices/%s/messages/events/" % dev.device_id):
+            self.stats.telemetry += 1
+            return
+        if not topic.startswith("$iothub/methods/res/"):
+            return
+        now = time.perf_counter()
+        if self.dropped():
+            self.stats.dropped_res += 1
+            return
+        status = topic[len("$iothub/methods/res/"):].split("/", 1)[0]
+        rid = topic.rsplit("$rid=", 1)[-1]
+        t0 = self.pending.pop(rid, None)
+        if t0 is None:
+            self.stats.late += 1              # already counted lost (timeout)
+            return
+        self.stats.answered += 1
+        self.stats.status[status] = self.stats.status.get(status, 0) + 1
+        self.stats.lat_ms.append((now - t0) * 1000.0)
+
+    async def on_twin_patch(self, dev, topic, payload):
+        rid = topic.rsplit("$rid=", 1)[-1]
+        if random.random() * 100.0 < self.a.twin_throttle:
+            self.stats.twin_throttled += 1
+            await self.publish("$iothub/twin/res/429/?$rid=%s" % rid, b"")
+            return
+        self.stats.twin_updates += 1
+        try:
+            self.stats.twin_reported = json.loads(payload.decode())
+        except ValueError:
+            self.stats.twin_reported = {"invalid": payload.decode(errors="replace")}
+        await self.publish("$iothub/twin/res/204/?$rid=%s&$version=%d" % (rid, self.stats.twin_updates + 1), b"")
+
+    async def publish(self, topic, payload):
+        dev = self.device
+        if not dev:
+            return False
+        try:
+            await dev.send(packet(PUBLISH, 0, enc_str(topic) + payload))
+            return True
+        except ConnectionError:
+            return False
+
+    # --- load generation ---
+    async def methods(self):
+        a, rid = self.a, 0
+        payload = a.payload.encode()
+        interval = 1.0 / a.rate
+        next_at = time.perf_counter()
+        while a.count == 0 or self.stats.sent < a.count:
+            await self.ready.wait()
+            now = time.perf_counter()
+            if next_at > now:
+                await asyncio.sleep(next_at - now)
+            next_at = max(next_at + interval, time.perf_counter() - 1.0)  # no unbounded catch-up
+            rid += 1
+            key = "%x" % rid
+            self.stats.sent += 1
+            self.pending[key] = time.perf_counter()
+            if self.dropped():
+                self.stats.dropped_req += 1
+                continue
+            await self.publish("$iothub/methods/POST/%s/?$rid=%s" % (a.method, key), payload)
+
+    async def c2d(self):
+        a = self.a
+        payload = a.c2d_payload.encode()
+        while True:
+            await self.ready.wait()
+            await asyncio.sleep(1.0 / a.c2d_rate)
+            dev = self.device
+            if dev and dev.c2d and await self.publish(
+                    "devices/%s/messages/devicebound/%%24.mid=%d" % (dev.device_id, self.stats.c2d), payload):
+                self.stats.c2d += 1
+
+    async def expire(self):
+        while True:
+            await asyncio.sleep(0.1)
+            cutoff = time.perf_counter() - self.a.timeout
+            for rid in [r for r, t in self.pending.items() if t < cutoff]:
+                del self.pending[rid]
+                self.stats.lost += 1
+
+    async def disconnects(self):
+        while True:
+            await asyncio.sleep(self.a.disconnect_every)
+            if self.device:
+                self.stats.forced += 1
+                print("[hub] fault: forcing disconnect", flush=True)
+                self.device.writer.close()
+
+
+async def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--listen", default="0.0.0.0")
+    ap.add_argument("--port", type=int, default=8883)
+    ap.add_argument("--cert", help="server certificate (PEM); omit for plain TCP")
+    ap.add_argument("--key", help="server private key (PEM)")
+    ap.add_argument("--host", default="localhost", help="hub host name the device uses (SAS resource)")
+    ap.add_argument("--device-key", help="base64 device key; omit to accept any password")
+    ap.add_argument("--rate", type=float, default=100.0, help="direct methods per second")
+    ap.add_argument("--count", type=int, default=0, help="stop after N methods (0 = until --duration)")
+    ap.add_argument("--method", default="relayOff")
+    ap.add_argument("--payload", default="{}")
+    ap.add_argument("--timeout", type=float, default=5.0, help="seconds before a method counts as lost")
+    ap.add_argument("--c2d-rate", type=float, default=0.0, help="C2D messages per second")
+    ap.add_argument("--c2d-payload", default="{'cmd':'relayOff'}")
+    ap.add_argument("--drop", type=float, default=0.0, help="percent of requests and responses to lose")
+    ap.add_argument("--slow-ack", type=float, default=0.0, help="ms to delay CONNACK/SUBACK/PUBACK")
+    ap.add_argument("--disconnect-every", type=float, default=0.0, help="seconds between forced disconnects")
+    ap.add_argument("--twin-throttle", type=float, default=0.0, help="percent of twin patches answered 429")
+    ap.add_argument("--duration", type=float, default=60.0, help="seconds from first subscribe (0 = forever)")
+    ap.add_argument("--report-every", type=float, default=5.0)
+    ap.add_argument("--json", action="store_true", help="print the final report as JSON")
+    a = ap.parse_args()
+
+    tls = None
+    if a.cert:
+        tls = ssl.create_default_context(ssl.Purpose.CLIENT_AUTH)
+        tls.load_cert_chain(a.cert, a.key)
+    hub = Hub(a)
+    server = await asyncio.start_server(hub.handle, a.listen, a.port, ssl=tls)
+    print("[hub] listening on %s:%d (%s)" % (a.listen, a.port, "TLS" if tls else "plain"), flush=True)
+
+    tasks = [asyncio.ensure_future(hub.expire())]
+    if a.rate > 0:
+        tasks.append(asyncio.ensure_future(hub.methods()))
+    if a.c2d_rate > 0:
+        tasks.append(asyncio.ensure_future(hub.c2d()))
+    if a.disconnect_every > 0:
+        tasks.append(asyncio.ensure_future(hub.disconnects()))
+
+    await hub.ready.wait()
+    t0 = time.perf_counter()
+    try:
+        while a.duration == 0 or time.perf_counter() - t0 < a.duration:
+            await asyncio.sleep(a.report_every)
+            r = hub.stats.report(time.perf_counter() - t0)
+            print("[hub] %(elapsed_s)ss sent=%(methods_sent)d ok=%(answered)d lost=%(lost)d "
+                  "p50=%(p50_ms)sms p99=%(p99_ms)sms p999=%(p999_ms)sms c2d=%(c2d_sent)d" % r, flush=True)
+            if a.count and hub.stats.sent >= a.count and not hub.pending:
+                break
+    finally:
+        for t in tasks:
+            t.cancel()
+        server.close()
+
+    r = hub.stats.report(time.perf_counter() - t0)
+    print(json.dumps(r, indent=2) if a.json else
+          "\n".join("%-20s %s" % (k, v) for k, v in r.items()), flush=True)
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Expand binary log records (firmware built with -D LOG_BINARY).
+
+Record layout (little endian), see log_DeferredLog.h:
+  u8 sync(0xA5) u8 level u16 len u32 ms u32 fmtAddr | args...
+Format strings are resolved from the firmware ELF by address.
+
+  python3 tools/log_decode.py .pio/build/tftespi/firmware.elf capture.bin
+  python3 tools/log_decode.py firmware.elf /dev/ttyUSB0 --baud 115200
+"""
+import argparse
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+SYNC = 0xA5
+HDR = 12
+LEVELS = "-EWID"
+CONV = re.compile(r"%(%|[-+ #0]*(?:\*|\d+)?(?:\.(?:\*|\d+))?)(?:hh|h|ll|l|L|q|j|z|t)?([diouxXeEfgGaAcsp%]?)")
+
+
+class Strings:
+    def __init__(self, path):
+        self.sections = []
+        with open(path, "rb") as f:
+            elf = ELFFile(f)
+            for s in elf.iter_sections():
+                if s["sh_addr"] and s["sh_type"] == "SHT_PROGBITS":
+                    self.sections.append((s["sh_addr"], s.data()))
+
+    def at(self, addr):
+        for base, data in self.sections:
+            if base <= addr < base + len(data):
+                off = addr - base
+                end = data.find(b"\0", off)
+                return data[off:end if end >= 0 else len(data)].decode("utf-8", "replace")
+        return "<fmt@0x%08x>" % addr
+
+
+def decode_args(body):
+    args, p = [], 0
+    while p < len(body):
+        tag = body[p]
+        p += 1
+        if tag == 1:
+            args.append(struct.unpack_from("<i", body, p)[0]); p += 4
+        elif tag == 2:
+            args.append(struct.unpack_from("<I", body, p)[0]); p += 4
+        elif tag == 3:
+            args.append(struct.unpack_from("<q", body, p)[0]); p += 8
+        elif tag == 4:
+            args.append(struct.unpack_from("<Q", body, p)[0]); p += 8
+        elif tag == 5:
+            args.append(struct.unpack_from("<d", body, p)[0]); p += 8
+        elif tag == 6:
+            n = body[p]
+            args.append(body[p + 1:p + n].split(b"\0", 1)[0].decode("utf-8", "replace")); p += 1 + n
+        else:
+            break
+    return args
+
+
+def render(fmt, args):
+    it = iter(args)
+
+    def sub(m):
+        flags, conv = m.group(1), m.group(2)
+        if flags == "%":
+            return "%"
+        if not conv:
+            return m.group(0)
+        spec = "%" + flags
+        star = [next(it, 0) for _ in range(spec.count("*"))]
+        for s in star:
+            spec = spec.replace("*", str(s), 1)
+        v = next(it, "<?>")
+        if conv == "p":
+            return "0x%08x" % v
+        if conv == "c" and isinstance(v, int):
+            v = chr(v & 0xFF)
+        if conv in "diouxX" and not isinstance(v, int):
+            conv = "s"
+        try:
+            return (spec + conv) % v
+        except (TypeError, ValueError):
+            return str(v)
+
+    return CONV.sub(sub, fmt)
+
+
+def records(stream):
+    buf = b""
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            break
+        buf += chunk
+        while True:
+            i = buf.find(bytes([SYNC]))
+            if i < 0:
+                buf = b""
+                break
+            buf = buf[i:]
+            if len(buf) < HDR:
+                break
+            level, length = buf[1], struct.unpack_from("<H", buf, 2)[0]
+            if level > 4 or length < HDR:
+                buf = buf[1:]      # false sync (text or noise), resync
+                continue
+            if len(buf) < length:
+                break
+            yield buf[:length]
+            buf = buf[length:]
+
+
+def open_input(path, baud):
+    if path == "-":
+        return sys.stdin.buffer
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial
+        return serial.Serial(path, baud, timeout=1)
+    return open(path, "rb")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("elf")
+    ap.add_argument("input", help="capture file, serial port or - for stdin")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--tag", default="", help="prefix printed like the on-device formatter")
+    a = ap.parse_args()
+
+    strings = Strings(a.elf)
+    for rec in records(open_input(a.input, a.baud)):
+        level = rec[1]
+        ms, addr = struct.unpack_from("<II", rec, 4)
+        text = render(strings.at(addr), decode_args(rec[HDR:]))
+        print("[%d][%s][%s] %s" % (ms, a.tag, LEVELS[level], text), flush=True)
+
+
+if __name__ == "__main__":
+    main()
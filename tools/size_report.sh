@@ -0,0 +1,54 @@
+#!/usr/bin/env bash
+# Flash/RAM use per PlatformIO env, optionally compared with another git ref.
+#   tools/size_report.sh                 # this tree
+#   tools/size_report.sh <ref> [env...]  # this tree vs <ref> (e.g. HEAD~1)
+# Extra flags for both builds: PLATFORMIO_BUILD_FLAGS="-D UI_MIRROR_LOG" tools/size_report.sh
+set -euo pipefail
+
+root="$(cd "$(dirname "$0")/.." && pwd)"
+ref="${1:-}"
+[ $# -gt 0 ] && shift
+envs="${*:-$(sed -n 's/^\[env:\(.*\)\]$/\1/p' "$root/platformio.ini" | grep -vx native)}"
+
+# Prints "<env> <flash> <ram>" (bytes) from PlatformIO's size summary
+sizes() {
+  local dir="$1" env
+  for env in $envs; do
+    local out
+    if ! out="$(cd "$dir" && pio run -e "$env" 2>&1)"; then
+      echo "$env FAIL FAIL"
+      continue
+    fi
+    local ram flash
+    ram="$(sed -n 's/^RAM:.*used \([0-9]*\) bytes.*/\1/p' <<<"$out")"
+    flash="$(sed -n 's/^Flash:.*used \([0-9]*\) bytes.*/\1/p' <<<"$out")"
+    echo "$env ${flash:-?} ${ram:-?}"
+  done
+}
+
+cur="$(sizes "$root")"
+if [ -z "$ref" ]; then
+  printf '%-10s %10s %10s\n' env flash ram
+  printf '%-10s %10s %10s\n' $cur
+  exit 0
+fi
+
+wt="$(mktemp -d)"
+trap 'git -C "$root" worktree remove --force "$wt" >/dev/null 2>&1 || true' EXIT
+git -C "$root" worktree add --detach "$wt" "$ref" >/dev/null
+[ -f "$root/secrets.h" ] && cp "$root/secrets.h" "$wt/"
+# Older trees need two fixups to build per env: their filter named a sketch that
+# never existed (main_all_targets.ino), and until fb4fb29 the sketch itself
+# hard-coded #define TARGET_TFT_ESPI on top of the env's -D TARGET_*
+sketch="$(cd "$wt" && ls -- *.ino | head -n 1)"
+sed -i "s/+<[^>]*\.ino>/+<$sketch>/g" "$wt/platformio.ini"
+sed -i '/^#define TARGET_[A-Z0-9_]*[[:space:]]*$/d' "$wt/$sketch"
+base="$(sizes "$wt")"
+
+printf '%-10s %10s %10s %8s %10s %10s %8s\n' env "flash@$ref" flash delta "ram@$ref" ram delta
+join <(sort <<<"$base") <(sort <<<"$cur") | while read -r env bf br cf cr; do
+  df='-'; dr='-'
+  [[ "$bf$cf" =~ ^[0-9]+$ ]] && df=$((cf - bf))
+  [[ "$br$cr" =~ ^[0-9]+$ ]] && dr=$((cr - br))
+  printf '%-10s %10s %10s %8s %10s %10s %8s\n' "$env" "$bf" "$cf" "$df" "$br" "$cr" "$dr"
+done
@@ -0,0 +1,200 @@
+#include <Arduino.h>
+#include "ui_AsyncUi.h"
+
+void AsyncUiCore::start(TaskFunction_t entry)
+{
+  if (task) return;
+  xTaskCreatePinnedToCore(entry, "ui", 4096, this, UI_TASK_PRIORITY, &task, UI_TASK_CORE);
+}
+
+void AsyncUiCore::setLink(UiLink l, LinkState s)
+{
+  if (l < UiLink::Count) post((Field)l, &s, sizeof(s));
+}
+
+void AsyncUiCore::setRelays(const UiRelayState &r)    { post(F_RELAY, &r, sizeof(r)); }
+void AsyncUiCore::showMetrics(const UiLinkMetrics &m) { post(F_METRICS, &m, sizeof(m)); }
+void AsyncUiCore::showTelemetry(const char *p)        { postText(F_TELEMETRY, p); }
+void AsyncUiCore::logInfo(const char *m)              { postText(F_INFO, m); }
+void AsyncUiCore::logError(const char *m)             { postText(F_ERROR, m); }
+
+// 'n' bytes of 'data' (n < MSG_MAX); the rest of the mailbox is zeroed, so text ends NUL-terminated
+void AsyncUiCore::post(Field f, const void *data, size_t n)
+{
+  portENTER_CRITICAL(&postMux);
+  Mailbox &b = boxes[f];
+  uint32_t seq = b.seq.load(std::memory_order_relaxed);
+  b.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(b.value.bytes, data, n);
+  memset(b.value.bytes + n, 0, MSG_MAX - n);
+  b.seq.store(seq + 2, std::memory_order_release);
+  postedCount.fetch_add(1, std::memory_order_relaxed);
+
+  if (b.queued.exchange(true, std::memory_order_acq_rel)) {
+    portEXIT_CRITICAL(&postMux);
+    coalescedCount.fetch_add(1, std::memory_order_relaxed); // already pending: newest text wins
+    return;
+  }
+  uint32_t t = tail.load(std::memory_order_relaxed);
+  ring[t & (RING - 1)] = f;
+  tail.store(t + 1, std::memory_order_release);
+  portEXIT_CRITICAL(&postMux);
+  if (task) xTaskNotifyGive(task);
+}
+
+bool AsyncUiCore::next(uint8_t &f, Payload &out)
+{
+  uint32_t h = head.load(std::memory_order_relaxed);
+  if (h == tail.load(std::memory_order_acquire)) return false;
+  f = ring[h & (RING - 1)];
+  head.store(h + 1, std::memory_order_release);
+
+  Mailbox &b = boxes[f];
+  // Clear first: a post racing with this read re-queues the field
+  b.queued.store(false, std::memory_order_release);
+
+  uint32_t s1, s2;
+  do {
+    s1 = b.seq.load(std::memory_order_acquire);
+    memcpy(out.bytes, b.value.bytes, MSG_MAX);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    s2 = b.seq.load(std::memory_order_relaxed);
+  } while ((s1 & 1) || s1 != s2);
+  out.bytes[MSG_MAX - 1] = '\0';
+
+  renderedCount.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+#if defined(ASYNCUI_BENCH)
+// --- Self-check: two producer threads hammer post() while this thread drains ---
+#include <thread>
+
+// Values carry their own check: a torn copy (bytes from two posts) fails it
+static UiRelayState stressRelay(uint32_t i)
+{
+  return UiRelayState(i, (uint8_t)(i ^ i >> 8 ^ i >> 16 ^ i >> 24));
+}
+static UiLinkMetrics stressMetrics(uint32_t i)
+{
+  UiLinkMetrics m;
+  for (uint8_t k = 0; k < 4; ++k) m.ip[k] = (uint8_t)(i >> (24 - 8 * k));
+  m.tlsMs = (uint16_t)(i ^ i >> 16);
+  m.rssi = (int8_t)~i;
+  return m;
+}
+static uint32_t stressIndex(const UiLinkMetrics &m)
+{
+  return (uint32_t)m.ip[0] << 24 | (uint32_t)m.ip[1] << 16 | (uint32_t)m.ip[2] << 8 | m.ip[3];
+}
+
+// No UI task: the check drains the ring itself through the consumer side
+class AsyncUiStress : public AsyncUiCore
+{
+public:
+  AsyncUiStress() : AsyncUiCore(0) {}
+
+  uint32_t torn = 0, reordered = 0;
+  uint32_t relaySeen = 0, metricsSeen = 0;          // newest index rendered per exclusive field
+  uint32_t infoSeen[2] = { 0, 0 };                  // per producer, on the shared field
+  bool relayAny = false, metricsAny = false, infoAny[2] = { false, false };
+  int lastInfo = -1;                                // producer of the last rendered info text
+
+  // One index per producer ('A' relays, 'B' metrics, both info text)
+  void produce(char who, uint32_t n)
+  {
+    char text[MSG_MAX];
+    for (uint32_t i = 0; i < n; ++i) {
+      if (who == 'A') setRelays(stressRelay(i));
+      else showMetrics(stressMetrics(i));
+      snprintf(text, sizeof(text), "%c%lu:%lu", who, (unsigned long)i, (unsigned long)~i);
+      logInfo(text);
+      if ((i & 15) == 15) std::this_thread::yield(); // interleave even on a single core
+    }
+  }
+
+  uint32_t drain()
+  {
+    uint32_t got = 0;
+    uint8_t f;
+    Payload p;
+    while (next(f, p)) {
+      got++;
+      if (f == F_RELAY) {
+        const UiRelayState r = p.as<UiRelayState>();
+        if (r != stressRelay(r.levels)) torn++;
+        else see(r.levels, relaySeen, relayAny);
+      } else if (f == F_METRICS) {
+        const UiLinkMetrics m = p.as<UiLinkMetrics>();
+        const uint32_t i = stressIndex(m);
+        if (m != stressMetrics(i)) torn++;
+        else see(i, metricsSeen, metricsAny);
+      } else if (f == F_INFO) {
+        char who = 0;
+        unsigned long i = 0, inv = 0;
+        if (sscanf(p.text(), "%c%lu:%lu", &who, &i, &inv) != 3 || (who != 'A' && who != 'B') ||
+            (uint32_t)inv != (uint32_t)~i) {
+          torn++;
+        } else {
+          lastInfo = who - 'A';
+          see((uint32_t)i, infoSeen[lastInfo], infoAny[lastInfo]);
+        }
+      } else {
+        torn++; // never posted
+      }
+    }
+    return got;
+  }
+
+private:
+  // A field renders its newest value: per producer the index never goes back
+  void see(uint32_t i, uint32_t &seen, bool &any)
+  {
+    if (any && i < seen) reordered++;
+    seen = i;
+    any = true;
+  }
+};
+
+void asyncUiBenchmark(Print &out, uint32_t posts)
+{
+  AsyncUiStress q;
+  std::atomic<uint32_t> running{2};
+  const uint32_t t0 = millis();
+  std::thread a([&] { q.produce('A', posts); running--; });
+  std::thread b([&] { q.produce('B', posts); running--; });
+  uint32_t rendered = 0, drains = 0;
+  while (running.load()) {
+    const uint32_t got = q.drain();
+    if (!got) std::this_thread::yield();
+    rendered += got;
+    drains++;
+  }
+  a.join();
+  b.join();
+  rendered += q.drain(); // whatever the producers left queued
+  const uint32_t ms = millis() - t0;
+
+  uint32_t failures = 0;
+  auto check = [&](bool ok, const char *what) {
+    if (!ok) {
+      failures++;
+      out.printf("[ASYNCUI BENCH] FAIL %s\n", what);
+    }
+  };
+  const uint32_t last = posts - 1;
+  check(!q.torn, "no torn value");
+  check(!q.reordered, "no older value after a newer one");
+  check(q.relayAny && q.relaySeen == last, "last relay value wins");
+  check(q.metricsAny && q.metricsSeen == last, "last metrics value wins");
+  check(q.lastInfo >= 0 && q.infoSeen[q.lastInfo] == last, "last info text wins");
+  check(q.posted() == 4 * posts, "every post counted");
+  check(q.posted() == q.rendered() + q.coalesced() && rendered == q.rendered(), "each post rendered or coalesced");
+
+  out.printf("[ASYNCUI BENCH] posts=%lu rendered=%lu coalesced=%lu drains=%lu torn=%lu reordered=%lu %lums failures=%lu\n",
+             (unsigned long)q.posted(), (unsigned long)q.rendered(), (unsigned long)q.coalesced(),
+             (unsigned long)drains, (unsigned long)q.torn, (unsigned long)q.reordered, (unsigned long)ms,
+             (unsigned long)failures);
+}
+#endif
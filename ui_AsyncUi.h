@@ -0,0 +1,154 @@
+#pragma once
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "diag_HeapStats.h"
+#include "diag_TaskStats.h"
+#include "ui_UiStatus.h"
+
+// UI front that never touches the display on the caller's task.
+// Each call writes the newest value (link state, relay levels, metrics or
+// text) into a per-field mailbox and pushes the field id onto a ring; a UI
+// task pinned to the other core drains the ring and renders. A field is
+// queued at most once, so bursts of updates to the same field coalesce into
+// a single render of the last value.
+// Producers (network and control tasks) serialize on a short spinlock; the
+// UI task is the only consumer.
+// AsyncUiCore holds the queue; AsyncUi<Sink> renders into a concrete sink
+// (usually a UiSinks<...>) with direct calls. Values handed to the sink live
+// in a per-frame arena: valid until the next frame starts.
+
+#ifndef UI_TASK_CORE
+#define UI_TASK_CORE (ARDUINO_RUNNING_CORE == 0 ? 1 : 0)
+#endif
+#ifndef UI_TASK_PRIORITY
+#define UI_TASK_PRIORITY 1
+#endif
+
+class AsyncUiCore
+{
+public:
+    static constexpr size_t MSG_MAX = 96;
+
+    void setLink(UiLink l, LinkState s);
+    void setRelays(const UiRelayState &r);
+    void showMetrics(const UiLinkMetrics &m);
+    void showTelemetry(const char *p);
+    void logInfo(const char *m);
+    void logError(const char *m);
+
+    uint32_t posted() const { return postedCount.load(std::memory_order_relaxed); }
+    uint32_t coalesced() const { return coalescedCount.load(std::memory_order_relaxed); }
+    uint32_t rendered() const { return renderedCount.load(std::memory_order_relaxed); }
+
+    void setMeter(TaskMeter *m) { meter = m; }  // before begin()/start()
+    TaskHandle_t taskHandle() const { return task; }
+    const ScratchArena &frameArena() const { return frame; }
+
+protected:
+    enum Field : uint8_t
+    {
+        F_WIFI = 0, F_TIME, F_MQTT,  // setLink: field == (uint8_t)UiLink
+        F_RELAY, F_METRICS,
+        F_TELEMETRY, F_INFO, F_ERROR,
+        F_COUNT
+    };
+    static_assert((uint8_t)UiLink::Count == F_RELAY, "one link field per UiLink");
+
+    // Mailbox contents: text, or one of the typed values (copied as bytes)
+    struct Payload
+    {
+        alignas(4) char bytes[MSG_MAX];
+
+        const char *text() const { return bytes; }
+        template <typename T> T as() const
+        {
+            T v;
+            memcpy((void *)&v, bytes, sizeof(T));
+            return v;
+        }
+    };
+    static_assert(sizeof(UiRelayState) <= MSG_MAX && sizeof(UiLinkMetrics) <= MSG_MAX, "payload too small");
+
+    explicit AsyncUiCore(uint32_t pumpIntervalMs) : pumpMs(pumpIntervalMs) {}
+
+    void start(TaskFunction_t entry);
+    // Waits for work or the pump interval; then drain with next().
+    void wait() { ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(pumpMs)); }
+    // Pops the next queued field and copies its newest value (consumer side).
+    bool next(uint8_t &f, Payload &out);
+
+    TaskMeter *meter = nullptr;
+    StaticArena<(F_COUNT + 1) * sizeof(Payload)> frame;  // a value per field (+ the probe that ends a frame)
+
+private:
+    struct Mailbox
+    {
+        std::atomic<uint32_t> seq{0};      // seqlock: odd while the producer writes
+        std::atomic<bool> queued{false};
+        Payload value;
+    };
+
+    // Fixed-capacity ring of field ids (each field queued at most once)
+    static constexpr size_t RING = 16;     // power of two, > F_COUNT
+    static_assert(RING > F_COUNT, "ring must hold every field once");
+    uint8_t ring[RING];
+    std::atomic<uint32_t> head{0};         // written by consumer
+    std::atomic<uint32_t> tail{0};         // written by producer
+
+    void post(Field f, const void *data, size_t n);
+    void postText(Field f, const char *s) { post(f, s, strnlen(s, MSG_MAX - 1)); }
+
+    portMUX_TYPE postMux = portMUX_INITIALIZER_UNLOCKED;
+    uint32_t pumpMs;
+    TaskHandle_t task = nullptr;
+    Mailbox boxes[F_COUNT];
+    std::atomic<uint32_t> postedCount{0}, coalescedCount{0}, renderedCount{0};
+};
+
+template <typename Sink>
+class AsyncUi : public AsyncUiCore
+{
+public:
+    // The UI task also calls sink.pump() every pumpIntervalMs (flush, touch, spinner)
+    explicit AsyncUi(Sink &s, uint32_t pumpIntervalMs = 10) : AsyncUiCore(pumpIntervalMs), sink(s) {}
+
+    void begin() { sink.begin(); start(); }  // initializes the display, then start()
+    void start() { AsyncUiCore::start(taskEntry); } // display already initialized
+
+private:
+    static void taskEntry(void *arg) { static_cast<AsyncUi *>(static_cast<AsyncUiCore *>(arg))->run(); }
+
+    void run()
+    {
+        HeapScope tag(HeapTag::Ui);
+        for (;;) {
+            wait();
+            if (meter) meter->busy();
+            frame.reset();
+            uint8_t f;
+            Payload *p;
+            // A field reposted mid-frame can exhaust the arena: the rest waits for the next frame
+            while ((p = (Payload *)frame.alloc(sizeof(Payload), alignof(Payload))) && next(f, *p)) {
+                switch (f) {
+                    case F_RELAY:     sink.setRelays(p->as<UiRelayState>()); break;
+                    case F_METRICS:   sink.showMetrics(p->as<UiLinkMetrics>()); break;
+                    case F_TELEMETRY: sink.showTelemetry(p->text()); break;
+                    case F_INFO:      sink.logInfo(p->text()); break;
+                    case F_ERROR:     sink.logError(p->text()); break;
+                    default:          sink.setLink((UiLink)f, p->as<LinkState>()); break;
+                }
+            }
+            sink.pump();
+            if (meter) meter->idle();
+        }
+    }
+
+    Sink &sink;
+};
+
+#if defined(ASYNCUI_BENCH)
+// Two std::thread producers post 'posts' values each while the caller drains:
+// the last value of every field must win, none lost, torn or reordered; prints to 'out'
+void asyncUiBenchmark(Print &out, uint32_t posts = 200000);
+#endif
@@ -2,7 +2,35 @@
 #include "ui_HeadlessUi.h"
 
 void HeadlessUi::begin() { Serial.begin(115200); }
-void HeadlessUi::setStatus(const char *s) { Serial.printf("[STATUS] %s\n", s); }
+
+void HeadlessUi::setLink(UiLink l, LinkState s)
+{
+  const uint8_t i = (uint8_t)l;
+  if (i >= (uint8_t)UiLink::Count || (linkShown[i] && links[i] == s)) return;
+  links[i] = s;
+  linkShown[i] = true;
+  Serial.printf("[STATUS] %s %s\n", uiLinkName(l), uiLinkStateText(l, s));
+}
+
+void HeadlessUi::setRelays(const UiRelayState &r)
+{
+  if (relaysShown && r == relays) return;
+  relays = r;
+  relaysShown = true;
+  char t[48];
+  uiRelayText(t, sizeof(t), r);
+  Serial.printf("[STATUS] Relay %s\n", t);
+}
+
+void HeadlessUi::showMetrics(const UiLinkMetrics &m)
+{
+  if (m == metrics) return;
+  metrics = m;
+  char t[64];
+  uiMetricsText(t, sizeof(t), m);
+  Serial.printf("[METRICS] %s\n", t);
+}
+
 void HeadlessUi::showTelemetry(const char *p) { Serial.printf("[TELEMETRY] %s\n", p); }
 void HeadlessUi::logInfo(const char *m) { Serial.printf("[INFO] %s\n", m); }
 void HeadlessUi::logError(const char *m) { Serial.printf("[ERROR] %s\n", m); }
\ No newline at end of file
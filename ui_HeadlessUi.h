@@ -1,12 +1,24 @@
 #pragma once
-#include "ui_IUiAdapter.h"
+#include <Arduino.h>
+#include "ui_UiStatus.h"
 
-class HeadlessUi : public IUiAdapter
+class HeadlessUi
 {
 public:
-    void begin() override;
-    void setStatus(const char *) override;
-    void showTelemetry(const char *) override;
-    void logInfo(const char *) override;
-    void logError(const char *) override;
+    void begin();
+    void setLink(UiLink, LinkState);
+    void setRelays(const UiRelayState &);
+    void showMetrics(const UiLinkMetrics &);
+    void showTelemetry(const char *);
+    void logInfo(const char *);
+    void logError(const char *);
+    void pump() {}
+
+private:
+    // Last printed values: repeats print nothing
+    LinkState links[(uint8_t)UiLink::Count] = {};
+    bool linkShown[(uint8_t)UiLink::Count] = {};
+    UiRelayState relays;
+    bool relaysShown = false;
+    UiLinkMetrics metrics;
 };
\ No newline at end of file
@@ -1,13 +1,44 @@
 #pragma once
 #include <Arduino.h>
+#include "ui_UiStatus.h"
+
+// UI sinks are plain classes with this shape (no base class, no vtable):
+//   void begin(); void setLink(UiLink, LinkState); void setRelays(const UiRelayState&);
+//   void showMetrics(const UiLinkMetrics&); void showTelemetry(const char*);
+//   void logInfo(const char*); void logError(const char*); void pump();
+// and are composed at build time with UiSinks<...> (ui_UiSinks.h), so calls
+// resolve statically and inline. Status is typed (ui_UiStatus.h); text is only
+// for telemetry and messages. IUiAdapter is the runtime interface, kept for
+// tools that need type erasure (MeteredUi); wrap a sink with UiVirtual.
 
 class IUiAdapter
 {
 public:
     virtual void begin() = 0;
-    virtual void setStatus(const char *) = 0;
+    virtual void setLink(UiLink, LinkState) = 0;
+    virtual void setRelays(const UiRelayState &) = 0;
+    virtual void showMetrics(const UiLinkMetrics &) = 0;
     virtual void showTelemetry(const char *) = 0;
     virtual void logInfo(const char *) = 0;
     virtual void logError(const char *) = 0;
+    virtual void pump() {}   // adapter-specific per-tick work (flush, touch)
     virtual ~IUiAdapter() {}
-};
\ No newline at end of file
+};
+
+template <typename Sink>
+class UiVirtual : public IUiAdapter
+{
+public:
+    explicit UiVirtual(Sink &s) : sink(s) {}
+    void begin() override { sink.begin(); }
+    void setLink(UiLink l, LinkState s) override { sink.setLink(l, s); }
+    void setRelays(const UiRelayState &r) override { sink.setRelays(r); }
+    void showMetrics(const UiLinkMetrics &m) override { sink.showMetrics(m); }
+    void showTelemetry(const char *p) override { sink.showTelemetry(p); }
+    void logInfo(const char *m) override { sink.logInfo(m); }
+    void logError(const char *m) override { sink.logError(m); }
+    void pump() override { sink.pump(); }
+
+private:
+    Sink &sink;
+};
@@ -29,15 +29,63 @@ void M5CoreS3Ui::begin()
   g_disp_ready = true;
 }
 
-void M5CoreS3Ui::setStatus(const char *s)
+// Status row (y=40): "WiFi Time MQTT" names colored by state, relay levels on the right
+static uint16_t stateColor(LinkState s)
 {
-  if (!g_disp_ready)
+  switch (s) {
+    case LinkState::Up:         return TFT_GREEN;
+    case LinkState::Connecting: return TFT_YELLOW;
+    default:                    return TFT_RED;
+  }
+}
+
+void M5CoreS3Ui::setLink(UiLink l, LinkState s)
+{
+  const uint8_t i = (uint8_t)l;
+  if (!g_disp_ready || i >= (uint8_t)UiLink::Count || (linkShown[i] && links[i] == s))
+    return;
+  links[i] = s;
+  linkShown[i] = true;
+  M5.Display.setTextColor(stateColor(s), bg);
+  M5.Display.setCursor(10 + i * 72, 40); // 4 glyphs + gap at text size 2
+  M5.Display.print(uiLinkName(l));
+  M5.Display.setTextColor(fg, bg);
+}
+
+void M5CoreS3Ui::setRelays(const UiRelayState &r)
+{
+  if (!g_disp_ready || (relaysShown && r == relays))
     return;
-  M5.Display.fillRect(0, 40, M5.Display.width(), 20, bg);
+  relays = r;
+  relaysShown = true;
+  char t[8];
+  if (r.channels <= 1 || r.channels > 5) {
+    snprintf(t, sizeof(t), "%s", r.anyOn() ? "ON" : "OFF");
+  } else {
+    for (uint8_t ch = 0; ch < r.channels; ++ch) t[ch] = r.on(ch) ? '1' : '0';
+    t[r.channels] = '\0';
+  }
+  M5.Display.fillRect(226, 40, M5.Display.width() - 226, 20, bg);
+  M5.Display.setTextColor(r.anyOn() ? TFT_GREEN : TFT_RED, bg);
+  M5.Display.setCursor(226, 40);
+  M5.Display.print(t);
+  M5.Display.setTextColor(fg, bg);
+}
+
+void M5CoreS3Ui::showMetrics(const UiLinkMetrics &m)
+{
+  if (!g_disp_ready || m == metrics)
+    return;
+  metrics = m;
+  char t[64];
+  uiMetricsText(t, sizeof(t), m);
+  M5.Display.setTextSize(1);
+  M5.Display.fillRect(0, 144, M5.Display.width(), 10, bg);
   M5.Display.setTextColor(TFT_CYAN, bg);
-  M5.Display.setCursor(10, 40);
-  M5.Display.printf("Status: %s", s);
+  M5.Display.setCursor(10, 144);
+  M5.Display.print(t);
   M5.Display.setTextColor(fg, bg);
+  M5.Display.setTextSize(2);
 }
 
 void M5CoreS3Ui::showTelemetry(const char *p)
@@ -70,3 +118,8 @@ void M5CoreS3Ui::logError(const char *m)
   M5.Display.printf("ERROR: %s\n", m);
   M5.Display.setTextColor(fg, bg);
 }
+
+void M5CoreS3Ui::pump()
+{
+  M5.update();
+}
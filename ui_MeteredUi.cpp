@@ -0,0 +1,91 @@
+#include <Arduino.h>
+#include "ui_MeteredUi.h"
+
+static const char *const kCallNames[] = { "begin", "link", "relays", "metrics", "telemetry", "info", "error", "pump" };
+
+void MeteredUi::record(UiCall c, uint32_t t0)
+{
+  uint32_t dt = micros() - t0;
+  UiCallStats &s = callStats[(size_t)c];
+  s.calls++;
+  s.totalUs += dt;
+  if (dt > s.maxUs) s.maxUs = dt;
+}
+
+void MeteredUi::begin()                             { uint32_t t0 = micros(); ui.begin();            record(UiCall::Begin, t0); }
+void MeteredUi::setLink(UiLink l, LinkState s)      { uint32_t t0 = micros(); ui.setLink(l, s);      record(UiCall::Link, t0); }
+void MeteredUi::setRelays(const UiRelayState &r)    { uint32_t t0 = micros(); ui.setRelays(r);       record(UiCall::Relays, t0); }
+void MeteredUi::showMetrics(const UiLinkMetrics &m) { uint32_t t0 = micros(); ui.showMetrics(m);     record(UiCall::Metrics, t0); }
+void MeteredUi::showTelemetry(const char *p)        { uint32_t t0 = micros(); ui.showTelemetry(p);   record(UiCall::Telemetry, t0); }
+void MeteredUi::logInfo(const char *m)              { uint32_t t0 = micros(); ui.logInfo(m);         record(UiCall::Info, t0); }
+void MeteredUi::logError(const char *m)             { uint32_t t0 = micros(); ui.logError(m);        record(UiCall::Error, t0); }
+
+void MeteredUi::pump()
+{
+  uint32_t t0 = micros();
+  ui.pump();
+  record(UiCall::Pump, t0);
+}
+
+void MeteredUi::reset()
+{
+  for (UiCallStats &s : callStats) s = UiCallStats();
+}
+
+void MeteredUi::report(Print &out, const char *target) const
+{
+  uint32_t calls = 0, us = 0;
+  for (size_t i = 0; i < (size_t)UiCall::Count; ++i) {
+    const UiCallStats &s = callStats[i];
+    if (!s.calls) continue;
+    out.printf("[UI BENCH][%s] %-9s calls=%lu avg=%luus max=%luus\n", target, kCallNames[i],
+               (unsigned long)s.calls, (unsigned long)(s.totalUs / s.calls), (unsigned long)s.maxUs);
+    if (i != (size_t)UiCall::Begin) { calls += s.calls; us += s.totalUs; }
+  }
+  if (calls)
+    out.printf("[UI BENCH][%s] total events=%lu cost/event=%luus\n", target,
+               (unsigned long)calls, (unsigned long)(us / calls));
+}
+
+void uiReplayBenchmark(MeteredUi &ui, Print &out, const char *target, uint16_t relayCommands)
+{
+  ui.reset();
+
+  // Boot + connect
+  ui.logInfo("Connecting WiFi...");
+  ui.setLink(UiLink::WiFi, LinkState::Connecting);
+  ui.pump();
+  ui.setLink(UiLink::WiFi, LinkState::Up);
+  UiLinkMetrics m;
+  m.ip[0] = 192; m.ip[1] = 168; m.ip[2] = 1; m.ip[3] = 50;
+  m.rssi = -61;
+  ui.showMetrics(m);
+  ui.setLink(UiLink::Time, LinkState::Connecting);
+  ui.setLink(UiLink::Time, LinkState::Up);
+  ui.pump();
+  ui.setLink(UiLink::Mqtt, LinkState::Connecting);
+  for (int i = 0; i < 10; ++i) ui.pump(); // spinner frames while connecting
+  ui.setLink(UiLink::Mqtt, LinkState::Up);
+  ui.logInfo("MQTT connected");
+  m.tlsMs = 180;
+  ui.showMetrics(m);
+  ui.showTelemetry("Host=hub.azure-devices.net KeepAlive=120");
+  ui.pump();
+
+  // Relay command stream (one pump per loop() tick)
+  for (uint16_t i = 0; i < relayCommands; ++i) {
+    ui.setRelays(UiRelayState(~i & 1, 1));
+    ui.pump();
+  }
+
+  // Drop + reconnect
+  ui.setLink(UiLink::Mqtt, LinkState::Down);
+  ui.logError("MQTT connect failed");
+  ui.pump();
+  ui.setLink(UiLink::Mqtt, LinkState::Connecting);
+  ui.pump();
+  ui.setLink(UiLink::Mqtt, LinkState::Up);
+  ui.pump();
+
+  ui.report(out, target);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "ui_IUiAdapter.h"
+
+// IUiAdapter decorator that measures what each UI call costs on the target
+// (time per call, calls per kind). Wrap any sink (via UiVirtual) to compare
+// targets, or build with -D UI_BENCH to replay a boot -> connect -> relay-command sequence.
+
+enum class UiCall : uint8_t
+{
+    Begin = 0,
+    Link,
+    Relays,
+    Metrics,
+    Telemetry,
+    Info,
+    Error,
+    Pump,   // adapter-specific flush/loop, if any
+    Count
+};
+
+struct UiCallStats
+{
+    uint32_t calls = 0;
+    uint32_t totalUs = 0;
+    uint32_t maxUs = 0;
+};
+
+class MeteredUi : public IUiAdapter
+{
+public:
+    explicit MeteredUi(IUiAdapter &inner) : ui(inner) {}
+
+    void begin() override;
+    void setLink(UiLink, LinkState) override;
+    void setRelays(const UiRelayState &) override;
+    void showMetrics(const UiLinkMetrics &) override;
+    void showTelemetry(const char *) override;
+    void logInfo(const char *) override;
+    void logError(const char *) override;
+    void pump() override;             // adapter flush/loop hook, metered
+
+    const UiCallStats &stats(UiCall c) const { return callStats[(size_t)c]; }
+    void reset();
+    void report(Print &out, const char *target) const;
+
+private:
+    void record(UiCall c, uint32_t t0);
+
+    IUiAdapter &ui;
+    UiCallStats callStats[(size_t)UiCall::Count];
+};
+
+// Replays a realistic sequence (boot, WiFi/NTP/MQTT connect, N relay commands,
+// a reconnect) through 'ui' and prints cost per event to 'out'.
+void uiReplayBenchmark(MeteredUi &ui, Print &out, const char *target, uint16_t relayCommands = 1000);
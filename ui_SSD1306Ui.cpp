@@ -2,7 +2,35 @@
 #include "ui_SSD1306Ui.h"
 
 void SSD1306Ui::begin() { Serial.begin(115200); }
-void SSD1306Ui::setStatus(const char *s) { Serial.printf("[SSD1306 STATUS] %s\n", s); }
+
+void SSD1306Ui::setLink(UiLink l, LinkState s)
+{
+  const uint8_t i = (uint8_t)l;
+  if (i >= (uint8_t)UiLink::Count || (linkShown[i] && links[i] == s)) return;
+  links[i] = s;
+  linkShown[i] = true;
+  Serial.printf("[SSD1306 STATUS] %s %s\n", uiLinkName(l), uiLinkStateText(l, s));
+}
+
+void SSD1306Ui::setRelays(const UiRelayState &r)
+{
+  if (relaysShown && r == relays) return;
+  relays = r;
+  relaysShown = true;
+  char t[48];
+  uiRelayText(t, sizeof(t), r);
+  Serial.printf("[SSD1306 STATUS] Relay %s\n", t);
+}
+
+void SSD1306Ui::showMetrics(const UiLinkMetrics &m)
+{
+  if (m == metrics) return;
+  metrics = m;
+  char t[64];
+  uiMetricsText(t, sizeof(t), m);
+  Serial.printf("[SSD1306 METRICS] %s\n", t);
+}
+
 void SSD1306Ui::showTelemetry(const char *p) { Serial.printf("[SSD1306 TELEMETRY] %s\n", p); }
 void SSD1306Ui::logInfo(const char *m) { Serial.printf("[SSD1306 INFO] %s\n", m); }
 void SSD1306Ui::logError(const char *m) { Serial.printf("[SSD1306 ERROR] %s\n", m); }
\ No newline at end of file
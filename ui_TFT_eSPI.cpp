@@ -1,12 +1,5 @@
 #include "ui_TFT_eSPI.h"
 
-// --- Fallbacks: build safely even if stale header is being used ---
-#ifndef TOUCH_DEBOUNCE_MS
-static constexpr uint32_t TOUCH_DEBOUNCE_MS = 250;
-static uint32_t s_lastTouchMs = 0;
-#define USE_LOCAL_DEBOUNCE 1
-#endif
-
 void TftEspiUi::begin()
 {
   Serial.begin(115200);
@@ -25,24 +18,37 @@ void TftEspiUi::begin()
   header("CadIOT Relay");
   tft.setTextSize(1);
 
-  // Initial info row
-  drawLine(yInfo, "Info", "[Boot]", subtext);
-
   // Compute right column X for split row (WiFi left, MQTT right)
   const int width  = tft.width();    // ~320
   rightColX = width / 2 + colGap;    // right column starts near middle with small gap
 
-  // Initial split status row (empty values)
-  drawSplitStatusRow();
-
-  // Telemetry header block (under WiFi/MQTT)
-  tft.fillRect(0, yTelHdr - 2, width, 46, bg);
-  tft.setTextColor(TFT_CYAN, bg);
-  tft.setCursor(8, yTelHdr);
-  tft.print("Telemetry");
-
-  // Relay line (initial)
-  drawLineWithBadge(yRelay, "Relay", relayLine, subtext);
+  // --- Widget geometry (labels are static; only values/badges/icons redraw) ---
+  infoLabel.x  = 20;              infoLabel.y  = yInfo;   infoLabel.w  = 7 * CHAR_W;
+  infoValue.x  = 20 + 7 * CHAR_W; infoValue.y  = yInfo;   infoValue.w  = width - infoValue.x - colPad;
+  wifiBadge.x  = leftColX;        wifiBadge.y  = yStatus + 8;
+  wifiValue.x  = leftColX + 12 + 6 * CHAR_W; wifiValue.y = yStatus;
+  wifiValue.w  = rightColX - colGap - wifiValue.x;
+  mqttBadge.x  = rightColX;       mqttBadge.y  = yStatus + 8;
+  spinnerCell.x = rightColX + 12 + 6 * CHAR_W; spinnerCell.y = yStatus; spinnerCell.w = CHAR_W;
+  mqttValue.x  = spinnerCell.x + CHAR_W + 2;   mqttValue.y = yStatus;
+  mqttValue.w  = width - mqttValue.x - colPad;
+  relayBadge.x = 10;              relayBadge.y = yRelay + 8;
+  chanValue.w  = 10 * CHAR_W;     chanValue.y  = yRelay;  chanValue.x  = width - colPad - chanValue.w;
+  relayValue.x = 34 + 7 * CHAR_W; relayValue.y = yRelay;
+  relayValue.w = (relayChannels > 1 ? chanValue.x - colGap : width - colPad) - relayValue.x;
+  telValue.x   = 8;               telValue.y   = yTel;    telValue.w   = width - 16;
+  metricsValue.x = 8;             metricsValue.y = yMetrics; metricsValue.w = width - 16;
+
+  drawStaticLabels();
+
+  // Initial content (flushed below)
+  setText(infoLabel, "Info:", subtext);
+  setText(infoValue, "[Boot]", fg);
+  setBadge(wifiBadge, linkColor(UiLink::WiFi));
+  setBadge(mqttBadge, linkColor(UiLink::Mqtt));
+  setBadge(relayBadge, relayColor());
+  relayIconDirty = true;
+  showChannel();
 
   // Divider above buttons
   drawFooterDivider();
@@ -62,226 +68,225 @@ void TftEspiUi::begin()
   ts.setRotation(ROTATION_LANDSCAPE);
 
   drawButtons();
+  flush();
 }
 
-void TftEspiUi::setStatus(const char *s)
+void TftEspiUi::setLink(UiLink l, LinkState st)
 {
-  updateLinesFromStatus(s);
-
-  String msg(s);
-  if (msg.startsWith("WiFi")) {
-    wifiLine = msg;
-    drawSplitStatusRow(); // re-render WiFi (left) + MQTT (right)
-  } else if (msg.startsWith("MQTT")) {
-    mqttLine = msg;
-    drawSplitStatusRow();
-  } else if (msg.indexOf("Relay") >= 0) {
-    relayLine = msg;
-    drawLineWithBadge(yRelay, "Relay", relayLine, subtext);
-  } else {
-    drawLine(yInfo, "Info", msg, subtext);
+  const uint8_t i = (uint8_t)l;
+  if (i >= (uint8_t)UiLink::Count || (linkKnown[i] && links[i] == st)) return;
+  links[i] = st;
+  linkKnown[i] = true;
+  const char *text = uiLinkStateText(l, st);
+  switch (l) {
+    case UiLink::WiFi:
+      setText(wifiValue, text, fg);
+      setBadge(wifiBadge, linkColor(l));
+      break;
+    case UiLink::Mqtt:
+      setText(mqttValue, text, fg);
+      setBadge(mqttBadge, linkColor(l));
+      if (st != LinkState::Connecting) setText(spinnerCell, "", TFT_YELLOW);
+      break;
+    default: {
+      // No row of its own: the clock shows on the info line
+      char line[24];
+      snprintf(line, sizeof(line), "%s %s", uiLinkName(l), text);
+      setText(infoLabel, "Info:", st == LinkState::Up ? TFT_GREEN : subtext);
+      setText(infoValue, line, fg);
+      break;
+    }
   }
-
-  Serial.printf("[TFT STATUS] %s\n", s);
+  Serial.printf("[TFT STATUS] %s %s\n", uiLinkName(l), text);
 }
 
-void TftEspiUi::showTelemetry(const char *p)
+void TftEspiUi::setRelays(const UiRelayState &r)
 {
-  telLine = p;
-  tft.fillRect(0, yTelHdr, tft.width(), 46, bg);
-
-  // Telemetry header (accent color already set in begin)
-  tft.setTextColor(TFT_CYAN, bg);
-  tft.setCursor(8, yTelHdr);
-  tft.print("Telemetry");
+  if (relaysKnown && r == relays) return;
+  const bool wasOn = relays.anyOn();
+  relays = r;
+  relaysKnown = true;
+  char text[TEXT_MAX];
+  uiRelayText(text, sizeof(text), r);
+  setText(relayValue, text, fg);
+  setBadge(relayBadge, relayColor());
+  if (wasOn != r.anyOn() || relayIconShown < 0) relayIconDirty = true;
+  Serial.printf("[TFT STATUS] Relay %s\n", text);
+}
 
-  // Telemetry value under the split status row
-  tft.setTextColor(fg, bg);
-  tft.setCursor(8, yTel);
-  tft.print(telLine);
+void TftEspiUi::showMetrics(const UiLinkMetrics &m)
+{
+  if (m == metrics) return;
+  metrics = m;
+  char text[TEXT_MAX];
+  uiMetricsText(text, sizeof(text), m);
+  setText(metricsValue, text, subtext);
+  Serial.printf("[TFT METRICS] %s\n", text);
+}
 
+void TftEspiUi::showTelemetry(const char *p)
+{
+  setText(telValue, p, fg);
   Serial.printf("[TFT TELEMETRY] %s\n", p);
 }
 
 void TftEspiUi::logInfo(const char *m)
 {
-  updateLinesFromInfo(m);
-  drawLine(yInfo, "Info", String(m), TFT_GREEN);
+  setText(infoLabel, "Info:", TFT_GREEN);
+  setText(infoValue, m, fg);
   Serial.printf("[TFT INFO] %s\n", m);
 }
 
 void TftEspiUi::logError(const char *m)
 {
-  drawLine(yInfo, "Error", String(m), TFT_RED);
+  setText(infoLabel, "Error:", TFT_RED);
+  setText(infoValue, m, fg);
   Serial.printf("[TFT ERROR] %s\n", m);
 }
 
-// --- Visuals ---
-
-void TftEspiUi::header(const char* title)
+void TftEspiUi::setText(TextWidget& w, const char* s, uint16_t color)
 {
-  // Blue header panel and red divider
-  tft.fillRect(0, yHeader, tft.width(), 30, headerBG);
-  tft.fillRect(0, yHeader + 30, tft.width(), 2, accent);
-
-  tft.setTextColor(TFT_WHITE, headerBG);
-  tft.setCursor(8, yHeader + 6);
-  tft.print(title);
+  if (w.color == color && strncmp(w.text, s, sizeof(w.text) - 1) == 0) return;
+  strlcpy(w.text, s, sizeof(w.text));
+  w.color = color;
+  w.dirty = true;
 }
 
-void TftEspiUi::drawLine(int y, const char* label, const String& value, uint16_t textColor)
+void TftEspiUi::setBadge(BadgeWidget& b, uint16_t color)
 {
-  // Clear row area
-  tft.fillRect(0, y - 2, tft.width(), 22, bg);
-
-  // Label
-  tft.setTextColor(textColor, bg);
-  tft.setCursor(20, y);
-  tft.print(label);
-  tft.print(": ");
-
-  // Value
-  tft.setTextColor(fg, bg);
-  tft.print(value);
+  if (b.color == color && b.shownColor == color) return;
+  b.color = color;
+  b.dirty = true;
 }
 
-void TftEspiUi::drawLineWithBadge(int y, const char* label, const String& value, uint16_t textColor)
+// Redraw only glyphs that differ from what is on screen, then clear any tail.
+void TftEspiUi::drawText(TextWidget& w)
 {
-  // Clear row area
-  tft.fillRect(0, y - 2, tft.width(), 22, bg);
-
-  // Badge
-  uint16_t bcol = badgeColorFor(label, value);
-  tft.fillCircle(10, y + 8, 5, bcol);
-
-  // Optional icon next to Relay: ✔ (on) or × (off)
-  if (String(label).equalsIgnoreCase("Relay")) {
-    bool on = relayIsOn();
-    drawRelayCheckOrX(20, y + 3, on); // small icon near label
+  const size_t maxChars = w.w > 0 ? (size_t)(w.w / CHAR_W) : 0;
+  size_t newLen = strlen(w.text);
+  if (newLen > maxChars) newLen = maxChars;
+  const size_t oldLen = strlen(w.shown);
+  const bool recolor = w.color != w.shownColor;
+
+  for (size_t i = 0; i < newLen; ++i) {
+    if (!recolor && i < oldLen && w.text[i] == w.shown[i]) continue;
+    tft.drawChar(w.x + (int)i * CHAR_W, w.y, w.text[i], w.color, bg, 1);
+    countPx(CHAR_W * CHAR_H);
+  }
+  if (oldLen > newLen) {
+    const int tailW = (int)(oldLen - newLen) * CHAR_W;
+    tft.fillRect(w.x + (int)newLen * CHAR_W, w.y, tailW, CHAR_H, bg);
+    countPx(tailW * CHAR_H);
   }
 
-  // Label + value
-  tft.setTextColor(textColor, bg);
-  tft.setCursor(34, y); // shift right to account for icon
-  tft.print(label);
-  tft.print(": ");
-
-  tft.setTextColor(fg, bg);
-  tft.print(value);
+  memcpy(w.shown, w.text, newLen);
+  w.shown[newLen] = '\0';
+  w.shownColor = w.color;
+  w.dirty = false;
 }
 
-uint16_t TftEspiUi::badgeColorFor(const char* label, const String& value)
+void TftEspiUi::drawBadge(BadgeWidget& b)
 {
-  String v = value; v.toLowerCase();
-  String lbl(label); lbl.toLowerCase();
-
-  // Relay badge
-  if (lbl == "relay") {
-    if (v.indexOf("on") >= 0)   return TFT_GREEN;
-    if (v.indexOf("off") >= 0)  return TFT_RED;
-    return TFT_YELLOW;
-  }
-
-  // WiFi/MQTT badge
-  if (lbl == "wifi" || lbl == "mqtt") {
-    if (v.indexOf("connected") >= 0)    return TFT_GREEN;
-    if (v.indexOf("connecting") >= 0 ||
-        v.indexOf("reconnect") >= 0)    return TFT_YELLOW;
-    if (v.indexOf("disconnected") >= 0 ||
-        v.indexOf("failed") >= 0  ||
-        v.indexOf("error") >= 0)        return TFT_RED;
-    return subtext; // unknown state
+  if (b.color != b.shownColor) {
+    tft.fillCircle(b.x, b.y, 5, b.color);
+    countPx(11 * 11);
+    b.shownColor = b.color;
   }
-
-  // Default
-  return subtext;
+  b.dirty = false;
 }
 
-void TftEspiUi::drawSplitStatusRow()
+void TftEspiUi::flush()
 {
-  const int width = tft.width();
-  // Clear the split row area
-  tft.fillRect(0, yStatus - 2, width, 22, bg);
-
-  // --- Left: WiFi (with badge) ---
-  {
-    const int leftX = leftColX;
-    const int baseline = yStatus;
-    // Badge color derived from WiFi line
-    uint16_t bWiFi = badgeColorFor("WiFi", wifiLine);
-    tft.fillCircle(leftX, baseline + 8, 5, bWiFi);
-
-    tft.setTextColor(subtext, bg);
-    tft.setCursor(leftX + 12, baseline);
-    tft.print("WiFi: ");
-
-    tft.setTextColor(fg, bg);
-    tft.print(wifiLine);
+  TextWidget* texts[] = { &infoLabel, &infoValue, &wifiValue, &spinnerCell,
+                          &mqttValue, &relayValue, &telValue, &metricsValue, &chanValue };
+  for (TextWidget* w : texts) if (w->dirty) drawText(*w);
+
+  BadgeWidget* badges[] = { &wifiBadge, &mqttBadge, &relayBadge };
+  for (BadgeWidget* b : badges) if (b->dirty) drawBadge(*b);
+
+  if (relayIconDirty) {
+    const bool on = relayIsOn();
+    tft.fillRect(20, yRelay + 1, 12, 12, bg);
+    countPx(12 * 12);
+    drawRelayCheckOrX(20, yRelay + 3, on); // small icon near label
+    relayIconShown = on ? 1 : 0;
+    relayIconDirty = false;
   }
 
-  // --- Right: MQTT (with badge + spinner when connecting) ---
-  {
-    const int rightX = rightColX;
-    const int baseline = yStatus;
-    uint16_t bMqtt = badgeColorFor("MQTT", mqttLine);
-    tft.fillCircle(rightX, baseline + 8, 5, bMqtt);
-
-    tft.setTextColor(subtext, bg);
-    tft.setCursor(rightX + 12, baseline);
-    tft.print("MQTT: ");
-
-    // Optional spinner glyph just before the value
-    if (mqttIsConnecting()) {
-      // Draw spinner at a fixed spot near the label
-      drawSpinnerFrame(rightX + 45, baseline); // adjust offset to taste
-    }
-
-    tft.setTextColor(fg, bg);
-    tft.setCursor(rightX + 45, baseline); // value starts after the spinner
-    tft.print(mqttLine);
+  if (framePx) {
+    fstats.frames++;
+    fstats.lastPixels = framePx;
+    fstats.lastBytes = framePx * 2;
+    if (framePx > fstats.maxPixels) fstats.maxPixels = framePx;
+    fstats.totalBytes += (uint64_t)framePx * 2;
+    framePx = 0;
   }
 }
 
-void TftEspiUi::drawFooterDivider()
+// --- Visuals ---
+
+void TftEspiUi::header(const char* title)
 {
-  // Thin divider above the button bar
-  tft.drawFastHLine(0, yFooter, tft.width(), panel);
+  // Blue header panel and red divider
+  tft.fillRect(0, yHeader, tft.width(), 30, headerBG);
+  tft.fillRect(0, yHeader + 30, tft.width(), 2, accent);
+  countPx(tft.width() * 32);
+
+  tft.setTextColor(TFT_WHITE, headerBG);
+  tft.setCursor(8, yHeader + 6);
+  tft.print(title);
 }
 
-void TftEspiUi::ensureBacklightOn()
+void TftEspiUi::drawStaticLabels()
 {
-  pinMode(TFT_BL_PIN, OUTPUT);
-  digitalWrite(TFT_BL_PIN, HIGH); // Backlight ON (per LCDWiki mapping)
+  tft.setTextSize(1);
+  tft.setTextColor(subtext, bg);
+  tft.setCursor(leftColX + 12, yStatus);
+  tft.print("WiFi: ");
+  tft.setCursor(rightColX + 12, yStatus);
+  tft.print("MQTT: ");
+  tft.setCursor(34, yRelay);
+  tft.print("Relay: ");
+
+  // Telemetry header (under WiFi/MQTT)
+  tft.setTextColor(TFT_CYAN, bg);
+  tft.setCursor(8, yTelHdr);
+  tft.print("Telemetry");
+  countPx((6 + 6 + 7 + 9) * CHAR_W * CHAR_H);
+  tft.setTextColor(fg, bg);
 }
 
-// --- Spinner & icons ---
-
-bool TftEspiUi::mqttIsConnecting() const
+uint16_t TftEspiUi::linkColor(UiLink l) const
 {
-  String v = mqttLine; v.toLowerCase();
-  return (v.indexOf("connecting") >= 0 || v.indexOf("reconnect") >= 0);
+  const uint8_t i = (uint8_t)l;
+  if (!linkKnown[i]) return subtext; // no event yet
+  switch (links[i]) {
+    case LinkState::Connecting: return TFT_YELLOW;
+    case LinkState::Up:         return TFT_GREEN;
+    default:                    return TFT_RED;
+  }
 }
 
-bool TftEspiUi::relayIsOn() const
+uint16_t TftEspiUi::relayColor() const
 {
-  String v = relayLine; v.toLowerCase();
-  return (v.indexOf("on") >= 0);
+  if (!relaysKnown) return TFT_YELLOW;
+  return relays.anyOn() ? TFT_GREEN : TFT_RED;
 }
 
-void TftEspiUi::drawSpinnerFrame(int x, int y)
+void TftEspiUi::drawFooterDivider()
 {
-  // Erase spinner area first (fixed small rect)
-  tft.fillRect(x, y - 2, 10, 14, bg);
-
-  // Define spinner frames locally in this scope
-  static const char frames[4] = { '|', '/', '-', '\\' };
-  char c = frames[spinnerIndex & 0x03];
+  // Thin divider above the button bar
+  tft.drawFastHLine(0, yFooter, tft.width(), panel);
+  countPx(tft.width());
+}
 
-  tft.setTextColor(TFT_YELLOW, bg);
-  tft.setCursor(x + 2, y);
-  tft.print(c);
+void TftEspiUi::ensureBacklightOn()
+{
+  pinMode(TFT_BL_PIN, OUTPUT);
+  digitalWrite(TFT_BL_PIN, HIGH); // Backlight ON (per LCDWiki mapping)
 }
 
+// --- Spinner & icons ---
 
 void TftEspiUi::drawRelayCheckOrX(int x, int y, bool on)
 {
@@ -295,14 +300,15 @@ void TftEspiUi::drawRelayCheckOrX(int x, int y, bool on)
     tft.drawLine(x + 1, y + 1, x + 9, y + 9, TFT_RED);
     tft.drawLine(x + 9, y + 1, x + 1, y + 9, TFT_RED);
   }
+  countPx(20);
 }
 
 // --- Touch ---
 
-// Convert raw touch to screen coords and return true if pressed
+// One SPI sample: convert raw touch to screen coords, true if pressure is valid
 bool TftEspiUi::readTouch(uint16_t& sx, uint16_t& sy)
 {
-  if (!ts.touched()) return false;
+  touchSamples++;
   TS_Point p = ts.getPoint(); // x, y, z (pressure)
   if (p.z < 40) return false; // threshold 0..255; tweak as needed
 
@@ -329,108 +335,123 @@ void TftEspiUi::drawButtons()
 {
   // Bar background
   tft.fillRect(0, barY, tft.width(), barH, panel);
+  countPx(tft.width() * barH);
 
-  // Use bigger text for button labels
-  tft.setTextSize(2);
+  drawButton(0, false);
+  drawButton(1, false);
+}
 
-  // Left button: Test Relay
-  tft.fillRoundRect(btn1X, btn1Y, btnW, btnH, 10, TFT_NAVY);
-  tft.drawRoundRect(btn1X, btn1Y, btnW, btnH, 10, TFT_WHITE);
-  tft.setTextColor(TFT_WHITE, TFT_NAVY);
-  tft.setCursor(btn1X + 14, btn1Y + (btnH/2 - 7));
-  tft.print("Test Relay");
+// Button face; 'pressed' gives immediate (non-blocking) press feedback
+void TftEspiUi::drawButton(int8_t which, bool pressed)
+{
+  const int x = which == 0 ? btn1X : btn2X;
+  const int y = which == 0 ? btn1Y : btn2Y;
+  const uint16_t face = which == 0 ? (pressed ? TFT_BLUE : TFT_NAVY)
+                                   : (pressed ? TFT_RED : TFT_MAROON);
 
-  // Right button: Relay OFF
-  tft.fillRoundRect(btn2X, btn2Y, btnW, btnH, 10, TFT_MAROON);
-  tft.drawRoundRect(btn2X, btn2Y, btnW, btnH, 10, TFT_WHITE);
-  tft.setTextColor(TFT_WHITE, TFT_MAROON);
-  tft.setCursor(btn2X + 14, btn2Y + (btnH/2 - 7));
-  tft.print("Relay OFF");
+  // Use bigger text for button labels
+  tft.setTextSize(2);
+  tft.fillRoundRect(x, y, btnW, btnH, 10, face);
+  tft.drawRoundRect(x, y, btnW, btnH, 10, TFT_WHITE);
+  tft.setTextColor(TFT_WHITE, face);
+  tft.setCursor(x + 14, y + (btnH/2 - 7));
+  tft.print(which == 0 ? "Test Relay" : "Relay OFF");
+  countPx(btnW * btnH);
 
   // Restore default row text size
   tft.setTextSize(1);
 }
 
+int8_t TftEspiUi::buttonAt(uint16_t x, uint16_t y)
+{
+  if (inRect(x, y, btn1X, btn1Y, btnW, btnH)) return 0;
+  if (inRect(x, y, btn2X, btn2Y, btnW, btnH)) return 1;
+  if (relayChannels > 1 && inRect(x, y, 0, yRelay - 8, tft.width(), CHAR_H + 16)) return BTN_CHANNEL;
+  return -1;
+}
+
+void TftEspiUi::showChannel()
+{
+  if (relayChannels <= 1) return;
+  char s[12];
+  snprintf(s, sizeof(s), "ch %u/%u >", (unsigned)selectedCh, (unsigned)(relayChannels - 1));
+  setText(chanValue, s, TFT_CYAN);
+}
+
 bool TftEspiUi::inRect(uint16_t x, uint16_t y, int rx, int ry, int rw, int rh)
 {
   return (x >= rx && x < (rx + rw) && y >= ry && y < (ry + rh));
 }
 
-void TftEspiUi::loop()
+// Buttons act on release inside the pressed button; long-press on
+// "Test Relay" latches the selected channel ON instead of pulsing it, and
+// long-press on "Relay OFF" turns every channel OFF. Tapping the relay row
+// selects the next channel.
+void TftEspiUi::handleTouch(const TouchEvent& e)
 {
-  uint16_t x, y;
-  if (!readTouch(x, y)) {
-    // No touch; animate spinner if needed
-    if (mqttIsConnecting()) {
-      uint32_t now = millis();
-      if (now - lastSpinnerMs >= SPINNER_INTERVAL_MS) {
-        lastSpinnerMs = now;
-        spinnerIndex = (spinnerIndex + 1) & 0x03;
-        // Re-render the split row to refresh spinner glyph
-        drawSplitStatusRow();
+  switch (e.type) {
+    case TouchEventType::Press:
+      pressedBtn = buttonAt(e.x, e.y);
+      if (pressedBtn == 0 || pressedBtn == 1) drawButton(pressedBtn, true);
+      break;
+
+    case TouchEventType::LongPress:
+      if (pressedBtn == 0) {
+        drawButton(0, false);
+        pressedBtn = -1; // consumed; release does nothing
+        if (onRelayOn) onRelayOn(selectedCh);
+        else logInfo("No handler: onRelayOn");
+      } else if (pressedBtn == 1 && relayChannels > 1) {
+        drawButton(1, false);
+        pressedBtn = -1;
+        if (onAllOff) onAllOff();
+        else logInfo("No handler: onAllOff");
+      }
+      break;
+
+    case TouchEventType::Release: {
+      const int8_t b = pressedBtn;
+      pressedBtn = -1;
+      if (b < 0) break;
+      if (b != BTN_CHANNEL) drawButton(b, false);
+      if (buttonAt(e.x, e.y) != b) break; // slid off: cancel
+      if (b == BTN_CHANNEL) {
+        selectedCh = (uint8_t)((selectedCh + 1) % relayChannels);
+        showChannel();
+      } else if (b == 0) {
+        if (onTestRelay) onTestRelay(selectedCh);
+        else logInfo("No handler: onTestRelay");
+      } else {
+        if (onRelayOff) onRelayOff(selectedCh);
+        else logInfo("No handler: onRelayOff");
       }
+      break;
     }
-    return;
   }
+}
 
+void TftEspiUi::loop()
+{
   const uint32_t now = millis();
-  if (now - lastTouchMs < TOUCH_DEBOUNCE_MS) return; // debounce
-  lastTouchMs = now;
-
-  if (inRect(x, y, btn1X, btn1Y, btnW, btnH)) {
-    // Visual press effect
-    tft.fillRoundRect(btn1X, btn1Y, btnW, btnH, 10, TFT_BLUE);
-    tft.drawRoundRect(btn1X, btn1Y, btnW, btnH, 10, TFT_WHITE);
-    delay(100);
-    drawButtons();
-
-    // Action
-    if (onTestRelay) onTestRelay();
-    else logInfo("No handler: onTestRelay");
+
+  // Sample only after the IRQ fired or while a gesture is in progress;
+  // an idle panel costs no SPI traffic.
+  if (touch.active() || ts.tirqTouched()) {
+    uint16_t x = 0, y = 0;
+    bool valid = readTouch(x, y);
+    touch.feed(now, valid, x, y);
   }
-  else if (inRect(x, y, btn2X, btn2Y, btnW, btnH)) {
-    tft.fillRoundRect(btn2X, btn2Y, btnW, btnH, 10, TFT_RED);
-    tft.drawRoundRect(btn2X, btn2Y, btnW, btnH, 10, TFT_WHITE);
-    delay(100);
-    drawButtons();
-
-    if (onRelayOff) onRelayOff();
-    else logInfo("No handler: onRelayOff");
+  TouchEvent e;
+  while (touch.pop(e)) handleTouch(e);
+
+  // Animate spinner: only its one-glyph cell is marked dirty
+  if (mqttIsConnecting() && now - lastSpinnerMs >= SPINNER_INTERVAL_MS) {
+    lastSpinnerMs = now;
+    spinnerIndex = (spinnerIndex + 1) & 0x03;
+    static const char frames[4][2] = { "|", "/", "-", "\\" };
+    setText(spinnerCell, frames[spinnerIndex], TFT_YELLOW);
   }
-}
-
-// --- Update helpers (SAS fully removed) ---
 
-void TftEspiUi::updateLinesFromStatus(const char* s)
-{
-  String msg(s);
-  if (msg.startsWith("WiFi")) {
-    wifiLine = msg;
-    drawSplitStatusRow();
-  } else if (msg.startsWith("MQTT")) {
-    mqttLine = msg;
-    drawSplitStatusRow();
-  } else if (msg.startsWith("Relay")) {
-    relayLine = msg;
-    drawLineWithBadge(yRelay, "Relay", relayLine, subtext);
-  } else {
-    drawLine(yInfo, "Info", msg, subtext);
-  }
+  // Coalesced redraw: at most one flush per loop() tick
+  flush();
 }
-
-void TftEspiUi::updateLinesFromInfo(const char* m)
-{
-  String msg(m);
-  if (msg.startsWith("WiFi")) {
-    wifiLine = msg;
-    drawSplitStatusRow();
-  } else if (msg.startsWith("MQTT")) {
-    mqttLine = msg;
-    drawSplitStatusRow();
-  } else if (msg.startsWith("Relay")) {
-    relayLine = msg;
-    drawLineWithBadge(yRelay, "Relay", relayLine, subtext);
-  } else {
-    drawLine(yInfo, "Info", msg, subtext);
-  }
-}
\ No newline at end of file
@@ -1,28 +1,47 @@
 
 #pragma once
 #include <Arduino.h>
-#include "ui_IUiAdapter.h"
 #include <TFT_eSPI.h>               // Bodmer's TFT library (uses your User_Setup)
 #include <SPI.h>
 #include <XPT2046_Touchscreen.h>    // Paul Stoffregen's touch library
+#include "ui_TouchGestures.h"
+#include "ui_UiStatus.h"
 
-class TftEspiUi : public IUiAdapter
+class TftEspiUi
 {
 public:
-    // IUiAdapter
-    void begin() override;
-    void setStatus(const char *) override;     // Relay/WiFi/MQTT status messages
-    void showTelemetry(const char *) override; // Latest telemetry string
-    void logInfo(const char *) override;
-    void logError(const char *) override;
+    // UI sink (see ui_IUiAdapter.h)
+    void begin();
+    void setLink(UiLink, LinkState);
+    void setRelays(const UiRelayState &);
+    void showMetrics(const UiLinkMetrics &);
+    void showTelemetry(const char *); // Latest telemetry string
+    void logInfo(const char *);
+    void logError(const char *);
     ~TftEspiUi() {}
 
-    // Poll touch each loop (non-blocking)
+    // Poll touch and flush dirty widgets; call once per loop()
     void loop();
-
-    // App-wired callbacks for UI actions (plain function pointers)
-    void (*onTestRelay)() = nullptr; // momentary ON then OFF
-    void (*onRelayOff)()  = nullptr; // force OFF
+    void pump() { loop(); }
+
+    // Per-frame SPI cost of flush()
+    struct FrameStats
+    {
+        uint32_t frames = 0;      // flushes that pushed pixels
+        uint32_t lastPixels = 0;
+        uint32_t lastBytes = 0;
+        uint32_t maxPixels = 0;
+        uint64_t totalBytes = 0;
+    };
+    const FrameStats& frameStats() const { return fstats; }
+
+    // App-wired callbacks for UI actions (plain function pointers);
+    // 'ch' is the channel selected on the relay row
+    void (*onTestRelay)(uint8_t ch) = nullptr; // tap: momentary ON then OFF
+    void (*onRelayOn)(uint8_t ch)   = nullptr; // long-press on Test Relay: latch ON
+    void (*onRelayOff)(uint8_t ch)  = nullptr; // force OFF
+    void (*onAllOff)()              = nullptr; // long-press on Relay OFF: every channel OFF
+    uint8_t relayChannels = 1;                 // >1: tapping the relay row cycles the channel
 
 private:
     // --- Theme ---
@@ -42,7 +61,7 @@ private:
     static constexpr int TFT_BL_PIN = 21;
 
     // --- Touch (XPT2046) pins per LCDWiki 2.8" board ---
-    static constexpr int TP_IRQ_PIN = 36; // optional IRQ (low when pressed)
+    static constexpr int TP_IRQ_PIN = 36; // IRQ (low when pressed); gates all touch SPI traffic
     static constexpr int TP_CS_PIN  = 33;
     static constexpr int TP_CLK_PIN = 25;
     static constexpr int TP_MISO_PIN= 39;
@@ -79,39 +98,84 @@ private:
     // Telemetry block (under WiFi+MQTT row)
     int yTelHdr   = 110;
     int yTel      = 130;
+    int yMetrics  = 146;     // IP / RSSI / TLS under the telemetry line
 
     // Divider above buttons
     int yFooter   = 194;
 
-    // Data lines
-    String wifiLine, mqttLine, relayLine, telLine, statusLine;
+    // --- Retained widgets: setters only mark dirty; flush() redraws changed glyphs ---
+    static constexpr int CHAR_W = 6;   // GLCD font, text size 1
+    static constexpr int CHAR_H = 8;
+    static constexpr size_t TEXT_MAX = 56;
+
+    struct TextWidget
+    {
+        int16_t x = 0, y = 0, w = 0;  // value area; w bounds the glyph count
+        uint16_t color = TFT_WHITE;
+        uint16_t shownColor = TFT_WHITE;
+        char text[TEXT_MAX] = "";     // wanted
+        char shown[TEXT_MAX] = "";    // on screen
+        bool dirty = false;
+    };
+
+    struct BadgeWidget
+    {
+        int16_t x = 0, y = 0;
+        uint16_t color = TFT_DARKGREY;
+        uint16_t shownColor = 0xFFFF; // force first draw
+        bool dirty = false;
+    };
+
+    TextWidget infoLabel, infoValue;
+    TextWidget wifiValue, mqttValue, spinnerCell;
+    TextWidget relayValue, telValue, metricsValue, chanValue;
+    BadgeWidget wifiBadge, mqttBadge, relayBadge;
+    int8_t relayIconShown = -1;       // -1 unknown, 0 = ×, 1 = ✔
+    bool relayIconDirty = false;
+
+    // Status model (typed; text is formatted only when a value changes)
+    LinkState links[(uint8_t)UiLink::Count] = {};
+    bool linkKnown[(uint8_t)UiLink::Count] = {};  // false until the first event
+    UiRelayState relays;
+    bool relaysKnown = false;
+    UiLinkMetrics metrics;
+
+    void setText(TextWidget& w, const char* s, uint16_t color);
+    void setBadge(BadgeWidget& b, uint16_t color);
+    void drawText(TextWidget& w);
+    void drawBadge(BadgeWidget& b);
+    void flush();                       // one redraw pass per loop() tick
 
     // Drawing helpers
     void header(const char* title);
     void drawFooterDivider();
     void ensureBacklightOn();
+    void drawStaticLabels();
 
-    // Rows (with optional badge)
-    void drawLine(int y, const char* label, const String& value, uint16_t textColor=TFT_WHITE);
-    void drawLineWithBadge(int y, const char* label, const String& value, uint16_t textColor);
-    uint16_t badgeColorFor(const char* label, const String& value);
-
-    // Split row (WiFi left, MQTT right)
-    void drawSplitStatusRow();
-
-    // Spinner & icons
-    void drawSpinnerFrame(int x, int y);             // draws the current spinner glyph
+    // Status visuals (WiFi/MQTT/Relay)
+    uint16_t linkColor(UiLink l) const;
+    uint16_t relayColor() const;
     void drawRelayCheckOrX(int x, int y, bool on);   // draws ✔ when ON, × when OFF
-    bool mqttIsConnecting() const;                   // helper to detect connecting state
-    bool relayIsOn() const;                          // helper to detect relay ON/OFF
+    bool mqttIsConnecting() const { return links[(uint8_t)UiLink::Mqtt] == LinkState::Connecting; }
+    bool relayIsOn() const { return relays.anyOn(); }
 
     // Spinner state
     uint8_t  spinnerIndex = 0;                       // 0..3 for "|/-\"
     uint32_t lastSpinnerMs = 0;
     static constexpr uint32_t SPINNER_INTERVAL_MS = 200;
 
-    // Touch helpers
+    // Pixel accounting (RGB565 -> 2 bytes/pixel over SPI)
+    uint32_t framePx = 0;
+    FrameStats fstats;
+    void countPx(uint32_t n) { framePx += n; }
+
+    // Touch: the XPT2046 IRQ wakes sampling; samples feed the gesture engine
     bool readTouch(uint16_t& sx, uint16_t& sy);
+    void handleTouch(const TouchEvent& e);
+    TouchGestures touch;
+    int8_t pressedBtn = -1;            // button under the current press (-1 none)
+    uint8_t selectedCh = 0;
+    uint32_t touchSamples = 0;         // SPI samples taken (idle cost should stay 0)
 
     // --- Buttons area (bottom bar) ---
     int barY      = 200;  // computed in begin()
@@ -121,14 +185,11 @@ private:
     int btnH;             // computed in begin()
     int btn1X, btn1Y;     // "Test Relay"
     int btn2X, btn2Y;     // "Relay OFF"
+    static constexpr int8_t BTN_CHANNEL = 2; // relay row: channel selector
+    void showChannel();
     void drawButtons();
+    void drawButton(int8_t which, bool pressed);
+    int8_t buttonAt(uint16_t x, uint16_t y);
     bool inRect(uint16_t x, uint16_t y, int rx, int ry, int rw, int rh);
 
-    // Touch debounce
-    uint32_t lastTouchMs = 0;
-    static constexpr uint32_t TOUCH_DEBOUNCE_MS = 250;
-
-    // Status parsing helpers
-    void updateLinesFromStatus(const char* s);
-    void updateLinesFromInfo(const char* m);
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "ui_TouchGestures.h"
+
+uint16_t TouchGestures::median(const uint16_t *v) const
+{
+  uint16_t s[WIN];
+  memcpy(s, v, wlen * sizeof(uint16_t));
+  for (uint8_t i = 1; i < wlen; ++i) {            // insertion sort; wlen <= 5
+    uint16_t k = s[i];
+    int8_t j = i - 1;
+    while (j >= 0 && s[j] > k) { s[j + 1] = s[j]; --j; }
+    s[j + 1] = k;
+  }
+  return s[wlen / 2];
+}
+
+void TouchGestures::push(TouchEventType t, uint32_t now)
+{
+  uint8_t next = (qtail + 1) % QLEN;
+  if (next == qhead) { dropped++; return; }
+  q[qtail] = { t, fx, fy, now };
+  qtail = next;
+}
+
+bool TouchGestures::pop(TouchEvent &e)
+{
+  if (qhead == qtail) return false;
+  e = q[qhead];
+  qhead = (qhead + 1) % QLEN;
+  return true;
+}
+
+void TouchGestures::feed(uint32_t now, bool valid, uint16_t x, uint16_t y)
+{
+  if (valid) {
+    wx[wpos] = x; wy[wpos] = y;
+    wpos = (wpos + 1) % WIN;
+    if (wlen < WIN) wlen++;
+    fx = median(wx);
+    fy = median(wy);
+  }
+
+  switch (state) {
+    case State::Idle:
+      if (!valid) return;
+      state = State::Confirming;
+      count = 1;
+      break;
+
+    case State::Confirming:
+      if (!valid) { state = State::Idle; wlen = wpos = 0; return; } // glitch
+      if (++count >= PRESS_CONFIRM) {
+        state = State::Pressed;
+        pressMs = now;
+        longSent = false;
+        count = 0;
+        push(TouchEventType::Press, now);
+      }
+      break;
+
+    case State::Pressed:
+      if (valid) {
+        count = 0;
+        if (!longSent && now - pressMs >= LONG_PRESS_MS) {
+          longSent = true;
+          push(TouchEventType::LongPress, now);
+        }
+      } else if (++count >= RELEASE_CONFIRM) {
+        push(TouchEventType::Release, now);
+        state = State::Idle;
+        wlen = wpos = 0;
+      }
+      break;
+  }
+}
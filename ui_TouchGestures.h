@@ -0,0 +1,55 @@
+#pragma once
+#include <Arduino.h>
+
+// Debounce/gesture engine for resistive touch panels.
+// Fed one raw sample per tick while the panel is active; filters by pressure
+// (caller passes valid=false below threshold) and a 5-sample median, and
+// emits Press / LongPress / Release events into a small queue.
+
+enum class TouchEventType : uint8_t
+{
+    Press,
+    LongPress,
+    Release
+};
+
+struct TouchEvent
+{
+    TouchEventType type;
+    uint16_t x, y;
+    uint32_t ms;
+};
+
+class TouchGestures
+{
+public:
+    static constexpr uint8_t PRESS_CONFIRM = 2;    // valid samples before Press
+    static constexpr uint8_t RELEASE_CONFIRM = 3;  // invalid samples before Release
+    static constexpr uint32_t LONG_PRESS_MS = 800;
+
+    void feed(uint32_t now, bool valid, uint16_t x, uint16_t y);
+    bool active() const { return state != State::Idle; } // keep sampling while true
+    bool pop(TouchEvent &e);
+
+    uint32_t dropped = 0; // events lost to a full queue
+
+private:
+    enum class State : uint8_t { Idle, Confirming, Pressed };
+
+    void push(TouchEventType t, uint32_t now);
+    uint16_t median(const uint16_t *v) const;
+
+    static constexpr uint8_t WIN = 5;
+    uint16_t wx[WIN] = {}, wy[WIN] = {};
+    uint8_t wlen = 0, wpos = 0;
+    uint16_t fx = 0, fy = 0;        // filtered position
+
+    State state = State::Idle;
+    uint8_t count = 0;
+    uint32_t pressMs = 0;
+    bool longSent = false;
+
+    static constexpr uint8_t QLEN = 8;
+    TouchEvent q[QLEN];
+    uint8_t qhead = 0, qtail = 0;
+};
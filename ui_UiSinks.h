@@ -0,0 +1,83 @@
+#pragma once
+#include <Arduino.h>
+#include "log_DeferredLog.h"
+#include "ui_UiStatus.h"
+
+// Build-time fan-out over UI sinks (shape documented in ui_IUiAdapter.h).
+//   UiSinks<TftEspiUi, SerialMirror> ui;   ui.first() is the display
+// Every call is a direct, inlinable call into each sink in order; NullUiSink
+// entries are empty and vanish, so optional mirrors cost nothing when off.
+
+// Placeholder for a disabled sink.
+struct NullUiSink
+{
+    void begin() {}
+    void setLink(UiLink, LinkState) {}
+    void setRelays(const UiRelayState &) {}
+    void showMetrics(const UiLinkMetrics &) {}
+    void showTelemetry(const char *) {}
+    void logInfo(const char *) {}
+    void logError(const char *) {}
+    void pump() {}
+};
+
+// Mirrors UI events into the deferred logger (strings are copied into the ring).
+struct LogUiSink
+{
+    void begin() {}
+    void setLink(UiLink l, LinkState s) { LOGI("UI %s: %s", uiLinkName(l), uiLinkStateText(l, s)); }
+    void setRelays(const UiRelayState &r)
+    {
+        char t[48];
+        uiRelayText(t, sizeof(t), r);
+        LOGI("UI relay: %s", t);
+    }
+    void showMetrics(const UiLinkMetrics &m)
+    {
+        char t[64];
+        uiMetricsText(t, sizeof(t), m);
+        LOGI("UI metrics: %s", t);
+    }
+    void showTelemetry(const char *p) { LOGI("UI telemetry: %s", p); }
+    void logInfo(const char *m) { LOGI("UI: %s", m); }
+    void logError(const char *m) { LOGE("UI: %s", m); }
+    void pump() {}
+};
+
+template <typename... Sinks>
+class UiSinks;
+
+template <>
+class UiSinks<>
+{
+public:
+    void begin() {}
+    void setLink(UiLink, LinkState) {}
+    void setRelays(const UiRelayState &) {}
+    void showMetrics(const UiLinkMetrics &) {}
+    void showTelemetry(const char *) {}
+    void logInfo(const char *) {}
+    void logError(const char *) {}
+    void pump() {}
+};
+
+template <typename Head, typename... Tail>
+class UiSinks<Head, Tail...>
+{
+public:
+    void begin()                             { head.begin();          tail.begin(); }
+    void setLink(UiLink l, LinkState s)      { head.setLink(l, s);    tail.setLink(l, s); }
+    void setRelays(const UiRelayState &r)    { head.setRelays(r);     tail.setRelays(r); }
+    void showMetrics(const UiLinkMetrics &m) { head.showMetrics(m);   tail.showMetrics(m); }
+    void showTelemetry(const char *p)        { head.showTelemetry(p); tail.showTelemetry(p); }
+    void logInfo(const char *m)              { head.logInfo(m);       tail.logInfo(m); }
+    void logError(const char *m)             { head.logError(m);      tail.logError(m); }
+    void pump()                              { head.pump();           tail.pump(); }
+
+    Head &first() { return head; }
+    UiSinks<Tail...> &rest() { return tail; }
+
+private:
+    Head head;
+    UiSinks<Tail...> tail;
+};
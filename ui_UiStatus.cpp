@@ -0,0 +1,52 @@
+#include "ui_UiStatus.h"
+#include "diag_Json.h"
+
+const char *uiLinkName(UiLink l)
+{
+  switch (l) {
+    case UiLink::WiFi: return "WiFi";
+    case UiLink::Time: return "Time";
+    case UiLink::Mqtt: return "MQTT";
+    default:           return "?";
+  }
+}
+
+const char *uiLinkStateText(UiLink l, LinkState s)
+{
+  if (l == UiLink::Time) {
+    switch (s) {
+      case LinkState::Connecting: return "syncing";
+      case LinkState::Up:         return "synced";
+      default:                    return "not set";
+    }
+  }
+  switch (s) {
+    case LinkState::Connecting: return "connecting";
+    case LinkState::Up:         return "connected";
+    default:                    return "disconnected";
+  }
+}
+
+size_t uiRelayText(char *out, size_t size, const UiRelayState &r)
+{
+  if (!size) return 0;
+  int n = snprintf(out, size, "%s", r.anyOn() ? "ON" : "OFF");
+  if (r.channels <= 1 || n < 0 || (size_t)n + r.channels + 4 > size) return n < 0 ? 0 : (size_t)n;
+  out[n++] = ' ';
+  out[n++] = '[';
+  for (uint8_t ch = 0; ch < r.channels; ++ch) out[n++] = r.on(ch) ? '1' : '0';
+  out[n++] = ']';
+  out[n] = '\0';
+  return (size_t)n;
+}
+
+size_t uiMetricsText(char *out, size_t size, const UiLinkMetrics &m)
+{
+  size_t len = 0;
+  if (!size) return 0;
+  out[0] = '\0';
+  if (m.ip[0] | m.ip[1] | m.ip[2] | m.ip[3]) jsonAppend(out, size, len, 0, "IP=%u.%u.%u.%u", m.ip[0], m.ip[1], m.ip[2], m.ip[3]);
+  if (m.rssi) jsonAppend(out, size, len, 0, "%sRSSI=%d", len ? " " : "", (int)m.rssi);
+  if (m.tlsMs) jsonAppend(out, size, len, 0, "%sTLS=%ums%s", len ? " " : "", (unsigned)m.tlsMs, m.tlsResumed ? " resumed" : "");
+  return len;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+
+// Typed status model shared by the app and every UI sink.
+// The app reports link states, relay levels and link metrics as values;
+// sinks keep the last value they drew, switch on the enums and format text
+// only for a field that changed. Free-form text is left for telemetry and
+// info/error messages.
+
+enum class UiLink : uint8_t
+{
+    WiFi = 0,
+    Time,       // NTP / clock
+    Mqtt,
+    Count
+};
+
+enum class LinkState : uint8_t
+{
+    Down = 0,
+    Connecting,
+    Up
+};
+
+struct UiRelayState
+{
+    uint32_t levels = 0;        // bit n: channel n driven ON
+    uint8_t channels = 1;
+
+    UiRelayState() = default;
+    UiRelayState(uint32_t l, uint8_t n) : levels(l), channels(n) {}
+
+    bool anyOn() const { return levels != 0; }
+    bool on(uint8_t ch) const { return ch < channels && (levels >> ch & 1); }
+    bool operator==(const UiRelayState &o) const { return levels == o.levels && channels == o.channels; }
+    bool operator!=(const UiRelayState &o) const { return !(*this == o); }
+};
+
+struct UiLinkMetrics
+{
+    uint8_t ip[4] = { 0, 0, 0, 0 };  // IPv4, first octet first (0.0.0.0: none)
+    int8_t rssi = 0;            // dBm (0: unknown)
+    uint16_t tlsMs = 0;         // last TLS handshake (0: none yet)
+    bool tlsResumed = false;
+
+    bool operator==(const UiLinkMetrics &o) const
+    {
+        return !memcmp(ip, o.ip, sizeof(ip)) && rssi == o.rssi && tlsMs == o.tlsMs && tlsResumed == o.tlsResumed;
+    }
+    bool operator!=(const UiLinkMetrics &o) const { return !(*this == o); }
+};
+
+const char *uiLinkName(UiLink l);                     // "WiFi", "Time", "MQTT"
+const char *uiLinkStateText(UiLink l, LinkState s);   // "connected", "syncing", ...
+// "ON" / "OFF"; with several channels "ON [0101]" (channel 0 first)
+size_t uiRelayText(char *out, size_t size, const UiRelayState &r);
+// "IP=192.168.1.50 RSSI=-61 TLS=180ms resumed" (unknown fields left out)
+size_t uiMetricsText(char *out, size_t size, const UiLinkMetrics &m);